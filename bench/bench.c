@@ -0,0 +1,73 @@
+#include "bench.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+
+/* private variables ======================================================== */
+static volatile unsigned long allocs;
+
+/* allocator ================================================================ */
+
+/*
+ * glibc lets a program replace its allocator, these count and hand over to
+ * it, for the whole program, threads and stdio included
+ */
+
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t count, size_t size);
+extern void * __libc_realloc(void * pointer, size_t size);
+
+void * malloc(size_t size) {
+    __sync_fetch_and_add(&allocs, 1);
+    return __libc_malloc(size);
+}
+
+void * calloc(size_t count, size_t size) {
+    __sync_fetch_and_add(&allocs, 1);
+    return __libc_calloc(count, size);
+}
+
+void * realloc(void * pointer, size_t size) {
+    __sync_fetch_and_add(&allocs, 1);
+    return __libc_realloc(pointer, size);
+}
+
+/* public functions ========================================================= */
+double bench_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+void bench_begin(bench_t * bench, const char * name) {
+    bench->name = name;
+    bench->allocs = allocs;
+    bench->begin = bench_now();
+}
+
+void bench_end(bench_t * bench, unsigned long ops, unsigned long long size) {
+    double ns = bench_now() - bench->begin;
+    unsigned long n = allocs - bench->allocs;
+
+    printf(
+        "%-24s ops=%lu ns/op=%.2f MB/s=%.2f allocs=%lu\n", bench->name, ops,
+        ops ? ns / ops : 0, ns > 0 ? size / ns * 1e3 : 0, n
+    );
+    fflush(stdout);
+}
+
+void bench_note(const char * format, ...) {
+    va_list ap;
+
+    printf("# ");
+
+    va_start(ap, format);
+    vprintf(format, ap);
+    va_end(ap);
+
+    printf("\n");
+    fflush(stdout);
+}
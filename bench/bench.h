@@ -0,0 +1,59 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+
+typedef struct bench_t bench_t;
+
+/*
+ * shared by every benchmark, so that make bench reports every hot path the
+ * same way, one line each, which stays comparable from a commit to the next:
+ *
+ *   name ops=N ns/op=X MB/s=Y allocs=Z
+ *
+ * fields always come in that order, MB/s is 0 for paths that do not go
+ * through bytes, allocs counts every malloc(), calloc() and realloc() in
+ * the measured run, the C library's own included; anything else a benchmark
+ * has to tell goes on lines starting with "#"
+ */
+
+struct bench_t {
+    const char * name;
+    double begin;               /* ns */
+    unsigned long allocs;       /* when it began */
+};
+
+/*
+ * bench_now()
+ *
+ * returns monotonic time (in ns)
+ */
+
+double bench_now(void);
+
+/*
+ * bench_begin()
+ *
+ * start measuring name
+ */
+
+void bench_begin(bench_t * bench, const char * name);
+
+/*
+ * bench_end()
+ *
+ * stop measuring, and report ops operations over size bytes, 0 if they are
+ * not about bytes
+ */
+
+void bench_end(bench_t * bench, unsigned long ops, unsigned long long size);
+
+/*
+ * bench_note()
+ *
+ * report anything else, printf() style, as a "#" line
+ */
+
+void bench_note(const char * format, ...);
+
+#endif
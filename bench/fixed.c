@@ -0,0 +1,285 @@
+#include "bench.h"
+#include "fixed.h"
+#include "nmea.h"
+#include "sector.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * fixed point against double, on the paths fixed.h is used for: rotation
+ * speeds, NMEA coordinates and sector boxes; on the soft-float target every
+ * double operation is a libgcc call, so that is where the gap shows, build it
+ * there with make bench/fixed HOSTCC=arm-linux-gnueabi-gcc; on a host with an
+ * FPU, double is the faster one (fixed point runs at about 0.75x to 0.9x, a
+ * 64-bit integer division costing more than a double one), so there this
+ * only checks tolerances
+ *
+ * fails if fixed point strays from double further than fixed.h tells: half a
+ * mm/s for speeds, one micro-degree for coordinates, and any box test but
+ * for points right on a box edge
+ */
+
+/* constants ================================================================ */
+#define WHEEL_LENGTH 1500
+#define PERIODS 4096
+#define ROUNDS 256
+
+#define SECTORS 8192
+#define QUERIES 1024
+#define EPSILON 200             /* micro-degrees */
+
+#define SENTENCES 4096
+
+#define SPEED_TOLERANCE 0.5     /* mm/s */
+#define DEGREES_TOLERANCE 1.0   /* micro-degrees */
+
+/* types ==================================================================== */
+typedef struct box_t box_t;
+
+/* structures =============================================================== */
+struct box_t {
+    double latitude;
+    double longitude;
+};
+
+/* private variables ======================================================== */
+static unsigned long long periods[PERIODS];
+static volatile double sink_double;
+static volatile unsigned long sink_fixed;
+
+static sector_t sectors[SECTORS];
+static int next[SECTORS];
+static sector_index_t index_;
+static box_t boxes[SECTORS];
+static long queries[QUERIES][2];
+
+/* private functions ======================================================== */
+static double absolute(double x) {
+    return x < 0 ? -x : x;
+}
+
+static int speeds(void) {
+    double ns_double, ns_fixed, error = 0;
+    bench_t bench;
+    int round, i;
+
+    /* 5 to 60 km/h, as periods of a WHEEL_LENGTH mm wheel (in ns) ---------- */
+    for (i = 0; i < PERIODS; i++) {
+        double kmh = 5 + 55.0 * rand() / RAND_MAX;
+
+        periods[i] = WHEEL_LENGTH * 3.6e6 / kmh;
+    }
+
+    /* as screen_3 did: Hz from ns, then km/h from Hz ----------------------- */
+    bench_begin(&bench, "fixed.speed.double");
+
+    for (round = 0; round < ROUNDS; round++) {
+        for (i = 0; i < PERIODS; i++) {
+            sink_double = 1e9 / periods[i] * WHEEL_LENGTH / 1000.0 * 3.6;
+        }
+    }
+
+    ns_double = bench_now() - bench.begin;
+    bench_end(&bench, ROUNDS * PERIODS, 0);
+
+    /* as it does now: mm/s from ns, then tenths of km/h from mm/s --------- */
+    bench_begin(&bench, "fixed.speed.fixed");
+
+    for (round = 0; round < ROUNDS; round++) {
+        for (i = 0; i < PERIODS; i++) {
+            sink_fixed = FIXED_TO_DECIKMH(fixed_mms(WHEEL_LENGTH, periods[i]));
+        }
+    }
+
+    ns_fixed = bench_now() - bench.begin;
+    bench_end(&bench, ROUNDS * PERIODS, 0);
+
+    for (i = 0; i < PERIODS; i++) {
+        double d = absolute(
+            fixed_mms(WHEEL_LENGTH, periods[i]) -
+            1e9 / periods[i] * WHEEL_LENGTH
+        );
+
+        error = d > error ? d : error;
+    }
+
+    bench_note(
+        "fixed.speed %.2fx, max error %.3f mm/s", ns_double / ns_fixed, error
+    );
+
+    return error <= SPEED_TOLERANCE ? 0 : -1;
+}
+
+static int scan_double(double latitude, double longitude) {
+    double epsilon = FIXED_TO_DEGREES(EPSILON);
+    int i;
+
+    /* the box test as it was, on doubles ---------------------------------- */
+    for (i = 0; i < SECTORS; i++) {
+        double latitude_min = boxes[i].latitude - epsilon;
+        double longitude_min = boxes[i].longitude - epsilon;
+
+        if (
+            latitude > latitude_min &&
+            latitude < latitude_min + 2 * epsilon &&
+            longitude > longitude_min &&
+            longitude < longitude_min + 2 * epsilon
+        ) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static int edge(const sector_t * sector, long latitude, long longitude) {
+    long dy = latitude - sector->latitude;
+    long dx = longitude - sector->longitude;
+
+    return
+        dy == EPSILON || dy == -EPSILON || dx == EPSILON || dx == -EPSILON;
+}
+
+static int boxes_test(void) {
+    static int results[2][QUERIES];
+    double ns_double, ns_fixed;
+    bench_t bench;
+    int i;
+
+    /* a track of boxes spaced half an epsilon apart, one degree square ---- */
+    for (i = 0; i < SECTORS; i++) {
+        sectors[i].latitude = 48000000 + i * EPSILON / 2 % 1000000;
+        sectors[i].longitude = 2000000 + i / 10 * EPSILON / 2;
+        boxes[i].latitude = FIXED_TO_DEGREES(sectors[i].latitude);
+        boxes[i].longitude = FIXED_TO_DEGREES(sectors[i].longitude);
+    }
+
+    for (i = 0; i < QUERIES; i++) {
+        const sector_t * s = &sectors[rand() % SECTORS];
+
+        queries[i][0] = s->latitude + rand() % (4 * EPSILON) - 2 * EPSILON;
+        queries[i][1] = s->longitude + rand() % (4 * EPSILON) - 2 * EPSILON;
+    }
+
+    index_.next = next;
+    sector_index_build(&index_, sectors, SECTORS, EPSILON, EPSILON);
+
+    /* every box in turn, as the sector screen once did --------------------- */
+    bench_begin(&bench, "fixed.boxes.double");
+
+    for (i = 0; i < QUERIES; i++) {
+        results[0][i] = scan_double(
+            FIXED_TO_DEGREES(queries[i][0]), FIXED_TO_DEGREES(queries[i][1])
+        );
+    }
+
+    ns_double = bench_now() - bench.begin;
+    bench_end(&bench, QUERIES, 0);
+
+    bench_begin(&bench, "fixed.boxes.fixed");
+
+    for (i = 0; i < QUERIES; i++) {
+        size_t current = 0;
+
+        results[1][i] = sector_scan(
+            &index_, sectors, SECTORS, queries[i][0], queries[i][1], &current
+        ) == -1 ? -1 : (int) current;
+    }
+
+    ns_fixed = bench_now() - bench.begin;
+    bench_end(&bench, QUERIES, 0);
+
+    bench_note(
+        "fixed.boxes %.2fx, %d sectors scanned", ns_double / ns_fixed, SECTORS
+    );
+
+    for (i = 0; i < QUERIES; i++) {
+        int a = results[0][i], b = results[1][i];
+
+        if (
+            a != b &&
+            !(a != -1 && edge(&sectors[a], queries[i][0], queries[i][1])) &&
+            !(b != -1 && edge(&sectors[b], queries[i][0], queries[i][1]))
+        ) {
+            fprintf(
+                stderr, "mismatch on query %d: double=%d fixed=%d\n", i, a, b
+            );
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int coordinates(void) {
+    static nmea_parser_t parser;
+    double error = 0;
+    int i;
+
+    nmea_init(&parser);
+
+    /* 4 to 7 decimals of minutes, as receivers send them ------------------ */
+    for (i = 0; i < SENTENCES; i++) {
+        unsigned long degrees = rand() % 90;
+        unsigned long minutes = rand() % 60;
+        unsigned long fraction = rand() % 10000000;
+        int decimals = 4 + i % 4;
+        double scale = 1e7;
+        char body[96], sentence[128];
+        unsigned char checksum = 0;
+        double expected;
+        char * c;
+
+        for (; decimals < 7; decimals++) {
+            fraction /= 10;
+            scale /= 10;
+        }
+
+        decimals = 4 + i % 4;
+
+        snprintf(
+            body, sizeof body, "GPGGA,120000,%02lu%02lu.%0*lu,N,00200.0000,E,"
+            "1,08,0.9,35.0,M,47.0,M,,", degrees, minutes, decimals, fraction
+        );
+
+        for (c = body; *c != '\0'; c++) {
+            checksum ^= *c;
+        }
+
+        snprintf(sentence, sizeof sentence, "$%s*%02X\r\n", body, checksum);
+
+        for (c = sentence; *c != '\0'; c++) {
+            if (nmea_parse(&parser, *c) == NMEA_GGA) {
+                break;
+            }
+        }
+
+        if (*c == '\0') {
+            fprintf(stderr, "rejected %s", sentence);
+            return -1;
+        }
+
+        /* exact value, in micro-degrees, against what was parsed ---------- */
+        expected = (degrees + (minutes + fraction / scale) / 60) * 1e6;
+        expected = absolute(parser.fix.latitude - expected);
+        error = expected > error ? expected : error;
+    }
+
+    bench_note("fixed.degrees max error %.3f micro-degrees", error);
+
+    return error <= DEGREES_TOLERANCE ? 0 : -1;
+}
+
+/* entry point ============================================================== */
+int main(void) {
+    srand(42);
+
+    if (speeds() == -1 || boxes_test() == -1 || coordinates() == -1) {
+        fprintf(stderr, "fixed point out of tolerance\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
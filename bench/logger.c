@@ -0,0 +1,182 @@
+#include "bench.h"
+#include "flash.h"
+#include "logger.h"
+#include "session.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * the logging path, as sensors use it: rotation timestamps pushed to a
+ * channel, formatted as text or binary (see session.h) by the writer thread,
+ * to flash chunks (see flash.h), in a scratch directory of /tmp, so what it
+ * measures is the page cache and not the medium; and flash chunks on their
+ * own, from records already formatted
+ */
+
+/* constants ================================================================ */
+#define RECORDS 2000000UL
+#define COUNT 4096
+#define RECORD_SIZE 64
+
+#define DIRECTORY "/tmp/ecollect-bench-XXXXXX"
+
+/* private variables ======================================================== */
+static session_writer_t writer;
+static volatile unsigned long sink;
+
+/* private functions ======================================================== */
+static int format(FILE * stream, const void * record) {
+    return fprintf(stream, "%llu\n", *(const unsigned long long *) record);
+}
+
+static int encode(FILE * stream, const void * record) {
+    session_record_t r;
+
+    /* same as speed.c: header first, then delta encoded blocks ------------ */
+    if (
+        writer.stream != stream &&
+        session_writer_open(&writer, stream, SESSION_SPEED) == -1
+    ) {
+        return -1;
+    }
+
+    r.time = *(const unsigned long long *) record;
+
+    return session_write(&writer, &r);
+}
+
+static int encode_close(FILE * stream) {
+    int result = session_writer_flush(&writer);
+
+    writer.stream = NULL;
+
+    (void) stream;
+
+    return result;
+}
+
+static unsigned long long file_size(const char * pathname) {
+    struct stat st;
+
+    return stat(pathname, &st) == -1 ? 0 : st.st_size;
+}
+
+static int run_channel(
+    const char * name, const char * pathname, logger_format_t format,
+    logger_close_t close
+) {
+    static unsigned long long buffer[COUNT];
+    static logger_channel_t channel;
+    unsigned long long time = 1000000000ULL, size;
+    logger_stats_t stats;
+    unsigned long i;
+    bench_t bench;
+
+    writer.stream = NULL;
+
+    if (
+        logger_init() == -1 ||
+        logger_open(
+            &channel, pathname, format, close, buffer, sizeof *buffer, COUNT
+        ) == -1
+    ) {
+        perror(pathname);
+        return -1;
+    }
+
+    /* half a ring at a time, then wait for the writer, so none is lost ---- */
+    bench_begin(&bench, name);
+
+    for (i = 0; i < RECORDS; i++) {
+        time += 200000000 + i % 1000 * 1000;
+        logger_push(&channel, &time);
+
+        if (i % (COUNT / 2) == COUNT / 2 - 1) {
+            logger_sync();
+        }
+    }
+
+    logger_exit();
+    bench_end(&bench, RECORDS, file_size(pathname));
+
+    /* every drain flushes a partial chunk, none of it should go twice ---- */
+    logger_get_stats(&channel, &stats);
+    size = file_size(pathname);
+    bench_note(
+        "%s %llu bytes, %lu written, %lu dropped, %.2f MB/s to flash, "
+        "%.3fx to the medium", name, size, stats.written, stats.dropped,
+        stats.write_time > 0 ? stats.bytes * 1e3 / stats.write_time : 0.0,
+        size > 0 ? (double) stats.bytes / size : 0.0
+    );
+
+    unlink(pathname);
+    unlink("logger");
+
+    return stats.written == RECORDS && stats.bytes == size ? 0 : -1;
+}
+
+static int run_flash(void) {
+    static unsigned char chunk[FLASH_CHUNK]
+        __attribute__((aligned(FLASH_CHUNK)));
+    unsigned char record[RECORD_SIZE];
+    flash_file_t file;
+    unsigned long i;
+    bench_t bench;
+
+    memset(record, '0', sizeof record);
+    record[RECORD_SIZE - 1] = '\n';
+
+    if (flash_open(&file, "flash", chunk, NULL) == -1) {
+        perror("flash");
+        return -1;
+    }
+
+    /* records formatted already, chunks and the final sync only ----------- */
+    bench_begin(&bench, "log.flash");
+
+    for (i = 0; i < RECORDS; i++) {
+        if (flash_write(&file, record, sizeof record) == -1) {
+            perror("flash");
+            return -1;
+        }
+    }
+
+    sink = file.writes;
+
+    if (flash_close(&file) == -1) {
+        perror("flash");
+        return -1;
+    }
+
+    bench_end(&bench, RECORDS, (unsigned long long) RECORDS * RECORD_SIZE);
+
+    unlink("flash");
+
+    return 0;
+}
+
+/* entry point ============================================================== */
+int main(void) {
+    char directory[] = DIRECTORY;
+    int result;
+
+    if (mkdtemp(directory) == NULL || chdir(directory) == -1) {
+        perror(directory);
+        return EXIT_FAILURE;
+    }
+
+    result =
+        run_channel("log.text", "speed", format, NULL) == -1 ||
+        run_channel("log.binary", "speed.bin", encode, encode_close) == -1 ||
+        run_flash() == -1;
+
+    if (chdir("/") == -1 || rmdir(directory) == -1) {
+        perror(directory);
+    }
+
+    return result ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,175 @@
+#include "bench.h"
+#include "nmea.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* constants ================================================================ */
+#define SYNTHETIC_SECONDS 3600
+#define SYNTHETIC_RATE 10
+#define BAUD 115200
+
+/* private variables ======================================================== */
+static char * stream;
+static size_t size;
+
+/* private functions ======================================================== */
+static void append(const char * body) {
+    unsigned char checksum = 0;
+    const char * c;
+
+    for (c = body; *c; c++) {
+        checksum ^= *c;
+    }
+
+    size += sprintf(stream + size, "$%s*%02X\r\n", body, checksum);
+}
+
+static void synthesize(void) {
+    unsigned long i, n = SYNTHETIC_SECONDS * SYNTHETIC_RATE;
+
+    stream = malloc(n * 256);
+
+    /* more fields than the mask has bits, which must be skipped, not masked */
+    append(
+        "GPVTG,054.7,T,034.4,M,005.5,N,010.2,K,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,"
+        "1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1"
+    );
+
+    for (i = 0; i < n; i++) {
+        unsigned long ms = i * 1000 / SYNTHETIC_RATE;
+        unsigned long s = ms / 1000;
+        char body[128];
+
+        sprintf(
+            body, "GPGGA,%02lu%02lu%02lu.%03lu,4807.%04lu,N,01131.%04lu,E,1,08,"
+            "0.9,545.4,M,46.9,M,,",
+            s / 3600 % 24, s / 60 % 60, s % 60, ms % 1000, i % 10000,
+            (i * 7) % 10000
+        );
+        append(body);
+
+        sprintf(
+            body, "GPRMC,%02lu%02lu%02lu.%03lu,A,4807.038,N,01131.000,E,"
+            "022.4,084.4,230394,003.1,W",
+            s / 3600 % 24, s / 60 % 60, s % 60, ms % 1000
+        );
+        append(body);
+
+        append("GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+        append("GPVTG,054.7,T,034.4,M,005.5,N,010.2,K");
+    }
+}
+
+static void load(const char * pathname) {
+    FILE * fp = fopen(pathname, "rb");
+    long length;
+
+    if (fp == NULL) {
+        perror(pathname);
+        exit(EXIT_FAILURE);
+    }
+
+    fseek(fp, 0, SEEK_END);
+    length = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    stream = malloc(length + 1);
+    size = fread(stream, 1, length, fp);
+    stream[size] = '\0';
+
+    fclose(fp);
+}
+
+static unsigned long run_parser(double * latitude) {
+    static nmea_parser_t parser;
+    unsigned long fixes = 0;
+    size_t i;
+
+    nmea_init(&parser);
+
+    for (i = 0; i < size; i++) {
+        if (nmea_parse(&parser, (unsigned char) stream[i]) == NMEA_GGA) {
+            *latitude += FIXED_TO_DEGREES(parser.fix.latitude);
+            ++fixes;
+        }
+    }
+
+    return fixes;
+}
+
+static unsigned long run_legacy(double * latitude) {
+    unsigned long fixes = 0;
+    char buffer[128];
+    size_t n = 0;
+
+    /* former fscanf("%s") tokenizing, strncmp filtering and sscanf decoding */
+    while ((n += strspn(stream + n, " \r\n")) < size) {
+        size_t length = strcspn(stream + n, " \r\n");
+
+        if (length >= sizeof buffer) {
+            length = sizeof buffer - 1;
+        }
+
+        memcpy(buffer, stream + n, length);
+        buffer[length] = '\0';
+        n += length;
+
+        if (strncmp(buffer, "$GPGGA", 6) == 0) {
+            double lat, lat_min, lon, lon_min;
+            char lat_dir, lon_dir, fix;
+
+            if (
+                sscanf(
+                    buffer, "$GPGGA,%*f,%2lf%lf,%c,%3lf%lf,%c,%c",
+                    &lat, &lat_min, &lat_dir, &lon, &lon_min, &lon_dir, &fix
+                ) == 7
+            ) {
+                *latitude += lat + lat_min / 60;
+                ++fixes;
+            }
+        }
+    }
+
+    return fixes;
+}
+
+static void report(
+    const char * name, unsigned long (* run)(double *)
+) {
+    double latitude = 0;
+    unsigned long fixes;
+    bench_t bench;
+    double ns;
+
+    /* one op is one byte, as the receiver hands them over ----------------- */
+    bench_begin(&bench, name);
+    fixes = run(&latitude);
+    ns = bench_now() - bench.begin;
+    bench_end(&bench, size, size);
+
+    bench_note(
+        "%s %lu fixes, %.0fx %d baud (checksum %.3f)", name, fixes,
+        size / ns * 1e9 / (BAUD / 10), BAUD, latitude / (fixes ? fixes : 1)
+    );
+}
+
+/* entry point ============================================================== */
+int main(int argc, char ** argv) {
+    if (argc > 1) {
+        load(argv[1]);
+    }
+    else {
+        synthesize();
+    }
+
+    bench_note("%lu bytes of NMEA", (unsigned long) size);
+
+    report("nmea.parse", run_parser);
+    report("nmea.legacy", run_legacy);
+
+    free(stream);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,222 @@
+#include "bench.h"
+#include "histogram.h"
+#include "ring.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* constants ================================================================ */
+#define SAMPLES 4000000UL
+#define COUNT 64
+#define PACED 2000UL            /* IRQ */
+#define PACE 1000000            /* ns in between, faster than any wheel */
+#define BURST 32                /* samples back to back, every BURST_EVERY */
+#define BURST_EVERY 200
+
+/* types ==================================================================== */
+typedef struct sample_t sample_t;
+
+/* structures =============================================================== */
+struct sample_t {
+    unsigned long long time;
+    unsigned long long queued;
+    int resync;
+};
+
+/* private variables ======================================================== */
+static ring_t ring;
+static sample_t buffer[COUNT];
+
+/* event, as the soft task waits for it in speed.c */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static int signaled;
+static volatile int done;
+
+/* private functions ======================================================== */
+static void signal_event(void) {
+    pthread_mutex_lock(&lock);
+    signaled = 1;
+    pthread_cond_signal(&cond);
+    pthread_mutex_unlock(&lock);
+}
+
+static void wait_event(void) {
+    pthread_mutex_lock(&lock);
+
+    while (!signaled) {
+        pthread_cond_wait(&cond, &lock);
+    }
+
+    signaled = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+static void * lossless_producer(void * cookie) {
+    sample_t sample = { 0, 0, 0 };
+
+    /* retry on full ring, every sample must go through --------------------- */
+    for (sample.time = 0; sample.time < SAMPLES; sample.time++) {
+        while (ring_push(&ring, &sample) == -1) {
+            sched_yield();
+        }
+    }
+
+    return cookie;
+}
+
+static void * paced_producer(void * cookie) {
+    sample_t sample = { 0, 0, 0 };
+    struct timespec deadline;
+    unsigned long i, n;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    /* as the hard task: a sample every IRQ, a burst of them now and then -- */
+    for (i = 0; i < PACED; i++) {
+        deadline.tv_nsec += PACE;
+
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_nsec -= 1000000000;
+            ++deadline.tv_sec;
+        }
+
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+
+        for (n = i % BURST_EVERY == 0 ? BURST : 1; n > 0; n--) {
+            sample.queued = bench_now();
+            ring_push(&ring, &sample);
+            signal_event();
+            ++sample.time;
+        }
+    }
+
+    done = 1;
+    signal_event();
+
+    return cookie;
+}
+
+static int lossless(void) {
+    pthread_t thread;
+    sample_t sample;
+    unsigned long long expected = 0;
+    bench_t bench;
+
+    bench_begin(&bench, "ring.spsc");
+    ring_init(&ring, buffer, sizeof *buffer, COUNT);
+    pthread_create(&thread, NULL, lossless_producer, NULL);
+
+    while (expected < SAMPLES) {
+        if (ring_pop(&ring, &sample) == -1) {
+            sched_yield();
+            continue;
+        }
+
+        if (sample.time != expected) {
+            fprintf(
+                stderr, "lossless: got %llu, expected %llu\n",
+                sample.time, expected
+            );
+            return -1;
+        }
+
+        ++expected;
+    }
+
+    pthread_join(thread, NULL);
+
+    bench_end(&bench, SAMPLES, SAMPLES * sizeof sample);
+    bench_note(
+        "ring.spsc %lu/%d high water, %lu full retries", ring.high_water,
+        COUNT, ring.dropped
+    );
+
+    return 0;
+}
+
+static int paced(void) {
+    static histogram_t wakeup;
+    pthread_t thread;
+    sample_t sample;
+    unsigned long popped = 0, batch = 0, batch_max = 0;
+    int woken = 0;
+
+    histogram_reset(&wakeup);
+    ring_init(&ring, buffer, sizeof *buffer, COUNT);
+    done = 0;
+    signaled = 0;
+    pthread_create(&thread, NULL, paced_producer, NULL);
+
+    /* as the soft task: drain everything, then sleep until signaled -------- */
+    while (1) {
+        if (ring_pop(&ring, &sample) == -1) {
+            if (done) {
+                break;
+            }
+
+            wait_event();
+            woken = 1;
+            batch = 0;
+            continue;
+        }
+
+        /* how long the first sample waited for us to wake up -------------- */
+        if (woken) {
+            histogram_record(&wakeup, bench_now() - sample.queued);
+            woken = 0;
+        }
+
+        if (sample.time != popped) {
+            fprintf(
+                stderr, "paced: got %llu, expected %lu\n", sample.time, popped
+            );
+            return -1;
+        }
+
+        ++popped;
+
+        if (++batch > batch_max) {
+            batch_max = batch;
+        }
+    }
+
+    pthread_join(thread, NULL);
+
+    /* producer is done, anything left was pushed before done was set ------- */
+    while (ring_pop(&ring, &sample) != -1) {
+        ++popped;
+    }
+
+    if (ring.dropped != 0 || popped != ring.head) {
+        fprintf(
+            stderr, "paced: %lu popped, %lu dropped, of %lu pushed\n",
+            popped, ring.dropped, ring.head
+        );
+        return -1;
+    }
+
+    bench_note(
+        "ring.wakeup %lu samples at %.0f Hz, bursts of %d, %lu max batch, "
+        "%lu dropped", popped, 1e9 / PACE, BURST, batch_max, ring.dropped
+    );
+    bench_note(
+        "ring.wakeup %lu wakeups, %.1f us p50, %.1f us p99, %.1f us max",
+        wakeup.count, histogram_percentile(&wakeup, 50) / 1e3,
+        histogram_percentile(&wakeup, 99) / 1e3, wakeup.max / 1e3
+    );
+
+    return 0;
+}
+
+/* entry point ============================================================== */
+int main(void) {
+    if (lossless() == -1 || paced() == -1) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
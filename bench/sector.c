@@ -0,0 +1,227 @@
+#include "bench.h"
+#include "sector.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* constants ================================================================ */
+#define EPSILON_LATITUDE 0.0002
+#define EPSILON_LONGITUDE 0.0003
+#define SECTORS 8192
+#define QUERIES 4096
+#define ROUNDS 16
+#define LOADS 8
+
+#define TEXT_PATHNAME "/tmp/ecollect-bench-sectors"
+#define BINARY_PATHNAME "/tmp/ecollect-bench-sectors.bin"
+
+/* types ==================================================================== */
+typedef struct query_t query_t;
+
+typedef int (* match_t)(
+    const sector_index_t *, const sector_t *, size_t, long, long, size_t *
+);
+
+/* structures =============================================================== */
+struct query_t {
+    long latitude;
+    long longitude;
+};
+
+/* private variables ======================================================== */
+static sector_t sectors[SECTORS];
+static int next[SECTORS];
+static sector_index_t index_;
+static query_t queries[QUERIES];
+static int results[2][QUERIES];
+
+/* private functions ======================================================== */
+static double jitter(double amplitude) {
+    return amplitude * (2.0 * rand() / RAND_MAX - 1);
+}
+
+static unsigned long long file_size(const char * pathname) {
+    struct stat st;
+
+    return stat(pathname, &st) == -1 ? 0 : st.st_size;
+}
+
+static void run(const char * name, match_t match, int * result) {
+    int round, i;
+    bench_t bench;
+
+    bench_begin(&bench, name);
+
+    for (round = 0; round < ROUNDS; round++) {
+        size_t current = 0;
+
+        for (i = 0; i < QUERIES; i++) {
+            result[i] = match(
+                &index_, sectors, SECTORS,
+                queries[i].latitude, queries[i].longitude, &current
+            ) == -1 ? -1 : (int) current;
+        }
+    }
+
+    bench_end(&bench, ROUNDS * QUERIES, 0);
+}
+
+static void load(
+    const char * name,
+    int (* loader)(sector_file_t *, const char *, double, double),
+    const char * pathname, sector_file_t * file
+) {
+    int round;
+    bench_t bench;
+
+    bench_begin(&bench, name);
+
+    for (round = 0; round < LOADS; round++) {
+        sector_file_free(file);
+
+        if (loader(file, pathname, EPSILON_LATITUDE, EPSILON_LONGITUDE)) {
+            perror(pathname);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    bench_end(&bench, LOADS, file_size(pathname) * LOADS);
+}
+
+static int same(const sector_file_t * a, const sector_file_t * b) {
+    return
+        a->count == b->count &&
+        memcmp(a->sectors, b->sectors, a->count * sizeof *a->sectors) == 0 &&
+        memcmp(a->index.head, b->index.head, sizeof a->index.head) == 0 &&
+        memcmp(a->index.next, b->index.next, a->count * sizeof (int)) == 0;
+}
+
+/* entry point ============================================================== */
+int main(void) {
+    int i, head, tail;
+    sector_file_t text, binary;
+    FILE * fp;
+
+    srand(42);
+
+    /* closed track, sectors spaced half an epsilon apart ------------------- */
+    for (i = 0; i < SECTORS; i++) {
+        double a = 2 * M_PI * i / SECTORS;
+        double r = SECTORS * EPSILON_LATITUDE / 2 / (2 * M_PI);
+
+        sectors[i].latitude = FIXED_FROM_DEGREES(48.0 + r * sin(a));
+        sectors[i].longitude = FIXED_FROM_DEGREES(2.0 + r * cos(a));
+        sectors[i].speed_min = FIXED_FROM_KMH(20);
+        sectors[i].speed_max = FIXED_FROM_KMH(30);
+    }
+
+    /* half the fixes follow the track, the other half are off track -------- */
+    for (i = 0; i < QUERIES; i++) {
+        const sector_t * s = &sectors[i * 2];
+
+        if (i % 2) {
+            queries[i].latitude = s->latitude +
+                FIXED_FROM_DEGREES(jitter(2 * EPSILON_LATITUDE));
+            queries[i].longitude = s->longitude +
+                FIXED_FROM_DEGREES(jitter(2 * EPSILON_LONGITUDE));
+        }
+        else {
+            queries[i].latitude = FIXED_FROM_DEGREES(47.0 + jitter(0.1));
+            queries[i].longitude = FIXED_FROM_DEGREES(1.0 + jitter(0.1));
+        }
+    }
+
+    index_.next = next;
+
+    sector_index_build(
+        &index_, sectors, SECTORS, FIXED_FROM_DEGREES(EPSILON_LATITUDE),
+        FIXED_FROM_DEGREES(EPSILON_LONGITUDE)
+    );
+
+    bench_note(
+        "%d sectors, %d queries, half of them off track", SECTORS, QUERIES
+    );
+
+    run("sector.scan", sector_scan, results[0]);
+    run("sector.match", sector_match, results[1]);
+
+    for (i = 0; i < QUERIES; i++) {
+        if (results[0][i] != results[1][i]) {
+            fprintf(
+                stderr, "mismatch on query %d: scan=%d match=%d\n",
+                i, results[0][i], results[1][i]
+            );
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* same track, as text then compiled, from page cache ------------------ */
+    if ((fp = fopen(TEXT_PATHNAME, "w")) == NULL) {
+        perror(TEXT_PATHNAME);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < SECTORS; i++) {
+        fprintf(
+            fp, "%.6f,%.6f,%.17g,%.17g\n",
+            FIXED_TO_DEGREES(sectors[i].latitude),
+            FIXED_TO_DEGREES(sectors[i].longitude),
+            FIXED_TO_KMH(sectors[i].speed_min),
+            FIXED_TO_KMH(sectors[i].speed_max)
+        );
+    }
+
+    fclose(fp);
+
+    memset(&text, 0, sizeof text);
+    memset(&binary, 0, sizeof binary);
+
+    load("sector.load_text", sector_file_load_text, TEXT_PATHNAME, &text);
+
+    if (sector_file_save(&text, BINARY_PATHNAME) == -1) {
+        perror(BINARY_PATHNAME);
+        return EXIT_FAILURE;
+    }
+
+    load("sector.load", sector_file_load, BINARY_PATHNAME, &binary);
+
+    if (!same(&text, &binary)) {
+        fprintf(stderr, "binary sector file does not match text one\n");
+        return EXIT_FAILURE;
+    }
+
+    /* a broken index with a matching CRC is rebuilt, not followed --------- */
+    sector_file_free(&binary);
+    head = text.index.head[0];
+    tail = text.index.next[SECTORS - 1];
+    text.index.head[0] = SECTORS;
+    text.index.next[SECTORS - 1] = SECTORS - 1;
+
+    if (sector_file_save(&text, BINARY_PATHNAME) == -1) {
+        perror(BINARY_PATHNAME);
+        return EXIT_FAILURE;
+    }
+
+    text.index.head[0] = head;
+    text.index.next[SECTORS - 1] = tail;
+
+    if (
+        sector_file_load(
+            &binary, BINARY_PATHNAME, EPSILON_LATITUDE, EPSILON_LONGITUDE
+        ) == -1 || !same(&text, &binary)
+    ) {
+        fprintf(stderr, "broken sector file index was not rebuilt\n");
+        return EXIT_FAILURE;
+    }
+
+    sector_file_free(&text);
+    sector_file_free(&binary);
+    unlink(TEXT_PATHNAME);
+    unlink(BINARY_PATHNAME);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,369 @@
+#include "bench.h"
+#include "debounce.h"
+#include "fixed.h"
+#include "pulse.h"
+#include "speed.h"
+#include "window.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * the wheel sensor path, one rotation at a time: the IRQ edge filter of
+ * task_hard_routine(), then speeds and rolling statistics of
+ * task_soft_routine(), on a synthetic ride, or on rotation timestamps (in
+ * ns) one per line, as in a "speed" log or a sim recording; then the same
+ * ride with several unevenly spaced magnets, wide pulses right after a
+ * resync, many magnets at speed through the edge filter, and the wheel
+ * stopping
+ *
+ * usage: speed [speed]
+ */
+
+/* constants ================================================================ */
+#define WHEEL_LENGTH 1500
+#define ROTATIONS 1000000UL
+#define ROUNDS 4
+#define MAGNETS 4
+
+/* private variables ======================================================== */
+static unsigned long long * times;
+static unsigned long count;
+static volatile unsigned long sink;
+
+/* private functions ======================================================== */
+static void synthesize(void) {
+    unsigned long long time = 1000000000ULL;
+    unsigned long i;
+
+    times = malloc(ROTATIONS * sizeof *times);
+
+    /* 10 to 40 km/h and back, every 1000 rotations ------------------------ */
+    for (i = 0; i < ROTATIONS; i++) {
+        unsigned long phase = i % 1000 < 500 ? i % 1000 : 1000 - i % 1000;
+        double kmh = 10 + 30.0 * phase / 500;
+
+        time += WHEEL_LENGTH * 3.6e6 / kmh;
+        times[i] = time;
+    }
+
+    count = ROTATIONS;
+}
+
+static void load(const char * pathname) {
+    unsigned long long time;
+    size_t size = 1024;
+    FILE * fp;
+
+    if ((fp = fopen(pathname, "r")) == NULL) {
+        perror(pathname);
+        exit(EXIT_FAILURE);
+    }
+
+    times = malloc(size * sizeof *times);
+
+    while (fscanf(fp, "%llu", &time) == 1) {
+        if (count == size) {
+            size *= 2;
+            times = realloc(times, size * sizeof *times);
+        }
+
+        times[count++] = time;
+    }
+
+    fclose(fp);
+
+    if (count < 2) {
+        fprintf(stderr, "%s: not enough rotations\n", pathname);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void run_irq(void) {
+    debounce_t debounce;
+    unsigned long round, i, rotations = 0;
+    bench_t bench;
+
+    /* as the sensor does it: two edges a pulse, a glitch now and then ----- */
+    bench_begin(&bench, "speed.irq");
+
+    for (round = 0; round < ROUNDS; round++) {
+        debounce_init(&debounce, 0, 0, 0, 1);
+
+        for (i = 0; i < count; i++) {
+            int verdict = debounce_edge(&debounce, times[i]);
+
+            debounce_edge(&debounce, times[i] + 2000000);
+
+            if (i % 64 == 0) {
+                debounce_edge(&debounce, times[i] + 7000000);
+            }
+
+            rotations += verdict != DEBOUNCE_REJECT;
+        }
+    }
+
+    bench_end(&bench, debounce.edges * ROUNDS, 0);
+    bench_note(
+        "speed.irq %lu edges, %lu rotations, %lu rejected, %lu storms",
+        debounce.edges, debounce.accepted, debounce.rejected, debounce.storms
+    );
+
+    sink = rotations;
+}
+
+static void run_rotation(void) {
+    static window_t by_rotations, by_time;
+    speed_snapshot_t speed;
+    unsigned long round, i;
+    unsigned long long period;
+    pulse_t pulse;
+    bench_t bench;
+
+    /* what the soft task does with every rotation the ring hands it ------- */
+    bench_begin(&bench, "speed.rotation");
+
+    for (round = 0; round < ROUNDS; round++) {
+        window_init(&by_rotations, WHEEL_LENGTH, SPEED_WINDOW_ROTATIONS, 0);
+        window_init(&by_time, WHEEL_LENGTH, 0, SPEED_WINDOW_SECONDS * 1e9);
+        pulse_init(&pulse, 1);
+        pulse_resync(&pulse, times[0]);
+
+        for (i = 1; i < count; i++) {
+            speed.instant = fixed_mms(
+                (unsigned long long) pulse_push(&pulse, times[i], &period) *
+                WHEEL_LENGTH, period
+            );
+            speed.average = fixed_mms(
+                (unsigned long long) i * WHEEL_LENGTH, times[i] - times[0]
+            );
+            speed.rotations = i;
+            speed.pulses = i;
+            speed.time = times[i];
+
+            window_push(&by_rotations, times[i], period);
+            window_push(&by_time, times[i], period);
+            window_get_stats(&by_rotations, &speed.by_rotations);
+            window_get_stats(&by_time, &speed.by_time);
+        }
+    }
+
+    bench_end(&bench, (count - 1) * ROUNDS, 0);
+    bench_note(
+        "speed.rotation last %lu mm/s instant, %lu mm/s average",
+        speed.instant, speed.average
+    );
+
+    sink = speed.instant;
+}
+
+static void run_pulses(void) {
+    /* where magnets are, in 1/1000 of a rotation, not quite evenly -------- */
+    static const unsigned int at[MAGNETS] = { 0, 230, 500, 740 };
+    unsigned long i, m, updates = 0;
+    unsigned long long span, time, previous = times[0];
+    unsigned long instant = 0, single, truth;
+    double error, worst = 0, worst_single = 0;
+    unsigned int periods;
+    pulse_t pulse;
+    bench_t bench;
+
+    /* pulses in between rotations, timed as if speed held over each ------- */
+    bench_begin(&bench, "speed.pulse");
+
+    pulse_init(&pulse, MAGNETS);
+    pulse_resync(&pulse, times[0]);
+
+    for (i = 1; i < count; i++) {
+        truth = fixed_mms(WHEEL_LENGTH, times[i] - times[i - 1]);
+
+        for (m = 1; m <= MAGNETS; m++) {
+            time = times[i - 1] + (times[i] - times[i - 1]) *
+                (m < MAGNETS ? at[m] : 1000) / 1000;
+
+            periods = pulse_push(&pulse, time, &span);
+            instant = fixed_mms(
+                (unsigned long long) periods * WHEEL_LENGTH, span * MAGNETS
+            );
+            single = fixed_mms(WHEEL_LENGTH, (time - previous) * MAGNETS);
+            previous = time;
+            ++updates;
+
+            /* over a whole rotation, magnet spacing cancels out ----------- */
+            if (i < 2 || truth == 0) {
+                continue;
+            }
+
+            error = ((double) instant - truth) / truth;
+            worst = error > worst ? error : -error > worst ? -error : worst;
+            error = ((double) single - truth) / truth;
+            worst_single = error > worst_single ? error :
+                -error > worst_single ? -error : worst_single;
+        }
+    }
+
+    bench_end(&bench, updates, 0);
+    bench_note(
+        "speed.pulse %d magnets, %lu updates, %.2f %% off at most, %.2f %% "
+        "from one pulse period", MAGNETS, updates, worst * 100,
+        worst_single * 100
+    );
+
+    sink = instant;
+}
+
+static int check_resync(void) {
+    unsigned long long time = 1000000000ULL, period, width;
+    unsigned long i, e, rotations = 0, storms = 0;
+    debounce_t debounce;
+    int verdict;
+
+    /* 8 to 12 km/h, the second edge of a pulse 20 to 100 ms after its first,
+       right after the first rotation, then after a storm every 100 ------- */
+    debounce_init(&debounce, 0, 0, 0, 1);
+
+    for (i = 0; i < 1000; i++) {
+        period = WHEEL_LENGTH * 3.6e6 / (8 + i % 5);
+        width = (20 + i * 37 % 81) * 1000000ULL;
+
+        verdict = debounce_edge(&debounce, time);
+        rotations += verdict != DEBOUNCE_REJECT;
+
+        if (debounce_edge(&debounce, time + width) != DEBOUNCE_REJECT) {
+            fprintf(
+                stderr, "resync: second edge %llu ms into rotation %lu taken "
+                "as a rotation\n", width / 1000000, i
+            );
+            return -1;
+        }
+
+        /* the wire floods right after the pulse, IRQ is masked for a while */
+        if (i % 100 == 50) {
+            for (e = 1; e < 2 * DEBOUNCE_STORM_EDGES; e++) {
+                verdict = debounce_edge(&debounce, time + width + e * 500000);
+
+                if (verdict == DEBOUNCE_STORM) {
+                    break;
+                }
+            }
+
+            if (verdict != DEBOUNCE_STORM) {
+                fprintf(stderr, "resync: no storm after rotation %lu\n", i);
+                return -1;
+            }
+
+            ++storms;
+            time += DEBOUNCE_STORM_MASK;
+        }
+
+        time += period;
+    }
+
+    if (rotations != i) {
+        fprintf(stderr, "resync: %lu rotations out of %lu\n", rotations, i);
+        return -1;
+    }
+
+    bench_note(
+        "speed.resync %lu rotations of wide pulses, %lu storms, none extra",
+        rotations, storms
+    );
+
+    return 0;
+}
+
+static int check_magnets(void) {
+    unsigned long long time = 1000000000ULL, period, gap, start;
+    unsigned long i, m, pulses = 0;
+    debounce_t debounce;
+
+    /* 120 km/h on PULSE_MAX magnets, 20 % off even spacing, two edges a
+       pulse: more edges than DEBOUNCE_STORM_EDGES in a storm period ------ */
+    debounce_init(&debounce, 0, 0, 0, PULSE_MAX);
+    period = WHEEL_LENGTH * 3.6e6 / 120;
+
+    for (i = 0; i < 1000; i++) {
+        for (m = 0, start = time; m < PULSE_MAX; m++) {
+            gap = period / PULSE_MAX * (m % 2 ? 12 : 8) / 10;
+
+            pulses += debounce_edge(&debounce, time) != DEBOUNCE_REJECT;
+            debounce_edge(&debounce, time + gap / 10);
+            time += gap;
+        }
+
+        time = start + period;
+    }
+
+    if (debounce.storms != 0 || pulses != i * PULSE_MAX) {
+        fprintf(
+            stderr, "magnets: %lu pulses out of %lu, %lu storms\n", pulses,
+            i * PULSE_MAX, debounce.storms
+        );
+        return -1;
+    }
+
+    bench_note(
+        "speed.magnets %d magnets at 120 km/h, %lu pulses, %lu rejected, "
+        "no storm", PULSE_MAX, pulses, debounce.rejected
+    );
+
+    return 0;
+}
+
+static int check_decay(void) {
+    unsigned long speed = 8333, previous = 8333, decayed;
+    unsigned long long elapsed;
+
+    /* 30 km/h, then no pulse: never rising, 0 once stale ------------------ */
+    for (elapsed = 0; elapsed <= PULSE_STALE; elapsed += 10000000) {
+        decayed = pulse_decay(speed, WHEEL_LENGTH, MAGNETS, elapsed);
+
+        if (decayed > previous || decayed > speed) {
+            fprintf(stderr, "decay: %lu mm/s rises\n", decayed);
+            return -1;
+        }
+
+        previous = decayed;
+    }
+
+    if (previous != 0) {
+        fprintf(stderr, "decay: %lu mm/s once stale\n", previous);
+        return -1;
+    }
+
+    bench_note(
+        "speed.decay %lu mm/s after 0.5 s, %lu after 1 s, 0 after %.1f s",
+        pulse_decay(speed, WHEEL_LENGTH, MAGNETS, 500000000),
+        pulse_decay(speed, WHEEL_LENGTH, MAGNETS, 1000000000),
+        PULSE_STALE / 1e9
+    );
+
+    return 0;
+}
+
+/* entry point ============================================================== */
+int main(int argc, char ** argv) {
+    if (argc > 1) {
+        load(argv[1]);
+    }
+    else {
+        synthesize();
+    }
+
+    bench_note("%lu rotations of a %d mm wheel", count, WHEEL_LENGTH);
+
+    run_irq();
+    run_rotation();
+    run_pulses();
+
+    if (
+        check_resync() == -1 || check_magnets() == -1 || check_decay() == -1
+    ) {
+        free(times);
+        return EXIT_FAILURE;
+    }
+
+    free(times);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+#include "bench.h"
+#include "frame.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* constants ================================================================ */
+#define ITERATIONS 1000000UL
+#define LOOPBACK_FRAMES 1000
+#define STREAM_FRAMES 1000
+
+/* private functions ======================================================== */
+static void synthesize(frame_t * frame, unsigned long i) {
+    memset(frame, 0, sizeof *frame);
+    frame->flags = FRAME_SPEED | FRAME_FIX | (i % 2 ? FRAME_ENERGY : 0);
+    frame->sequence = i & 0xffff;
+    frame->time = i * 50;
+    frame->instant = 6944 + i % 100;
+    frame->average = 6500;
+    frame->rotations = i / 3;
+    frame->latitude = 48856600 + (long) i;
+    frame->longitude = -2352200 - (long) i;
+    frame->quality = 1;
+    frame->satellites = 8;
+    frame->sector = i % 7 ? (int) (i % 7) : -1;
+    frame->power = i % 2 ? -12 : 240;
+    frame->energy = i * 3;
+    frame->frames = i & 0xffff;
+    frame->errors = i % 5;
+}
+
+static int same(const frame_t * a, const frame_t * b) {
+    return memcmp(a, b, sizeof *a) == 0;
+}
+
+static int check_pack(void) {
+    unsigned char packed[FRAME_SIZE];
+    frame_t frame, copy;
+    unsigned long i;
+    bench_t bench;
+
+    bench_begin(&bench, "frame.roundtrip");
+
+    for (i = 0; i < ITERATIONS; i++) {
+        synthesize(&frame, i);
+        frame_pack(&frame, packed);
+
+        memset(&copy, 0, sizeof copy);
+
+        if (frame_unpack(packed, &copy) == -1 || !same(&frame, &copy)) {
+            fprintf(stderr, "pack: frame %lu does not round trip\n", i);
+            return -1;
+        }
+    }
+
+    bench_end(&bench, ITERATIONS, (unsigned long long) ITERATIONS * FRAME_SIZE);
+
+    return 0;
+}
+
+static int check_loopback(void) {
+    unsigned char packed[FRAME_SIZE], received[FRAME_SIZE + 1];
+    struct sockaddr_in address;
+    socklen_t length = sizeof address;
+    struct timeval timeout = { 1, 0 };
+    frame_t frame, copy;
+    int in, out, i;
+    int result = -1;
+
+    /* same path as "udp:127.0.0.1:port" to the receiver, on any port ------ */
+    in = socket(AF_INET, SOCK_DGRAM, 0);
+    out = socket(AF_INET, SOCK_DGRAM, 0);
+
+    memset(&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (
+        in == -1 || out == -1 ||
+        bind(in, (struct sockaddr *) &address, sizeof address) == -1 ||
+        getsockname(in, (struct sockaddr *) &address, &length) == -1 ||
+        connect(out, (struct sockaddr *) &address, sizeof address) == -1
+    ) {
+        perror("loopback");
+        goto out;
+    }
+
+    setsockopt(in, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+
+    for (i = 0; i < LOOPBACK_FRAMES; i++) {
+        synthesize(&frame, i);
+        frame_pack(&frame, packed);
+
+        if (
+            send(out, packed, sizeof packed, 0) != sizeof packed ||
+            recv(in, received, sizeof received, 0) != FRAME_SIZE ||
+            frame_unpack(received, &copy) == -1 || !same(&frame, &copy)
+        ) {
+            fprintf(stderr, "loopback: frame %d did not make it\n", i);
+            goto out;
+        }
+    }
+
+    bench_note(
+        "frame.loopback %d frames over UDP, all through", LOOPBACK_FRAMES
+    );
+
+    result = 0;
+
+out:
+    if (in != -1) {
+        close(in);
+    }
+
+    if (out != -1) {
+        close(out);
+    }
+
+    return result;
+}
+
+static int check_stream(void) {
+    static unsigned char stream[STREAM_FRAMES * (FRAME_SIZE + 8)];
+    static frame_scanner_t scanner;
+    static int corrupted[STREAM_FRAMES];
+    unsigned long expected = 0, intact = 0;
+    size_t size = 0, i;
+    frame_t frame, copy;
+
+    /* frames with noise in between, some of them with a byte flipped ------ */
+    srand(1);
+
+    for (i = 0; i < STREAM_FRAMES; i++) {
+        size_t noise = rand() % 8, j;
+
+        for (j = 0; j < noise; j++) {
+            stream[size++] = j % 2 ? 0xe7 : rand();
+        }
+
+        synthesize(&frame, i);
+        frame_pack(&frame, stream + size);
+
+        if ((corrupted[i] = rand() % 10 == 0)) {
+            stream[size + 2 + rand() % (FRAME_SIZE - 2)] ^= 1 << rand() % 8;
+        }
+        else {
+            ++intact;
+        }
+
+        size += FRAME_SIZE;
+    }
+
+    for (i = 0; i < size; i++) {
+        if (!frame_scan(&scanner, stream[i], &frame)) {
+            continue;
+        }
+
+        /* every intact frame, in order, none of the corrupt ones ---------- */
+        while (expected < STREAM_FRAMES && corrupted[expected]) {
+            ++expected;
+        }
+
+        synthesize(&copy, expected++);
+
+        if (!same(&frame, &copy)) {
+            fprintf(stderr, "stream: frame %lu is wrong\n", expected - 1);
+            return -1;
+        }
+    }
+
+    if (scanner.frames != intact) {
+        fprintf(
+            stderr, "stream: %lu frames out of %lu intact\n", scanner.frames,
+            intact
+        );
+        return -1;
+    }
+
+    bench_note(
+        "frame.stream %lu frames found back, %lu bytes skipped",
+        scanner.frames, scanner.skipped
+    );
+
+    return 0;
+}
+
+/* entry point ============================================================== */
+int main(void) {
+    if (check_pack() == -1 || check_loopback() == -1 || check_stream() == -1) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,113 @@
+#include "bench.h"
+#include "utc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* constants ================================================================ */
+#define EPOCHS 100000UL
+#define PERIOD 100              /* ms, a 10 Hz receiver */
+#define LATENCY 20e6            /* ns, receiver to first byte */
+#define DRIFT 50e-6             /* our clock against the receiver's */
+#define TOLERANCE 5e6           /* ns, mapped against true epochs */
+
+/* private functions ======================================================== */
+static double jitter(void) {
+    /* mostly a few ms late, now and then a lot, never early --------------- */
+    if (rand() % 20 == 0) {
+        return (rand() % 150) * 1e6;
+    }
+
+    return (rand() % 5000) * 1e3;
+}
+
+static int check_track(void) {
+    unsigned long i, day = UTC_DAY - 3600000L, worst_at = 0;
+    double epoch, error, worst = 0;
+    unsigned long long mapped;
+    utc_clock_t clock;
+    bench_t bench;
+
+    utc_init(&clock);
+    utc_set_latency(&clock, LATENCY);
+    srand(1);
+
+    /* starting an hour before midnight, so it is crossed on the way ------- */
+    bench_begin(&bench, "utc.update");
+
+    for (i = 0; i < EPOCHS; i++) {
+        unsigned long at = (day + i * PERIOD) % UTC_DAY;
+
+        epoch = 1e12 + i * PERIOD * 1e6 * (1 + DRIFT);
+        utc_update(&clock, at, epoch + LATENCY + jitter());
+
+        if (i < 100 || utc_map(&clock, at, &mapped) == -1) {
+            continue;
+        }
+
+        error = mapped - epoch;
+
+        if (error < 0) {
+            error = -error;
+        }
+
+        if (error > worst) {
+            worst = error;
+            worst_at = i;
+        }
+    }
+
+    bench_end(&bench, EPOCHS, 0);
+
+    if (worst > TOLERANCE || clock.restarts != 0) {
+        fprintf(
+            stderr, "track: %.3f ms off at epoch %lu, %lu restarts\n",
+            worst / 1e6, worst_at, clock.restarts
+        );
+        return -1;
+    }
+
+    bench_note(
+        "utc.track %lu epochs, %.3f ms off at most, drift %.3f ppm for %.3f, "
+        "%lu outliers", EPOCHS, worst / 1e6, clock.drift * 1e6, DRIFT * 1e6,
+        clock.rejected
+    );
+
+    return 0;
+}
+
+static int check_restart(void) {
+    unsigned long long mapped;
+    utc_clock_t clock;
+    unsigned long i;
+
+    utc_init(&clock);
+
+    /* settled, then the receiver jumps back a minute, as when it restarts - */
+    for (i = 0; i < 20; i++) {
+        utc_update(&clock, 60000 + i * PERIOD, i * PERIOD * 1e6);
+    }
+
+    for (i = 20; i < 40; i++) {
+        utc_update(&clock, i * PERIOD, i * PERIOD * 1e6);
+    }
+
+    if (
+        clock.restarts != 1 || utc_map(&clock, 39 * PERIOD, &mapped) == -1 ||
+        mapped != 39 * PERIOD * 1000000ULL
+    ) {
+        fprintf(stderr, "restart: model did not start over\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+/* entry point ============================================================== */
+int main(void) {
+    if (check_track() == -1 || check_restart() == -1) {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
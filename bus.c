@@ -0,0 +1,186 @@
+#include "bus.h"
+
+#include <string.h>
+
+/* constants ================================================================ */
+#define ALIGN 8
+
+/* macros =================================================================== */
+#define ALIGN_UP(x) (((x) + ALIGN - 1) & ~(size_t) (ALIGN - 1))
+
+/* a slot copy: value time, then value ------------------------------------- */
+#define COPY_SIZE(size) (ALIGN_UP(sizeof (unsigned long long)) + ALIGN_UP(size))
+
+/* private variables ======================================================== */
+static unsigned char arena[BUS_ARENA] __attribute__((aligned(ALIGN)));
+static size_t used;
+
+static bus_channel_t * channels[BUS_CHANNEL_MAX];
+static const bus_sensor_t * sensors[BUS_SENSOR_MAX];
+static size_t sensor_count;
+
+/* private functions ======================================================== */
+static void * carve(size_t size) {
+    void * p;
+
+    if (ALIGN_UP(size) > BUS_ARENA - used) {
+        return NULL;
+    }
+
+    p = arena + used;
+    used += ALIGN_UP(size);
+
+    return p;
+}
+
+static unsigned char * copy(
+    const bus_channel_t * channel, unsigned long sequence
+) {
+    return channel->slot + (sequence & 1) * COPY_SIZE(channel->size);
+}
+
+/* public functions ========================================================= */
+void bus_init(void) {
+    memset(channels, 0, sizeof channels);
+    sensor_count = 0;
+    used = 0;
+}
+
+int bus_attach(const bus_sensor_t * sensor) {
+    if (sensor_count == BUS_SENSOR_MAX) {
+        goto err_sensor_max;
+    }
+
+    if (sensor->init() == -1) {
+        goto err_init;
+    }
+
+    sensors[sensor_count++] = sensor;
+
+    return 0;
+
+err_init:
+err_sensor_max:
+    return -1;
+}
+
+int bus_exit(void) {
+    int result = 0;
+
+    /* last attached may depend on the ones before, it goes first ---------- */
+    while (sensor_count > 0) {
+        if (sensors[--sensor_count]->exit() == -1) {
+            result = -1;
+        }
+    }
+
+    memset(channels, 0, sizeof channels);
+
+    return result;
+}
+
+int bus_open(
+    bus_channel_t * channel, int type, size_t size, const char * pathname,
+    logger_format_t format, logger_close_t close, size_t record_size,
+    unsigned long count
+) {
+    size_t mark = used;
+    void * records;
+
+    if (type < 0 || type >= BUS_CHANNEL_MAX || channels[type] != NULL) {
+        goto err_type;
+    }
+
+    /* two copies for the slot, then the log ring -------------------------- */
+    if ((channel->slot = carve(2 * COPY_SIZE(size))) == NULL) {
+        goto err_arena;
+    }
+
+    if ((records = carve(record_size * count)) == NULL) {
+        goto err_arena;
+    }
+
+    channel->type = type;
+    channel->size = size;
+    memset(channel->slot, 0, 2 * COPY_SIZE(size));
+    seqlock_init(&channel->seqlock);
+
+    if (
+        logger_open(
+            &channel->log, pathname, format, close, records, record_size,
+            count
+        ) == -1
+    ) {
+        goto err_log;
+    }
+
+    channels[type] = channel;
+
+    return 0;
+
+err_log:
+err_arena:
+    used = mark;
+
+err_type:
+    return -1;
+}
+
+int bus_publish(
+    bus_channel_t * channel, unsigned long long time, const void * value,
+    const void * record
+) {
+    if (value != NULL) {
+        /* fill the copy readers are not looking at, then flip ------------- */
+        unsigned char * p = copy(
+            channel, seqlock_write_begin(&channel->seqlock)
+        );
+
+        memcpy(p, &time, sizeof time);
+        memcpy(p + COPY_SIZE(0), value, channel->size);
+        seqlock_write_end(&channel->seqlock);
+    }
+
+    if (record != NULL) {
+        return logger_push(&channel->log, record);
+    }
+
+    return 0;
+}
+
+int bus_read(int type, void * dest, size_t size, unsigned long long * time) {
+    const bus_channel_t * channel;
+    unsigned long long t;
+    unsigned long sequence;
+
+    if (type < 0 || type >= BUS_CHANNEL_MAX) {
+        goto err_type;
+    }
+
+    if ((channel = channels[type]) == NULL) {
+        goto err_type;
+    }
+
+    if (size != channel->size) {
+        goto err_size;
+    }
+
+    do {
+        const unsigned char * p;
+
+        sequence = seqlock_read_begin(&channel->seqlock);
+        p = copy(channel, sequence);
+        memcpy(&t, p, sizeof t);
+        memcpy(dest, p + COPY_SIZE(0), size);
+    } while (seqlock_read_retry(&channel->seqlock, sequence));
+
+    if (time != NULL) {
+        *time = t;
+    }
+
+    return 0;
+
+err_size:
+err_type:
+    return -1;
+}
@@ -0,0 +1,129 @@
+#ifndef BUS_H
+#define BUS_H
+
+#include "logger.h"
+#include "seqlock.h"
+
+#include <stddef.h>
+
+#define BUS_CHANNEL_MAX 8
+#define BUS_SENSOR_MAX 8
+#define BUS_ARENA (64 << 10)    /* bytes, for every slot and log ring */
+
+#define BUS_SPEED 0             /* speed_snapshot_t, see speed.h */
+#define BUS_GPS 1               /* gps_fix_t, see gps.h */
+#define BUS_ENERGY 2            /* energy_snapshot_t, see energy.h */
+
+typedef struct bus_channel_t bus_channel_t;
+typedef struct bus_sensor_t bus_sensor_t;
+
+/*
+ * sensor bus: sensors attach to it, and publish what they sample to channels,
+ * one per sample type, all carved out of one preallocated arena
+ *
+ * a channel is a latest value slot, two copies behind a seqlock, so the UI
+ * reads it lock-free and never waits for a sensor, and a log stream, a logger
+ * channel (see logger.h) which keeps every record in order, for the writer
+ * thread to format to the channel file; a sensor brings its sampling task,
+ * the bus brings memory, locking, files and the thread writing them
+ */
+
+struct bus_channel_t {
+    int type;
+    size_t size;                    /* value size (in bytes) */
+    unsigned char * slot;           /* two timestamped values, in the arena */
+    seqlock_t seqlock;
+    logger_channel_t log;
+};
+
+struct bus_sensor_t {
+    const char * name;
+    int (* init)(void);
+    int (* exit)(void);
+};
+
+/*
+ * bus_init()
+ *
+ * forget every channel and sensor, and give the whole arena back, for a new
+ * session; logger_init() must have been called
+ */
+
+void bus_init(void);
+
+/*
+ * bus_attach()
+ *
+ * start sensor, through its init(), which opens its channels, and keep it
+ * until bus_exit(); sensor must stay valid until then
+ *
+ * returns -1 if:
+ *  - BUS_SENSOR_MAX sensors are already attached
+ *  - sensor could not be started
+ */
+
+int bus_attach(const bus_sensor_t * sensor);
+
+/*
+ * bus_exit()
+ *
+ * stop every attached sensor, the last attached first, and close every
+ * channel to readers; channel files are closed by logger_exit()
+ *
+ * returns -1 if:
+ *  - a sensor could not be stopped, the others are stopped anyway
+ */
+
+int bus_exit(void);
+
+/*
+ * bus_open()
+ *
+ * open channel, which readers find by type, with size bytes values; every
+ * record published is formatted with format to a pathname file, and queued
+ * in a ring of count records of record_size bytes, count being a power of
+ * two, see logger_open() for close; channel must stay valid until bus_exit()
+ *
+ * returns -1 if:
+ *  - type is not below BUS_CHANNEL_MAX, or already opened
+ *  - arena is too small for what is left to carve
+ *  - log channel could not be opened
+ */
+
+int bus_open(
+    bus_channel_t * channel, int type, size_t size, const char * pathname,
+    logger_format_t format, logger_close_t close, size_t record_size,
+    unsigned long count
+);
+
+/*
+ * bus_publish()
+ *
+ * publish value, sampled at time (in ns), as channel latest value, if not
+ * NULL, and queue record to channel log, if not NULL; never blocks and never
+ * enters Linux, so it can be called from a real-time task, but from one task
+ * only per channel
+ *
+ * returns -1 if:
+ *  - channel log ring is full, record is dropped
+ */
+
+int bus_publish(
+    bus_channel_t * channel, unsigned long long time, const void * value,
+    const void * record
+);
+
+/*
+ * bus_read()
+ *
+ * copy latest value of type, a zeroed one until the first is published, to
+ * dest, and its time to time, unless NULL; never waits for the sensor
+ *
+ * returns -1 if:
+ *  - no channel of type is open
+ *  - size is not the size of its values
+ */
+
+int bus_read(int type, void * dest, size_t size, unsigned long long * time);
+
+#endif
@@ -0,0 +1,32 @@
+#include "crc32.h"
+
+/* private variables ======================================================== */
+static uint32_t table[256];
+
+/* public functions ========================================================= */
+uint32_t crc32(uint32_t crc, const void * data, size_t size) {
+    const unsigned char * p = data;
+
+    /* table is built on first use ------------------------------------------ */
+    if (table[1] == 0) {
+        uint32_t i, j;
+
+        for (i = 0; i < 256; i++) {
+            uint32_t c = i;
+
+            for (j = 0; j < 8; j++) {
+                c = c & 1 ? 0xedb88320 ^ c >> 1 : c >> 1;
+            }
+
+            table[i] = c;
+        }
+    }
+
+    crc = ~crc;
+
+    while (size--) {
+        crc = table[(crc ^ *p++) & 0xff] ^ crc >> 8;
+    }
+
+    return ~crc;
+}
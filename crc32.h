@@ -0,0 +1,16 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * crc32()
+ *
+ * return the usual CRC-32 (reflected, 0xedb88320, as zlib's) of size bytes of
+ * data, continuing from crc, which is 0 to start with
+ */
+
+uint32_t crc32(uint32_t crc, const void * data, size_t size);
+
+#endif
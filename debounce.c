@@ -0,0 +1,120 @@
+#include "debounce.h"
+
+#include <string.h>
+
+/* private functions ======================================================== */
+static void update_threshold(debounce_t * debounce) {
+    unsigned long long threshold = 0;
+
+    /* a fraction of the mean pulse period, within bounds ------------------ */
+    if (debounce->known) {
+        threshold = debounce->revolution * debounce->permille /
+            (1000ULL * debounce->known);
+    }
+
+    if (threshold < debounce->min) {
+        threshold = debounce->min;
+    }
+
+    if (threshold > debounce->max) {
+        threshold = debounce->max;
+    }
+
+    debounce->threshold = threshold;
+}
+
+/* public functions ========================================================= */
+void debounce_init(
+    debounce_t * debounce, double fraction, unsigned long long min,
+    unsigned long long max, unsigned int pulses
+) {
+    memset(debounce, 0, sizeof *debounce);
+
+    /* the only double operations, once, never on an edge ------------------ */
+    if (!(fraction > 0 && fraction < 1)) {
+        fraction = DEBOUNCE_FRACTION;
+    }
+
+    debounce->permille = fraction * 1000 + 0.5;
+
+    if (debounce->permille == 0) {
+        debounce->permille = 1;
+    }
+
+    debounce->min = min ? min : DEBOUNCE_MIN;
+    debounce->max = max >= debounce->min ? max : DEBOUNCE_MAX;
+
+    if (debounce->max < debounce->min) {
+        debounce->max = debounce->min;
+    }
+
+    /* pulses come that many times as often as rotations, edges too -------- */
+    debounce->pulses = pulses > 0 && pulses <= PULSE_MAX ? pulses : 1;
+    debounce->min /= debounce->pulses;
+    debounce->max /= debounce->pulses;
+    debounce->storm_max = DEBOUNCE_STORM_EDGES * debounce->pulses;
+}
+
+int debounce_edge(debounce_t * debounce, unsigned long long time) {
+    ++debounce->edges;
+
+    /* too many edges for a wheel, this is the wire acting as an antenna ---- */
+    if (time - debounce->storm > DEBOUNCE_STORM_PERIOD) {
+        debounce->storm = time;
+        debounce->storm_edges = 0;
+    }
+
+    if (++debounce->storm_edges > debounce->storm_max) {
+        debounce->storm_edges = 0;
+        debounce->synced = 0;
+        ++debounce->storms;
+
+        return DEBOUNCE_STORM;
+    }
+
+    if (!debounce->synced) {
+        debounce->synced = 1;
+        debounce->trailing = 1;
+        debounce->last = time;
+        debounce->period = 0;
+        debounce->revolution = 0;
+        debounce->known = 0;
+        update_threshold(debounce);
+        ++debounce->accepted;
+
+        return DEBOUNCE_RESYNC;
+    }
+
+    /* no period to tell it by yet, pair it with the pulse instead --------- */
+    if (debounce->trailing) {
+        debounce->trailing = 0;
+        ++debounce->rejected;
+
+        return DEBOUNCE_REJECT;
+    }
+
+    if (time - debounce->last < debounce->threshold) {
+        ++debounce->rejected;
+
+        return DEBOUNCE_REJECT;
+    }
+
+    debounce->period = time - debounce->last;
+    debounce->last = time;
+    ++debounce->accepted;
+
+    /* the oldest period leaves once a rotation of them is known ----------- */
+    if (debounce->known == debounce->pulses) {
+        debounce->revolution -= debounce->periods[debounce->next];
+    }
+    else {
+        ++debounce->known;
+    }
+
+    debounce->periods[debounce->next] = debounce->period;
+    debounce->revolution += debounce->period;
+    debounce->next = (debounce->next + 1) % debounce->pulses;
+    update_threshold(debounce);
+
+    return DEBOUNCE_ACCEPT;
+}
@@ -0,0 +1,99 @@
+#ifndef DEBOUNCE_H
+#define DEBOUNCE_H
+
+#include "pulse.h"
+
+#define DEBOUNCE_FRACTION 0.4
+#define DEBOUNCE_MIN (10ULL * 1000 * 1000)
+#define DEBOUNCE_MAX (500ULL * 1000 * 1000)
+
+#define DEBOUNCE_STORM_EDGES 64
+#define DEBOUNCE_STORM_PERIOD (100ULL * 1000 * 1000)
+#define DEBOUNCE_STORM_MASK (250ULL * 1000 * 1000)
+
+#define DEBOUNCE_REJECT 0
+#define DEBOUNCE_ACCEPT 1
+#define DEBOUNCE_RESYNC 2
+#define DEBOUNCE_STORM 3
+
+typedef struct debounce_t debounce_t;
+
+/*
+ * wheel sensor edge filter, for a wheel giving some pulses per rotation, one
+ * per magnet: an edge is a pulse if it comes at least fraction of the mean
+ * pulse period over the latest rotation after the previous pulse, that
+ * threshold being clamped in between min and max over pulses, so the second
+ * edge of a sensor pulse and wire glitches are rejected at any speed, without
+ * putting a ceiling on it, and unevenly spaced magnets do not matter; with a
+ * single pulse, pulses are rotations
+ *
+ * until a period is known, that is right after the first pulse or the first
+ * one since a storm, the edge following it is taken as the second edge of
+ * that pulse and rejected whenever it comes, as a wide pulse at low speed
+ * would otherwise make it a pulse of its own
+ *
+ * more than DEBOUNCE_STORM_EDGES edges a pulse per rotation within
+ * DEBOUNCE_STORM_PERIOD are an interrupt storm: the caller should mask the
+ * IRQ for DEBOUNCE_STORM_MASK, pulses are then lost, so the next accepted
+ * edge starts over
+ *
+ * times are in ns, counters are owned by the only caller; edges are filtered
+ * in the IRQ task, so fraction is turned into permille once at init, and the
+ * threshold is worked out with integers, once a pulse rather than an edge
+ */
+
+struct debounce_t {
+    unsigned long permille;     /* fraction, in 1/1000 */
+    unsigned long long min;     /* over pulses */
+    unsigned long long max;     /* over pulses */
+    unsigned int pulses;        /* per rotation */
+    unsigned long storm_max;    /* edges per DEBOUNCE_STORM_PERIOD */
+
+    int synced;                 /* is last a pulse we can time from? */
+    int trailing;               /* is next edge the end of last's pulse? */
+    unsigned long long last;    /* latest pulse */
+    unsigned long long threshold; /* from it, for the next one */
+    unsigned long long period;  /* latest pulse period, 0 if unknown */
+    unsigned long long periods[PULSE_MAX]; /* latest ones, a ring */
+    unsigned long long revolution; /* their sum, a rotation of them at most */
+    unsigned int known;         /* periods in ring, since latest resync */
+    unsigned int next;          /* where the next one goes */
+    unsigned long long storm;   /* start of current storm detection period */
+    unsigned long storm_edges;  /* edges since then */
+
+    unsigned long edges;        /* every edge seen */
+    unsigned long accepted;     /* pulses */
+    unsigned long rejected;     /* too close to previous pulse */
+    unsigned long storms;       /* how many times the IRQ should be masked */
+};
+
+/*
+ * debounce_init()
+ *
+ * setup filter for pulses per rotation, 1 if 0 or more than PULSE_MAX, with
+ * zero counters and no pulse seen yet, a zero or out of range parameter gets
+ * its DEBOUNCE_ default; min and max are for a rotation, as fraction is of
+ * one
+ */
+
+void debounce_init(
+    debounce_t * debounce, double fraction, unsigned long long min,
+    unsigned long long max, unsigned int pulses
+);
+
+/*
+ * debounce_edge()
+ *
+ * feed filter with an edge at time
+ *
+ * returns:
+ *  - DEBOUNCE_ACCEPT if edge is a pulse, debounce->period is its period
+ *  - DEBOUNCE_RESYNC if edge is a pulse, but the first one, or the first one
+ *    since a storm, so there is no period to tell
+ *  - DEBOUNCE_REJECT if edge is not a pulse
+ *  - DEBOUNCE_STORM if edge is one too many, IRQ should be masked
+ */
+
+int debounce_edge(debounce_t * debounce, unsigned long long time);
+
+#endif
@@ -0,0 +1,447 @@
+#include "energy.h"
+#include "bus.h"
+#include "ring.h"
+#include "session.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <xenomai/native/task.h>
+#include <xenomai/native/timer.h>
+
+/* constants ================================================================ */
+#define RECORDS_SIZE 256
+#define SAMPLES_SIZE 1024
+#define RAW_MAX 16
+#define REPLAY_LINE_MAX 64
+
+/* types ==================================================================== */
+typedef struct record_t record_t;
+typedef struct source_t source_t;
+
+/* structures =============================================================== */
+struct record_t {
+    RTIME time;
+    long voltage;
+    long current;
+};
+
+/*
+ * where samples come from, opened, read and closed from Linux only: reads go
+ * through Linux syscalls, which a real-time task must not make
+ */
+
+struct source_t {
+    int (* open)(const char * pathname);
+    int (* read)(RTIME time, long * voltage, long * current);
+    void (* close)(void);
+};
+
+/* private variables ======================================================== */
+static int running;
+
+static const char * device;
+static double voltage_setting;
+static double current_setting;
+static unsigned long rate = ENERGY_RATE;
+static unsigned long decimation = ENERGY_DECIMATION;
+
+static bus_channel_t channel;
+static session_writer_t writer;
+static RT_TASK task;
+static RT_TASK task_reader;
+static energy_snapshot_t snapshot;
+
+/* samples from the reader task to the real-time one, and what it missed -- */
+static ring_t ring;
+static record_t samples[SAMPLES_SIZE];
+static volatile unsigned long reader_overruns;
+static volatile unsigned long reader_errors;
+
+static const source_t * source;
+
+/* adc source: one sysfs file per channel, read again from its start ------- */
+static int adc_voltage = -1;
+static int adc_current = -1;
+static long voltage_scale;      /* uV per count */
+static long current_scale;      /* uA per count */
+
+/* replay source: current line, held until the clock reaches the next one - */
+static FILE * replay;
+static record_t replay_current;
+static record_t replay_next;
+static int replay_valid;
+
+/* private functions ======================================================== */
+static int encode(FILE * stream, const void * record) {
+    const record_t * r = record;
+    session_record_t s;
+
+    /* header goes first, once the writer thread owns stream --------------- */
+    if (
+        writer.stream != stream &&
+        session_writer_open(&writer, stream, SESSION_ENERGY) == -1
+    ) {
+        return -1;
+    }
+
+    s.time = r->time;
+    s.voltage = r->voltage;
+    s.current = r->current;
+
+    return session_write(&writer, &s);
+}
+
+static int encode_close(FILE * stream) {
+    int result = session_writer_flush(&writer);
+
+    /* next stream, if the file is split, starts over with a header -------- */
+    writer.stream = NULL;
+
+    (void) stream;
+
+    return result;
+}
+
+static int adc_raw(int fd, long * dest) {
+    char buffer[RAW_MAX];
+    ssize_t n;
+
+    if ((n = pread(fd, buffer, sizeof buffer - 1, 0)) <= 0) {
+        return -1;
+    }
+
+    buffer[n] = '\0';
+    *dest = strtol(buffer, NULL, 10);
+
+    return 0;
+}
+
+static int adc_open(const char * pathname) {
+    char name[PATH_MAX];
+
+    snprintf(name, sizeof name, "%s/in_voltage0_raw", pathname);
+
+    if ((adc_voltage = open(name, O_RDONLY)) == -1) {
+        goto err_voltage;
+    }
+
+    snprintf(name, sizeof name, "%s/in_voltage1_raw", pathname);
+
+    if ((adc_current = open(name, O_RDONLY)) == -1) {
+        goto err_current;
+    }
+
+    /* scales as integers, so samples are integer arithmetic only ---------- */
+    voltage_scale = (voltage_setting > 0 ? voltage_setting : 1) * 1000 + 0.5;
+    current_scale = (current_setting > 0 ? current_setting : 1) * 1000 + 0.5;
+
+    return 0;
+
+err_current:
+    close(adc_voltage);
+
+err_voltage:
+    return -1;
+}
+
+static int adc_read(RTIME time, long * voltage, long * current) {
+    long v, i;
+
+    if (adc_raw(adc_voltage, &v) == -1 || adc_raw(adc_current, &i) == -1) {
+        return -1;
+    }
+
+    *voltage = v * voltage_scale / 1000;
+    *current = i * current_scale / 1000;
+
+    (void) time;
+
+    return 0;
+}
+
+static void adc_close(void) {
+    close(adc_current);
+    close(adc_voltage);
+}
+
+static void replay_line(void) {
+    char line[REPLAY_LINE_MAX];
+
+    replay_valid = 0;
+
+    while (fgets(line, sizeof line, replay) != NULL) {
+        if (
+            sscanf(
+                line, "%llu,%ld,%ld", &replay_next.time, &replay_next.voltage,
+                &replay_next.current
+            ) == 3
+        ) {
+            replay_valid = 1;
+            return;
+        }
+    }
+}
+
+static int replay_open(const char * pathname) {
+    if ((replay = fopen(pathname, "r")) == NULL) {
+        return -1;
+    }
+
+    memset(&replay_current, 0, sizeof replay_current);
+    replay_line();
+
+    return 0;
+}
+
+static int replay_read(RTIME time, long * voltage, long * current) {
+    /* every line the clock went past, the latest one holds ---------------- */
+    while (replay_valid && replay_next.time <= time) {
+        replay_current = replay_next;
+        replay_line();
+    }
+
+    *voltage = replay_current.voltage;
+    *current = replay_current.current;
+
+    return 0;
+}
+
+static void replay_close(void) {
+    fclose(replay);
+}
+
+static const source_t adc_source = {
+    .open = adc_open,
+    .read = adc_read,
+    .close = adc_close
+};
+
+static const source_t replay_source = {
+    .open = replay_open,
+    .read = replay_read,
+    .close = replay_close
+};
+
+static void task_reader_routine(void * cookie) {
+    record_t sample;
+
+    rt_task_set_periodic(NULL, TM_NOW, 1000000000ULL / rate);
+
+    while (1) {
+        unsigned long overruns = 0;
+
+        /* a late release still samples once, the integral spans the gap -- */
+        if (rt_task_wait_period(&overruns) == -ETIMEDOUT) {
+            reader_overruns += overruns;
+        }
+
+        sample.time = rt_timer_read();
+
+        if (
+            source->read(sample.time, &sample.voltage, &sample.current) == -1
+        ) {
+            ++reader_errors;
+            continue;
+        }
+
+        /* hand it to the real-time task, a full ring drops it and counts it */
+        ring_push(&ring, &sample);
+    }
+
+    (void) cookie;
+}
+
+static void task_routine(void * cookie) {
+    long long voltage_sum = 0; /* over the samples of the current mean */
+    long long current_sum = 0;
+    long long power_sum = 0;
+    long long residue = 0;     /* energy not yet a whole nJ (in pJ / 2) */
+    unsigned long n = 0;       /* samples in the current mean */
+    unsigned long drain;       /* sample periods in between two drains */
+    long power_prev = 0;
+    RTIME time_prev = 0;
+    record_t record, sample;
+
+    /* wake up once a mean, or often enough that the ring never fills ------ */
+    drain = decimation < SAMPLES_SIZE / 4 ? decimation : SAMPLES_SIZE / 4;
+    rt_task_set_periodic(NULL, TM_NOW, 1000000000ULL / rate * drain);
+
+    while (1) {
+        long voltage, current, power;
+        RTIME time_curr;
+
+        /* whatever the reader task took since the previous period, at once */
+        if (ring_pop(&ring, &sample) == -1) {
+            rt_task_wait_period(NULL);
+            continue;
+        }
+
+        time_curr = sample.time;
+        voltage = sample.voltage;
+        current = sample.current;
+
+        snapshot.overruns = reader_overruns;
+        snapshot.errors = reader_errors;
+
+        power = (long long) voltage * current / 1000;
+
+        /*
+           Let's integrate power. Samples are not quite evenly spaced, so
+           each one adds the trapeze from the previous one, twice its area
+           in mW times ns, that is pJ; what does not make a whole nJ is kept
+           for the next one, so nothing is lost to rounding, however long we
+           run.
+        */
+        if (snapshot.samples > 0) {
+            residue +=
+                ((long long) power_prev + power) *
+                (long long) (time_curr - time_prev);
+            snapshot.energy += residue / 2000;
+            residue %= 2000;
+        }
+
+        power_prev = power;
+        time_prev = time_curr;
+        ++snapshot.samples;
+
+        voltage_sum += voltage;
+        current_sum += current;
+        power_sum += power;
+
+        if (++n < decimation) {
+            continue;
+        }
+
+        /* every decimation samples, their means go out at once ------------ */
+        snapshot.voltage = voltage_sum / (long long) n;
+        snapshot.current = current_sum / (long long) n;
+        snapshot.power = power_sum / (long long) n;
+        snapshot.time = time_curr;
+
+        record.time = time_curr;
+        record.voltage = snapshot.voltage;
+        record.current = snapshot.current;
+
+        bus_publish(&channel, time_curr, &snapshot, &record);
+
+        voltage_sum = 0;
+        current_sum = 0;
+        power_sum = 0;
+        n = 0;
+    }
+
+    (void) cookie;
+}
+
+static void save_sampling(const char * pathname) {
+    FILE * fp;
+
+    if ((fp = fopen(pathname, "w")) == NULL) {
+        return;
+    }
+
+    fprintf(
+        fp, "%lu samples at %lu Hz, %lu overruns, %lu errors, %.3f Wh\n",
+        snapshot.samples, rate, reader_overruns, reader_errors,
+        (double) snapshot.energy / ENERGY_NJ_PER_WH
+    );
+
+    fprintf(
+        fp, "%lu/%lu high water, %lu dropped\n", ring.high_water, ring.count,
+        ring.dropped
+    );
+
+    fclose(fp);
+}
+
+/* public functions ========================================================= */
+void energy_set_source(
+    const char * pathname, double voltage_scale, double current_scale
+) {
+    device = pathname;
+    voltage_setting = voltage_scale;
+    current_setting = current_scale;
+}
+
+void energy_set_rate(unsigned long sample_rate, unsigned long samples) {
+    rate = sample_rate ? sample_rate : ENERGY_RATE;
+    rate = rate < ENERGY_RATE_MAX ? rate : ENERGY_RATE_MAX;
+    decimation = samples ? samples : ENERGY_DECIMATION;
+}
+
+int energy_init(void) {
+    struct stat st;
+
+    if (running) {
+        goto err_running;
+    }
+
+    /* an ADC is a directory of channels, anything else is a recording ----- */
+    if (device == NULL || stat(device, &st) == -1) {
+        goto err_source;
+    }
+
+    source = S_ISDIR(st.st_mode) ? &adc_source : &replay_source;
+
+    if (source->open(device) == -1) {
+        goto err_source;
+    }
+
+    writer.stream = NULL;
+
+    if (
+        bus_open(
+            &channel, BUS_ENERGY, sizeof (energy_snapshot_t), "energy.bin",
+            encode, encode_close, sizeof (record_t), RECORDS_SIZE
+        ) == -1
+    ) {
+        goto err_channel;
+    }
+
+    memset(&snapshot, 0, sizeof snapshot);
+    ring_init(&ring, samples, sizeof *samples, SAMPLES_SIZE);
+    reader_overruns = 0;
+    reader_errors = 0;
+
+    /* source I/O in a priority 0 task, which lives in Linux (secondary mode)
+       and may make syscalls, arithmetic in a real-time one, which never
+       leaves Xenomai (primary mode) ------------------------------------ */
+    rt_task_spawn(&task, NULL, 0, 70, 0, task_routine, NULL);
+    rt_task_spawn(&task_reader, NULL, 0, 0, 0, task_reader_routine, NULL);
+
+    running = 1;
+
+    return 0;
+
+err_channel:
+    source->close();
+
+err_source:
+err_running:
+    return -1;
+}
+
+int energy_exit(void) {
+    if (!running) {
+        goto err_not_running;
+    }
+
+    running = 0;
+
+    rt_task_delete(&task_reader);
+    rt_task_delete(&task);
+    source->close();
+
+    save_sampling("sampling");
+
+    return 0;
+
+err_not_running:
+    return -1;
+}
@@ -0,0 +1,87 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#define ENERGY_RATE 1000        /* Hz, samples taken by default */
+#define ENERGY_RATE_MAX 10000   /* Hz */
+#define ENERGY_DECIMATION 10    /* samples per published and logged mean */
+
+#define ENERGY_NJ_PER_WH 3600000000000LL
+
+typedef struct energy_snapshot_t energy_snapshot_t;
+
+struct energy_snapshot_t {
+    long voltage;            /* battery, mean of the latest samples (in mV) */
+    long current;            /* motor, mean of them, < 0 charging (in mA) */
+    long power;              /* mean of their products (in mW) */
+    long long energy;        /* integrated since the first sample (in nJ) */
+    unsigned long samples;   /* taken since init */
+    unsigned long overruns;  /* sample periods missed since init */
+    unsigned long errors;    /* samples the source could not give */
+    unsigned long long time; /* latest sample timestamp (in ns) */
+};
+
+/*
+ * energy_set_source()
+ *
+ * set where samples come from, from next energy_init() on:
+ *
+ *  - an IIO ADC device directory (/sys/bus/iio/devices/iio:deviceN), battery
+ *    voltage on in_voltage0_raw and motor current on in_voltage1_raw, scaled
+ *    by voltage_scale (in mV per count) and current_scale (in mA per count),
+ *    0 for 1
+ *  - any other file is replayed: "time,voltage,current" lines, in ns, mV and
+ *    mA, as tools/session prints an "energy.bin" file, each value held until
+ *    the clock reaches the next line
+ */
+
+void energy_set_source(
+    const char * pathname, double voltage_scale, double current_scale
+);
+
+/*
+ * energy_set_rate()
+ *
+ * set how many samples are taken per second, and how many of them make one
+ * published and logged mean, from next energy_init() on, 0 for ENERGY_RATE
+ * and ENERGY_DECIMATION; rate never goes above ENERGY_RATE_MAX
+ */
+
+void energy_set_rate(unsigned long rate, unsigned long decimation);
+
+/*
+ * energy_init()
+ *
+ * start energy sensor threads: a periodic priority 0 task samples voltage
+ * and current, as reading the source takes Linux syscalls, and queues them
+ * in a preallocated ring (see ring.h); a periodic real-time task, which
+ * never leaves primary mode, drains it once a mean, integrates their product
+ * into energy, sample after sample, and every decimation samples, publishes
+ * their means as an energy_snapshot_t to the BUS_ENERGY channel (see bus.h)
+ * and logs them to a "./energy.bin" binary session file (see session.h),
+ * whatever logger_set_binary() says, as text would be far bigger; samples
+ * are stamped when taken, so their timing is as good as Linux scheduling,
+ * an RTDM ADC driver would be needed for better; bus_init() must have been
+ * called
+ *
+ * returns -1 if:
+ *  - energy sensor thread is already running
+ *  - source could not be opened
+ *  - BUS_ENERGY channel could not be opened
+ */
+
+int energy_init(void);
+
+/*
+ * energy_exit()
+ *
+ * stop energy sensor threads, and save sample, overrun and error counts, the
+ * energy used, and sample ring counters in a "./sampling" text file,
+ * "./energy.bin" file is closed by logger_exit()
+ *
+ * returns -1 if:
+ *  - energy sensor thread is not running
+ */
+
+int energy_exit(void);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+/*
+ * fixed point units for the hot paths: the target is soft-float, so every
+ * double operation there is a libgcc call; coordinates are kept as long
+ * micro-degrees (within 0.11 m) and speeds as mm/s (within 0.004 km/h), and
+ * only config values, text files, display and host tools go through doubles
+ */
+
+#define FIXED_DEGREE 1000000L   /* micro-degrees per degree */
+
+/* degrees to micro-degrees, rounded to nearest */
+#define FIXED_FROM_DEGREES(x) ((long) ((x) * 1e6 + ((x) < 0 ? -0.5 : 0.5)))
+
+/* micro-degrees to degrees */
+#define FIXED_TO_DEGREES(x) ((x) / 1e6)
+
+/* km/h to mm/s, rounded to nearest */
+#define FIXED_FROM_KMH(x) ((long) ((x) / 3.6e-3 + ((x) < 0 ? -0.5 : 0.5)))
+
+/* mm/s to km/h */
+#define FIXED_TO_KMH(x) ((x) * 3.6e-3)
+
+/* mm/s to tenths of km/h, rounded to nearest, for display */
+#define FIXED_TO_DECIKMH(x) (((x) * 36 + 500) / 1000)
+
+/*
+ * fixed_mms()
+ *
+ * speed (in mm/s) of length mm travelled in period ns, rounded to nearest,
+ * with integer arithmetic only; 0 if period is 0
+ */
+
+static inline unsigned long fixed_mms(
+    unsigned long long length, unsigned long long period
+) {
+    if (period == 0) {
+        return 0;
+    }
+
+    /* mm/s = mm * 10^9 / ns, half a period more rounds to nearest --------- */
+    return (length * 1000000000ULL + period / 2) / period;
+}
+
+/*
+ * fixed_div()
+ *
+ * num / den rounded to nearest, halves away from 0, with integer arithmetic
+ * only; den must be positive
+ */
+
+static inline long long fixed_div(long long num, long long den) {
+    return (num < 0 ? num - den / 2 : num + den / 2) / den;
+}
+
+#endif
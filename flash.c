@@ -0,0 +1,153 @@
+#define _GNU_SOURCE
+
+#include "flash.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* private functions ======================================================== */
+static unsigned long long now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int write_chunk(flash_file_t * file) {
+    unsigned long long begin = now();
+
+    /* grow by whole extents ahead of the data, best effort: vfat keeps the
+       size as is, and gives back what was not used at close -------------- */
+    while (file->offset + FLASH_CHUNK > file->allocated) {
+        fallocate(
+            file->fd, FALLOC_FL_KEEP_SIZE, file->allocated, FLASH_EXTENT
+        );
+        file->allocated += FLASH_EXTENT;
+    }
+
+    /* only what the file does not hold yet, from where it stops --------- */
+    while (file->flushed < file->fill) {
+        ssize_t n = pwrite(
+            file->fd, file->chunk + file->flushed, file->fill - file->flushed,
+            file->offset + file->flushed
+        );
+
+        if (n <= 0) {
+            file->write_time += now() - begin;
+            ++file->errors;
+            return -1;
+        }
+
+        file->flushed += n;
+        file->bytes += n;
+    }
+
+    file->write_time += now() - begin;
+    ++file->writes;
+
+    /* a whole chunk is done with, the next one starts right after --------- */
+    if (file->fill == FLASH_CHUNK) {
+        file->offset += FLASH_CHUNK;
+        file->fill = 0;
+        file->flushed = 0;
+    }
+
+    return 0;
+}
+
+/* public functions ========================================================= */
+int flash_open(
+    flash_file_t * file, const char * pathname, void * chunk,
+    histogram_t * latency
+) {
+    memset(file, 0, sizeof *file);
+
+    file->fd = open(pathname, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+    if (file->fd == -1) {
+        return -1;
+    }
+
+    file->chunk = chunk;
+    file->latency = latency;
+
+    return 0;
+}
+
+unsigned long long flash_size(const flash_file_t * file) {
+    return file->offset + file->fill;
+}
+
+int flash_write(flash_file_t * file, const void * data, size_t size) {
+    const unsigned char * p = data;
+
+    while (size > 0) {
+        size_t n;
+
+        /* a chunk the medium refused goes first, nothing fits until then -- */
+        if (file->fill == FLASH_CHUNK && write_chunk(file) == -1) {
+            return -1;
+        }
+
+        n = FLASH_CHUNK - file->fill;
+
+        if (n > size) {
+            n = size;
+        }
+
+        memcpy(file->chunk + file->fill, p, n);
+        file->fill += n;
+        p += n;
+        size -= n;
+
+        /* a whole chunk, off it goes, or it is tried again next time ------ */
+        if (file->fill == FLASH_CHUNK) {
+            write_chunk(file);
+        }
+    }
+
+    return 0;
+}
+
+int flash_flush(flash_file_t * file) {
+    if (file->flushed == file->fill) {
+        return 0;
+    }
+
+    /* chunk stays buffered, only the rest of it will be appended later ---- */
+    return write_chunk(file);
+}
+
+int flash_sync(flash_file_t * file) {
+    unsigned long long begin = now();
+
+    if (flash_flush(file) == -1 || fdatasync(file->fd) == -1) {
+        return -1;
+    }
+
+    if (file->latency != NULL) {
+        histogram_record(file->latency, now() - begin);
+    }
+
+    ++file->syncs;
+
+    return 0;
+}
+
+int flash_close(flash_file_t * file) {
+    int result = flash_sync(file);
+
+    /* same size, which drops preallocated blocks past the end ------------- */
+    if (ftruncate(file->fd, flash_size(file)) == -1) {
+        result = -1;
+    }
+
+    if (close(file->fd) == -1) {
+        result = -1;
+    }
+
+    return result;
+}
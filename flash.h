@@ -0,0 +1,115 @@
+#ifndef FLASH_H
+#define FLASH_H
+
+#include "histogram.h"
+
+#include <stddef.h>
+
+#define FLASH_CHUNK 32768       /* bytes, written at once, aligned to it */
+#define FLASH_EXTENT (4 << 20)  /* bytes, preallocated at once */
+
+typedef struct flash_file_t flash_file_t;
+
+/*
+ * flash friendly file writer: bytes are gathered in a FLASH_CHUNK buffer,
+ * which goes to the file once full, ending on a FLASH_CHUNK aligned offset,
+ * so in between flushes the medium sees large aligned writes; the file is
+ * preallocated FLASH_EXTENT at a time, so it does not fragment as it grows
+ *
+ * until flushed, what is in the buffer is not in the file: flushing appends
+ * what the file does not hold yet of the partial chunk, which stays buffered,
+ * and is completed later by appending only the rest of it, so no byte goes to
+ * the medium twice; syncing also waits until the medium has it, what happens
+ * after is what a power cut can lose
+ *
+ * a chunk the medium refuses stays buffered, and is tried again by the next
+ * write or flush, data that does not fit in the meantime is lost
+ */
+
+struct flash_file_t {
+    int fd;
+    unsigned char * chunk;          /* FLASH_CHUNK bytes, aligned */
+    size_t fill;                    /* bytes in chunk */
+    size_t flushed;                 /* bytes of chunk already in file */
+    unsigned long long offset;      /* where chunk goes in file */
+    unsigned long long allocated;   /* bytes preallocated */
+    histogram_t * latency;          /* sync latency (in ns), if any */
+
+    unsigned long long bytes;       /* handed to the medium */
+    unsigned long long write_time;  /* ns spent handing them */
+    unsigned long writes;
+    unsigned long syncs;
+    unsigned long errors;           /* writes the medium refused */
+};
+
+/*
+ * flash_size()
+ *
+ * returns how many bytes were written to file so far, buffered ones too
+ */
+
+unsigned long long flash_size(const flash_file_t * file);
+
+/*
+ * flash_open()
+ *
+ * create or truncate pathname file, to write through chunk, FLASH_CHUNK bytes
+ * aligned to FLASH_CHUNK, which must stay valid until flash_close(); sync
+ * latencies are recorded to latency, unless it is NULL
+ *
+ * returns -1 if:
+ *  - pathname file could not be opened for writing
+ */
+
+int flash_open(
+    flash_file_t * file, const char * pathname, void * chunk,
+    histogram_t * latency
+);
+
+/*
+ * flash_write()
+ *
+ * append size bytes of data to file, writing every chunk they complete
+ *
+ * returns -1 if:
+ *  - a chunk could not be written and is still buffered, data past it is
+ *    lost
+ */
+
+int flash_write(flash_file_t * file, const void * data, size_t size);
+
+/*
+ * flash_flush()
+ *
+ * append what the file does not hold yet of the chunk, so it holds
+ * everything written so far
+ *
+ * returns -1 if:
+ *  - chunk could not be written, it stays buffered
+ */
+
+int flash_flush(flash_file_t * file);
+
+/*
+ * flash_sync()
+ *
+ * flush file, then wait until the medium holds it
+ *
+ * returns -1 if:
+ *  - file could not be flushed or synced
+ */
+
+int flash_sync(flash_file_t * file);
+
+/*
+ * flash_close()
+ *
+ * sync and close file, preallocated space past its end is released
+ *
+ * returns -1 if:
+ *  - file could not be synced or closed
+ */
+
+int flash_close(flash_file_t * file);
+
+#endif
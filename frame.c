@@ -0,0 +1,127 @@
+#include "frame.h"
+#include "crc32.h"
+
+#include <string.h>
+
+/* constants ================================================================ */
+#define SYNC_0 0xe7
+#define SYNC_1 0x7e
+#define CRC_OFFSET (FRAME_SIZE - 4)
+
+/* private functions ======================================================== */
+static void put_u16(unsigned char * p, unsigned long x) {
+    p[0] = x;
+    p[1] = x >> 8;
+}
+
+static void put_u32(unsigned char * p, uint32_t x) {
+    p[0] = x;
+    p[1] = x >> 8;
+    p[2] = x >> 16;
+    p[3] = x >> 24;
+}
+
+static unsigned int get_u16(const unsigned char * p) {
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t get_u32(const unsigned char * p) {
+    return p[0] | p[1] << 8 | (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static long clamp(long x, long min, long max) {
+    return x < min ? min : x > max ? max : x;
+}
+
+static void resync(frame_scanner_t * scanner, size_t from) {
+    size_t i;
+
+    /* next byte which may start a frame, with what follows, if anything --- */
+    for (i = from; i < scanner->size; i++) {
+        if (
+            scanner->buffer[i] == SYNC_0 &&
+            (i + 1 == scanner->size || scanner->buffer[i + 1] == SYNC_1)
+        ) {
+            break;
+        }
+    }
+
+    memmove(scanner->buffer, scanner->buffer + i, scanner->size - i);
+    scanner->size -= i;
+    scanner->skipped += i;
+}
+
+/* public functions ========================================================= */
+void frame_pack(const frame_t * frame, unsigned char * dest) {
+    dest[0] = SYNC_0;
+    dest[1] = SYNC_1;
+    dest[2] = FRAME_VERSION;
+    dest[3] = frame->flags;
+    put_u16(dest + 4, frame->sequence);
+    put_u32(dest + 6, frame->time);
+    put_u16(dest + 10, clamp(frame->instant, 0, 0xffff));
+    put_u16(dest + 12, clamp(frame->average, 0, 0xffff));
+    put_u32(dest + 14, frame->rotations);
+    put_u32(dest + 18, frame->latitude);
+    put_u32(dest + 22, frame->longitude);
+    dest[26] = clamp(frame->quality, 0, 0xff);
+    dest[27] = clamp(frame->satellites, 0, 0xff);
+    put_u16(dest + 28, clamp(frame->sector, -0x8000, 0x7fff));
+    put_u16(dest + 30, clamp(frame->power, -0x8000, 0x7fff));
+    put_u32(dest + 32, frame->energy);
+    put_u16(dest + 36, frame->frames);
+    put_u16(dest + 38, frame->errors);
+    put_u32(dest + CRC_OFFSET, crc32(0, dest, CRC_OFFSET));
+}
+
+int frame_unpack(const unsigned char * data, frame_t * dest) {
+    if (
+        data[0] != SYNC_0 || data[1] != SYNC_1 || data[2] != FRAME_VERSION ||
+        crc32(0, data, CRC_OFFSET) != get_u32(data + CRC_OFFSET)
+    ) {
+        return -1;
+    }
+
+    dest->flags = data[3];
+    dest->sequence = get_u16(data + 4);
+    dest->time = get_u32(data + 6);
+    dest->instant = get_u16(data + 10);
+    dest->average = get_u16(data + 12);
+    dest->rotations = get_u32(data + 14);
+    dest->latitude = (int32_t) get_u32(data + 18);
+    dest->longitude = (int32_t) get_u32(data + 22);
+    dest->quality = data[26];
+    dest->satellites = data[27];
+    dest->sector = (int16_t) get_u16(data + 28);
+    dest->power = (int16_t) get_u16(data + 30);
+    dest->energy = (int32_t) get_u32(data + 32);
+    dest->frames = get_u16(data + 36);
+    dest->errors = get_u16(data + 38);
+
+    return 0;
+}
+
+int frame_scan(frame_scanner_t * scanner, unsigned char c, frame_t * dest) {
+    scanner->buffer[scanner->size++] = c;
+
+    /* not a frame start (yet), drop what cannot be one -------------------- */
+    if (scanner->size <= 2) {
+        resync(scanner, 0);
+        return 0;
+    }
+
+    if (scanner->size < FRAME_SIZE) {
+        return 0;
+    }
+
+    if (frame_unpack(scanner->buffer, dest) == -1) {
+        /* corrupt, the next frame may start anywhere in it ---------------- */
+        resync(scanner, 1);
+        return 0;
+    }
+
+    scanner->size = 0;
+    ++scanner->frames;
+
+    return 1;
+}
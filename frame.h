@@ -0,0 +1,93 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FRAME_VERSION 1
+#define FRAME_SIZE 44
+
+#define FRAME_SPEED 0x1         /* flags, what the frame has */
+#define FRAME_FIX 0x2
+#define FRAME_ENERGY 0x4
+
+typedef struct frame_t frame_t;
+typedef struct frame_scanner_t frame_scanner_t;
+
+/*
+ * live telemetry frame, FRAME_SIZE bytes, fixed layout, little endian:
+ *
+ *   0  sync (0xe7, 0x7e), version, flags
+ *   4  sequence, u16, one more every frame sent
+ *   6  time, u32 (ms), on the sensors timebase
+ *  10  instant and average speed, u16 each (mm/s)
+ *  14  rotations, u32
+ *  18  latitude and longitude, i32 each (micro-degrees)
+ *  26  fix quality and satellites, u8 each
+ *  28  sector, i16, -1 when none
+ *  30  power, i16 (W), < 0 charging
+ *  32  energy, i32 (1/100 Wh)
+ *  36  GGA sentences and corrupt sentences, u16 each, wrapping
+ *  40  CRC-32 (see crc32.h) of all that
+ *
+ * a frame stands on its own, so a lost one is only missing from the
+ * sequence, and a corrupt one is caught by its CRC; over a byte stream,
+ * frames are found back by their sync bytes
+ */
+
+struct frame_t {
+    unsigned int flags;
+    unsigned int sequence;
+    unsigned long time;
+    unsigned int instant;
+    unsigned int average;
+    unsigned long rotations;
+    long latitude;
+    long longitude;
+    unsigned int quality;
+    unsigned int satellites;
+    int sector;
+    int power;
+    long energy;
+    unsigned int frames;
+    unsigned int errors;
+};
+
+struct frame_scanner_t {
+    unsigned char buffer[FRAME_SIZE];
+    size_t size;                /* bytes in buffer */
+    unsigned long frames;       /* decoded so far */
+    unsigned long skipped;      /* stray or corrupt bytes */
+};
+
+/*
+ * frame_pack()
+ *
+ * write frame to dest, FRAME_SIZE bytes, values out of range saturate
+ */
+
+void frame_pack(const frame_t * frame, unsigned char * dest);
+
+/*
+ * frame_unpack()
+ *
+ * read a FRAME_SIZE bytes frame from data to dest
+ *
+ * returns -1 if:
+ *  - sync, version or CRC is wrong
+ */
+
+int frame_unpack(const unsigned char * data, frame_t * dest);
+
+/*
+ * frame_scan()
+ *
+ * feed scanner with byte c, from a byte stream such as a serial link,
+ * scanner must be zeroed to start with
+ *
+ * returns 1 and writes it to dest, once a whole valid frame is read, else 0
+ */
+
+int frame_scan(frame_scanner_t * scanner, unsigned char c, frame_t * dest);
+
+#endif
@@ -0,0 +1,225 @@
+#include "fusion.h"
+
+#include <string.h>
+
+/* private functions ======================================================== */
+static int valid(const nmea_fix_t * fix) {
+    return fix->quality == 1 || fix->quality == 2;
+}
+
+static double ratio(
+    unsigned long long time, unsigned long long begin, unsigned long long end
+) {
+    double k;
+
+    if (end <= begin) {
+        return 1;
+    }
+
+    /* forced merges may bring times slightly out of order, clamp them ----- */
+    k = (double) (long long) (time - begin) / (end - begin);
+
+    return k < 0 ? 0 : k > 1 ? 1 : k;
+}
+
+static void output_fix(fusion_t * fusion, double distance) {
+    fusion->fix.distance = distance;
+    fusion->fix.speed = fusion->speed;
+    fusion->fix_waiting = 0;
+    fusion->output(fusion->cookie, &fusion->fix);
+}
+
+static void output_waiting(fusion_t * fusion, const fusion_point_t * after) {
+    const fusion_point_t * before = &fusion->located_fix;
+    int interpolate =
+        after != NULL && fusion->located &&
+        after->time - before->time <= FUSION_GAP;
+
+    /* every waiting rotation lies in between before and after ------------ */
+    while (fusion->waiting_count) {
+        fusion_point_t * point = &fusion->waiting[fusion->waiting_head];
+
+        if (interpolate) {
+            double k = ratio(point->time, before->time, after->time);
+
+            point->positioned = 1;
+            point->latitude =
+                before->latitude + k * (after->latitude - before->latitude);
+            point->longitude =
+                before->longitude + k * (after->longitude - before->longitude);
+        }
+
+        fusion->output(fusion->cookie, point);
+        fusion->waiting_head = (fusion->waiting_head + 1) % FUSION_ROTATIONS;
+        --fusion->waiting_count;
+    }
+}
+
+static void merge_rotation(
+    fusion_t * fusion, const fusion_rotation_t * input
+) {
+    fusion_point_t * point;
+    double distance, period;
+    unsigned long n;
+
+    /* the first one only tells where distance starts ---------------------- */
+    if (!fusion->started) {
+        fusion->started = 1;
+        fusion->rotation_time = input->time;
+        fusion->rotation_count = input->rotations;
+    }
+
+    n = input->rotations - fusion->rotation_count;
+    distance = n * fusion->wheel_length;
+    period = (input->time - fusion->rotation_time) / 1e9;
+
+    if (n > 0 && period > 0) {
+        fusion->speed = distance / period;
+    }
+
+    /* a fix came during this rotation, it went that far into it ----------- */
+    if (fusion->fix_waiting) {
+        output_fix(
+            fusion,
+            fusion->distance +
+            ratio(fusion->fix.time, fusion->rotation_time, input->time) *
+            distance
+        );
+    }
+
+    fusion->distance += distance;
+    fusion->rotation_time = input->time;
+    fusion->rotation_count = input->rotations;
+
+    /* full, the oldest one will never know where it was -------------------- */
+    if (fusion->waiting_count == FUSION_ROTATIONS) {
+        fusion->output(fusion->cookie, &fusion->waiting[fusion->waiting_head]);
+        fusion->waiting_head = (fusion->waiting_head + 1) % FUSION_ROTATIONS;
+        --fusion->waiting_count;
+    }
+
+    point = &fusion->waiting[
+        (fusion->waiting_head + fusion->waiting_count++) % FUSION_ROTATIONS
+    ];
+    memset(point, 0, sizeof *point);
+    point->source = FUSION_ROTATION;
+    point->time = input->time;
+    point->distance = fusion->distance;
+    point->speed = fusion->speed;
+}
+
+static void merge_fix(fusion_t * fusion, const fusion_point_t * input) {
+    /* no rotation since the previous fix, the vehicle did not move --------- */
+    if (fusion->fix_waiting) {
+        output_fix(fusion, fusion->distance);
+    }
+
+    if (valid(&input->fix)) {
+        output_waiting(fusion, input);
+        fusion->located_fix = *input;
+        fusion->located = 1;
+    }
+
+    fusion->fix = *input;
+    fusion->fix_waiting = 1;
+}
+
+static void merge(fusion_t * fusion, int flush) {
+    /* earliest first, as long as the other input cannot come before it ---- */
+    while (fusion->rotations_count || fusion->fixes_count) {
+        fusion_rotation_t * rotation =
+            &fusion->rotations[fusion->rotations_head];
+        fusion_point_t * fix = &fusion->fixes[fusion->fixes_head];
+        int take_rotation;
+
+        if (fusion->rotations_count && fusion->fixes_count) {
+            take_rotation = rotation->time <= fix->time;
+        }
+        else if (
+            flush ||
+            fusion->rotations_count == FUSION_ROTATIONS ||
+            fusion->fixes_count == FUSION_FIXES
+        ) {
+            take_rotation = fusion->rotations_count != 0;
+        }
+        else {
+            break;
+        }
+
+        if (take_rotation) {
+            merge_rotation(fusion, rotation);
+            fusion->rotations_head =
+                (fusion->rotations_head + 1) % FUSION_ROTATIONS;
+            --fusion->rotations_count;
+        }
+        else {
+            merge_fix(fusion, fix);
+            fusion->fixes_head = (fusion->fixes_head + 1) % FUSION_FIXES;
+            --fusion->fixes_count;
+        }
+    }
+}
+
+/* public functions ========================================================= */
+void fusion_init(
+    fusion_t * fusion, unsigned int wheel_length, fusion_output_t output,
+    void * cookie
+) {
+    memset(fusion, 0, sizeof *fusion);
+
+    fusion->wheel_length = wheel_length / 1000.0;
+    fusion->output = output;
+    fusion->cookie = cookie;
+}
+
+void fusion_rotation(
+    fusion_t * fusion, unsigned long long time, unsigned long rotations
+) {
+    fusion_rotation_t * rotation;
+
+    if (fusion->rotations_count == FUSION_ROTATIONS) {
+        merge(fusion, 0);
+    }
+
+    rotation = &fusion->rotations[
+        (fusion->rotations_head + fusion->rotations_count++) %
+        FUSION_ROTATIONS
+    ];
+    rotation->time = time;
+    rotation->rotations = rotations;
+
+    merge(fusion, 0);
+}
+
+void fusion_fix(
+    fusion_t * fusion, unsigned long long time, const nmea_fix_t * fix
+) {
+    fusion_point_t * point;
+
+    if (fusion->fixes_count == FUSION_FIXES) {
+        merge(fusion, 0);
+    }
+
+    point = &fusion->fixes[
+        (fusion->fixes_head + fusion->fixes_count++) % FUSION_FIXES
+    ];
+    memset(point, 0, sizeof *point);
+    point->source = FUSION_FIX;
+    point->time = time;
+    point->positioned = valid(fix);
+    point->latitude = FIXED_TO_DEGREES(fix->latitude);
+    point->longitude = FIXED_TO_DEGREES(fix->longitude);
+    point->fix = *fix;
+
+    merge(fusion, 0);
+}
+
+void fusion_flush(fusion_t * fusion) {
+    merge(fusion, 1);
+
+    if (fusion->fix_waiting) {
+        output_fix(fusion, fusion->distance);
+    }
+
+    output_waiting(fusion, NULL);
+}
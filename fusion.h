@@ -0,0 +1,124 @@
+#ifndef FUSION_H
+#define FUSION_H
+
+#include "nmea.h"
+
+#define FUSION_ROTATIONS 256
+#define FUSION_FIXES 8
+#define FUSION_GAP (3ULL * 1000 * 1000 * 1000)
+
+#define FUSION_ROTATION 1
+#define FUSION_FIX 2
+
+typedef struct fusion_point_t fusion_point_t;
+typedef struct fusion_rotation_t fusion_rotation_t;
+typedef struct fusion_t fusion_t;
+
+typedef void (* fusion_output_t)(void * cookie, const fusion_point_t * point);
+
+/*
+ * streaming merge of wheel rotations and GPS fixes, both timestamped by
+ * rt_timer_read(), into a single track: each rotation gets a position,
+ * interpolated in between the valid fixes received before and after it, each
+ * fix gets the distance travelled, interpolated in between the rotations
+ * before and after it, and the wheel speed of that rotation
+ *
+ * rotations and fixes are each fed in their own time order, but may come in
+ * any order with respect to each other, points are output in time order once
+ * what comes after them is known, so about a fix period late; memory is
+ * bounded: when a queue is full its oldest entry is taken as is, a rotation
+ * then goes out without a position, as one with no valid fix before it or no
+ * valid fix less than FUSION_GAP after the one before it
+ */
+
+struct fusion_point_t {
+    int source;                 /* FUSION_ROTATION or FUSION_FIX */
+    unsigned long long time;    /* rotation end or fix reception (in ns) */
+    int positioned;             /* are latitude and longitude known? */
+    double latitude;            /* degrees */
+    double longitude;
+    double distance;            /* since first rotation (in m) */
+    double speed;               /* over the latest rotation (in m/s) */
+    nmea_fix_t fix;             /* FUSION_FIX only */
+};
+
+struct fusion_rotation_t {
+    unsigned long long time;
+    unsigned long rotations;    /* since start */
+};
+
+struct fusion_t {
+    double wheel_length;        /* m */
+    fusion_output_t output;
+    void * cookie;
+
+    /* inputs not merged yet, oldest first */
+    fusion_rotation_t rotations[FUSION_ROTATIONS];
+    unsigned long rotations_head;
+    unsigned long rotations_count;
+    fusion_point_t fixes[FUSION_FIXES];
+    unsigned long fixes_head;
+    unsigned long fixes_count;
+
+    /* merged rotations, waiting for the next valid fix */
+    fusion_point_t waiting[FUSION_ROTATIONS];
+    unsigned long waiting_head;
+    unsigned long waiting_count;
+
+    /* merged fix, waiting for the next rotation */
+    fusion_point_t fix;
+    int fix_waiting;
+
+    /* latest merged rotation, and valid fix */
+    int started;
+    unsigned long long rotation_time;
+    unsigned long rotation_count;
+    double distance;
+    double speed;
+    int located;
+    fusion_point_t located_fix;
+};
+
+/*
+ * fusion_init()
+ *
+ * setup fusion for a wheel_length mm wheel, output will be called with every
+ * point of the track, from fusion_rotation(), fusion_fix() or fusion_flush()
+ */
+
+void fusion_init(
+    fusion_t * fusion, unsigned int wheel_length, fusion_output_t output,
+    void * cookie
+);
+
+/*
+ * fusion_rotation()
+ *
+ * feed fusion with the latest rotation, which ended at time and brings the
+ * rotation count since start to rotations, so several rotations can be fed at
+ * once, as the latest one, when the ones before it were missed
+ */
+
+void fusion_rotation(
+    fusion_t * fusion, unsigned long long time, unsigned long rotations
+);
+
+/*
+ * fusion_fix()
+ *
+ * feed fusion with a fix received at time, whether it is valid or not
+ */
+
+void fusion_fix(
+    fusion_t * fusion, unsigned long long time, const nmea_fix_t * fix
+);
+
+/*
+ * fusion_flush()
+ *
+ * output everything that was fed, as if both inputs were over
+ */
+
+void fusion_flush(fusion_t * fusion);
+
+#endif
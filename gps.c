@@ -1,37 +1,306 @@
 #include "gps.h"
+#include "bus.h"
+#include "logger.h"
+#include "session.h"
+#include "utc.h"
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
 #include <termios.h>
-#include <xenomai/native/mutex.h>
+#include <unistd.h>
 #include <xenomai/native/task.h>
 #include <xenomai/native/timer.h>
 
+/* constants ================================================================ */
+#ifndef GPS_DEVICE
+#define GPS_DEVICE "/dev/ttyUSB0"
+#endif
+
+#define RECORDS_SIZE 64
+#define READ_SIZE 64
+
+#define COMMAND_MAX 64
+#define PROBE_TIMEOUT 2 /* s, for a valid sentence once switched */
+
+/* types ==================================================================== */
+typedef struct record_t record_t;
+
+/* structures =============================================================== */
+struct record_t {
+    RTIME time;
+    int type;
+    nmea_fix_t fix;
+    char frame[NMEA_SENTENCE_MAX + 1];
+};
+
 /* private variables ======================================================== */
 static int running;
 
-static FILE * istream;
-static FILE * ostream;
+static const char * device = GPS_DEVICE;
+static unsigned long baud = GPS_BAUD;
+static unsigned long rate;
+static double latency;
+
+static const unsigned long bauds[] = {
+    4800, 9600, 19200, 38400, 57600, 115200
+};
+
+static int fd;
+static bus_channel_t channel;
+static session_writer_t writer;
 static struct termios termios;
 static struct termios otermios;
-static RT_MUTEX mutex;
 static RT_TASK task;
 
-static char frame[GPS_FRAME_SIZE];
+static nmea_parser_t parser;
+static gps_fix_t state;
+
+static RTIME byte_time;         /* ns a byte takes on the wire */
+static RTIME sentence_time;     /* when the current sentence began */
+static utc_clock_t utc;
+static RTIME fix_time_last;     /* latest fix time given to readers */
 
 /* private functions ======================================================== */
+static int format(FILE * stream, const void * record) {
+    const record_t * r = record;
+
+    return fprintf(stream, "%s,%llu\n", r->frame, r->time);
+}
+
+static int encode(FILE * stream, const void * record) {
+    const record_t * r = record;
+    session_record_t s;
+
+    /* binary sessions keep fixes only ------------------------------------- */
+    if (r->type != NMEA_GGA) {
+        return 0;
+    }
+
+    /* header goes first, once the writer thread owns stream --------------- */
+    if (
+        writer.stream != stream &&
+        session_writer_open(&writer, stream, SESSION_GPS) == -1
+    ) {
+        return -1;
+    }
+
+    s.time = r->time;
+    s.fix = r->fix;
+
+    return session_write(&writer, &s);
+}
+
+static int encode_close(FILE * stream) {
+    int result = session_writer_flush(&writer);
+
+    /* next stream, if the file is split, starts over with a header -------- */
+    writer.stream = NULL;
+
+    (void) stream;
+
+    return result;
+}
+
+static speed_t baud_constant(unsigned long value) {
+    switch (value) {
+    case 4800:
+        return B4800;
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    case 115200:
+        return B115200;
+    default:
+        return B0;
+    }
+}
+
+static void set_baud(unsigned long value) {
+    cfsetspeed(&termios, baud_constant(value));
+    tcsetattr(fd, TCSANOW, &termios);
+}
+
+static void command(const char * body) {
+    char sentence[COMMAND_MAX + 8];
+    unsigned char checksum = 0;
+    size_t i;
+
+    for (i = 0; body[i] != '\0'; i++) {
+        checksum ^= body[i];
+    }
+
+    snprintf(sentence, sizeof sentence, "$%s*%02X\r\n", body, checksum);
+    write(fd, sentence, strlen(sentence));
+    tcdrain(fd);
+}
+
+static int probe(void) {
+    unsigned char buffer[READ_SIZE];
+    struct timeval deadline, now;
+
+    gettimeofday(&deadline, NULL);
+    deadline.tv_sec += PROBE_TIMEOUT;
+    nmea_init(&parser);
+
+    /* any sentence with a valid checksum means we talk at the same rate --- */
+    do {
+        struct timeval timeout;
+        fd_set set;
+        ssize_t i, n;
+
+        gettimeofday(&now, NULL);
+        timersub(&deadline, &now, &timeout);
+
+        if (timeout.tv_sec < 0) {
+            break;
+        }
+
+        FD_ZERO(&set);
+        FD_SET(fd, &set);
+
+        if (select(fd + 1, &set, NULL, NULL, &timeout) <= 0) {
+            break;
+        }
+
+        if ((n = read(fd, buffer, sizeof buffer)) <= 0) {
+            break;
+        }
+
+        for (i = 0; i < n; i++) {
+            if (nmea_parse(&parser, buffer[i]) != NMEA_NONE) {
+                return 0;
+            }
+        }
+    } while (1);
+
+    return -1;
+}
+
+static void configure(void) {
+    char body[COMMAND_MAX];
+    size_t i;
+
+    /* left alone, unless asked for something else than the defaults ------ */
+    if (baud == GPS_BAUD && rate == 0) {
+        return;
+    }
+
+    if (baud != GPS_BAUD) {
+        /* whatever rate the receiver is at, it gets one request it reads -- */
+        snprintf(body, sizeof body, "PMTK251,%lu", baud);
+
+        for (i = 0; i < sizeof bauds / sizeof *bauds; i++) {
+            set_baud(bauds[i]);
+            command(body);
+        }
+
+        set_baud(baud);
+        tcflush(fd, TCIOFLUSH);
+
+        /* no answer, it cannot be switched, keep talking the default way -- */
+        if (probe() == -1) {
+            baud = GPS_BAUD;
+            set_baud(baud);
+        }
+    }
+
+    /* GGA, RMC and VTG only, every fix, then as many fixes as asked ------- */
+    command("PMTK314,0,1,1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0");
+
+    if (rate > 0) {
+        snprintf(body, sizeof body, "PMTK220,%lu", 1000 / rate);
+        command(body);
+    }
+}
+
+static void publish(RTIME time_curr, int type) {
+    record_t record;
+
+    /* the first sentence of an epoch tells when it began, VTG has no time */
+    if (type != NMEA_VTG) {
+        utc_update(
+            &utc, type == NMEA_GGA ? parser.fix.time : parser.motion.time,
+            time_curr
+        );
+    }
+
+    if (type == NMEA_GGA) {
+        state.nmea = parser.fix;
+        state.time = time_curr;
+
+        /* a fix the model cannot place, or that would go back in time, has
+           none, so readers never mix it with arrival stamps ------------ */
+        if (
+            utc_map(&utc, parser.fix.time, &state.fix_time) == -1 ||
+            state.fix_time <= fix_time_last
+        ) {
+            state.fix_time = 0;
+        }
+        else {
+            fix_time_last = state.fix_time;
+        }
+
+        ++state.frames;
+    }
+    else {
+        state.motion = parser.motion;
+        state.motion_time = time_curr;
+        ++state.motions;
+    }
+
+    state.errors = parser.errors;
+
+    record.time = time_curr;
+    record.type = type;
+    record.fix = parser.fix;
+    strcpy(record.frame, parser.sentence);
+
+    /* decoded fix or motion to readers, raw sentence to the writer thread - */
+    bus_publish(&channel, time_curr, &state, &record);
+}
+
 static void task_routine(void * cookie) {
-    char buffer[GPS_FRAME_SIZE];
+    unsigned char buffer[READ_SIZE];
 
     while (1) {
-        fscanf(istream, "%s", buffer);
+        ssize_t i, n;
+        RTIME time_curr;
+
+        /* wait for whatever the receiver has sent -------------------------- */
+        if ((n = read(fd, buffer, sizeof buffer)) <= 0) {
+            continue;
+        }
+
+        time_curr = rt_timer_read();
+
+        /*
+           Let's stamp sentences. time_curr is when the last byte of buffer
+           came in, the ones before came a byte time earlier each, so a
+           sentence is stamped when its '$' came, not once the whole of it
+           made it through the wire, which is 150 ms of a GGA at 4800 baud.
+        */
+        for (i = 0; i < n; i++) {
+            int type;
+
+            if (buffer[i] == '$') {
+                sentence_time = time_curr - (n - 1 - i) * byte_time;
+            }
 
-        if (strncmp(buffer, "$GPGGA", 6) == 0) {
-            rt_mutex_acquire(&mutex, TM_INFINITE);
-            strcpy(frame, buffer);
-            rt_mutex_release(&mutex);
+            type = nmea_parse(&parser, buffer[i]);
 
-            fprintf(ostream, "%s,%llu\n", buffer, rt_timer_read());
+            if (type != NMEA_GGA && type != NMEA_RMC && type != NMEA_VTG) {
+                continue;
+            }
+
+            publish(sentence_time, type);
         }
     }
 
@@ -39,37 +308,79 @@ static void task_routine(void * cookie) {
 }
 
 /* public functions ========================================================= */
+void gps_set_device(
+    const char * pathname, unsigned long baud_rate, unsigned long fix_rate
+) {
+    device = pathname != NULL && pathname[0] != '\0' ? pathname : GPS_DEVICE;
+    baud = baud_constant(baud_rate) != B0 ? baud_rate : GPS_BAUD;
+    rate = fix_rate < GPS_RATE_MAX ? fix_rate : GPS_RATE_MAX;
+}
+
+void gps_set_latency(double seconds) {
+    latency = seconds > 0 ? seconds : 0;
+}
+
 int gps_init(void) {
     if (running) {
         goto err_running;
     }
 
-    if ((istream = fopen("/dev/ttyUSB0", "r")) == NULL) {
-        goto err_istream;
+    if ((fd = open(device, O_RDWR | O_NOCTTY)) == -1) {
+        goto err_fd;
     }
 
-    if ((ostream = fopen("gps", "w")) == NULL) {
-        goto err_ostream;
+    writer.stream = NULL;
+
+    if (logger_binary()) {
+        if (
+            bus_open(
+                &channel, BUS_GPS, sizeof (gps_fix_t), "gps.bin", encode,
+                encode_close, sizeof (record_t), RECORDS_SIZE
+            ) == -1
+        ) {
+            goto err_channel;
+        }
+    }
+    else if (
+        bus_open(
+            &channel, BUS_GPS, sizeof (gps_fix_t), "gps", format, NULL,
+            sizeof (record_t), RECORDS_SIZE
+        ) == -1
+    ) {
+        goto err_channel;
     }
 
-    tcgetattr(fileno(istream), &otermios);
+    /* raw mode, so read() returns bytes as soon as they come --------------- */
+    tcgetattr(fd, &otermios);
     termios = otermios;
-    cfsetspeed(&termios, B4800);
-    tcsetattr(fileno(istream), TCSANOW, &termios);
+    cfmakeraw(&termios);
+    termios.c_cc[VMIN] = 1;
+    termios.c_cc[VTIME] = 0;
+    set_baud(GPS_BAUD);
 
-    rt_mutex_create(&mutex, NULL);
-    rt_task_spawn(&task, NULL, 0, 80, 0, task_routine, NULL);
+    /* talk the receiver into the configured baud and rate, if any --------- */
+    configure();
 
-    strcpy(frame, "");
+    nmea_init(&parser);
+    memset(&state, 0, sizeof state);
+    utc_init(&utc);
+    utc_set_latency(&utc, latency * 1e9);
+    fix_time_last = 0;
+
+    /* 8N1, ten bits a byte, at whatever baud rate configure() settled on -- */
+    byte_time = 10000000000ULL / baud;
+    sentence_time = 0;
+
+    rt_task_spawn(&task, NULL, 0, 80, 0, task_routine, NULL);
 
     running = 1;
 
     return 0;
 
-err_ostream:
-    fclose(istream);
+err_channel:
+    close(fd);
 
-err_istream:
+err_fd:
 err_running:
     return -1;
 }
@@ -82,27 +393,13 @@ int gps_exit(void) {
     running = 0;
 
     rt_task_delete(&task);
-    rt_mutex_delete(&mutex);
-
-    tcsetattr(fileno(istream), TCSANOW, &otermios);
 
-    fclose(ostream);
-    fclose(istream);
+    tcsetattr(fd, TCSANOW, &otermios);
 
-    return 0;
-
-err_not_running:
-    return -1;
-}
-
-int gps_get_frame(char * dest) {
-    if (!running) {
-        goto err_not_running;
-    }
+    close(fd);
 
-    rt_mutex_acquire(&mutex, TM_INFINITE);
-    strcpy(dest, frame);
-    rt_mutex_release(&mutex);
+    /* how receiver time lined up with ours --------------------------------- */
+    utc_dump(&utc, "clock");
 
     return 0;
 
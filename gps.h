@@ -1,42 +1,87 @@
 #ifndef GPS_H
 #define GPS_H
 
-#define GPS_FRAME_SIZE 128
+#include "nmea.h"
+
+#define GPS_BAUD 4800       /* receiver default, as it is powered up */
+#define GPS_RATE_MAX 10     /* Hz, fastest fix rate receivers will take */
+
+typedef struct gps_fix_t gps_fix_t;
+
+struct gps_fix_t {
+    nmea_fix_t nmea;                /* latest decoded GGA sentence */
+    unsigned long long time;        /* when its first byte came (in ns) */
+    unsigned long long fix_time;    /* its UTC time, on the same timebase
+                                       (in ns), see utc.h, 0 if unknown */
+    unsigned long frames;           /* GGA sentences decoded since init */
+    nmea_motion_t motion;           /* latest decoded RMC or VTG sentence */
+    unsigned long long motion_time; /* when its first byte came (in ns) */
+    unsigned long motions;          /* RMC and VTG sentences since init */
+    unsigned long errors;           /* corrupt or truncated sentences */
+};
 
 /*
- * gps_init()
+ * gps_set_device()
  *
- * start GPS sensor thread, which will save NMEA $GPGGA frames followed by
- * ",%llu", where %llu is nanosecond timestamp, in a "./gps" text file.
+ * set receiver device pathname, baud rate and fix rate (in Hz) to use from
+ * next gps_init(), pathname must stay valid until then; a NULL or empty
+ * pathname, an unsupported baud rate or a 0 fix rate keeps the default
+ * (/dev/ttyUSB0, GPS_BAUD, and whatever rate the receiver is at)
  *
- * returns -1 if:
- *  - gps sensor thread is already running
- *  - "/dev/ttyUSB0" device file could not be opened for reading
- *  - "./gps" text file could not be opened for writing
+ * anything else than the defaults is asked to the receiver with MTK $PMTK
+ * sentences at init, which also restrict its output to GGA, RMC and VTG; a
+ * receiver that does not answer at the new baud rate is talked to at
+ * GPS_BAUD again; fix rate is capped to GPS_RATE_MAX
  */
 
-int gps_init(void);
+void gps_set_device(
+    const char * pathname, unsigned long baud_rate, unsigned long fix_rate
+);
 
 /*
- * gps_exit()
+ * gps_set_latency()
+ *
+ * set receiver latency, seconds from a fix epoch to the first byte of its
+ * first sentence, to take off fix times from next gps_init() (see
+ * utc_set_latency()); 0, the default, leaves fix times that late
+ */
+
+void gps_set_latency(double seconds);
+
+/*
+ * gps_init()
  *
- * stop gps sensor thread, and close the "./gps" text file
+ * start GPS sensor thread, which will decode NMEA $--GGA, $--RMC and $--VTG
+ * sentences, and log the valid ones followed by ",%llu", where %llu is the
+ * nanosecond timestamp of their first byte, to a "./gps" text file; binary
+ * logs (see logger_set_binary()) keep GGA fixes only; fix UTC times are
+ * mapped onto that timebase by a clock model (see utc.h), a fix gets none
+ * while the model has not settled or has an outlier pending, nor if it would
+ * not come after the previous one, so fix times only ever increase and
+ * readers timing fixes against rotations skip fixes without one; the latest
+ * fix and motion are published as a gps_fix_t to the BUS_GPS channel (see
+ * bus.h), fix quality is 0 until a valid fix has been received, motion is
+ * not valid until a valid motion has been received, bus_init() must have
+ * been called
  *
  * returns -1 if:
- *  - gps sensor thread is not running
+ *  - gps sensor thread is already running
+ *  - receiver device file could not be opened for reading and writing
+ *  - BUS_GPS channel could not be opened
  */
 
-int gps_exit(void);
+int gps_init(void);
 
 /*
- * gps_get_frame()
+ * gps_exit()
  *
- * write current NMEA $GPGGA to dest, which size is max GPS_FRAME_SIZE
+ * stop gps sensor thread, save its clock model to a "./clock" text file,
+ * "./gps" text file is closed by logger_exit()
  *
  * returns -1 if:
  *  - gps sensor thread is not running
  */
 
-int gps_get_frame(char * dest);
+int gps_exit(void);
 
 #endif
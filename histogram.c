@@ -0,0 +1,102 @@
+#include "histogram.h"
+
+#include <string.h>
+
+/* private functions ======================================================== */
+static unsigned int bucket(unsigned long long value) {
+    unsigned int e;
+
+    /* small values have a bucket of their own ------------------------------ */
+    if (value < 1ULL << HISTOGRAM_SUB_BITS) {
+        return value;
+    }
+
+    if (value >= 1ULL << HISTOGRAM_MAX_BITS) {
+        return HISTOGRAM_BUCKETS - 1;
+    }
+
+    /* e is the position of the highest bit, then take the next ones -------- */
+    e = 63 - __builtin_clzll(value);
+
+    return
+        (e - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS |
+        (value >> (e - HISTOGRAM_SUB_BITS) & ((1 << HISTOGRAM_SUB_BITS) - 1));
+}
+
+static unsigned long long bucket_max(unsigned int b) {
+    unsigned int e;
+    unsigned long long sub;
+
+    if (b < 1U << HISTOGRAM_SUB_BITS) {
+        return b;
+    }
+
+    e = (b >> HISTOGRAM_SUB_BITS) + HISTOGRAM_SUB_BITS - 1;
+    sub = b & ((1 << HISTOGRAM_SUB_BITS) - 1);
+
+    return (
+        ((1ULL << HISTOGRAM_SUB_BITS | sub) + 1) << (e - HISTOGRAM_SUB_BITS)
+    ) - 1;
+}
+
+/* public functions ========================================================= */
+void histogram_reset(histogram_t * histogram) {
+    memset(histogram, 0, sizeof *histogram);
+    histogram->min = ~0ULL;
+}
+
+void histogram_record(histogram_t * histogram, unsigned long long value) {
+    ++histogram->buckets[bucket(value)];
+    ++histogram->count;
+    histogram->sum += value;
+
+    if (value < histogram->min) {
+        histogram->min = value;
+    }
+
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+}
+
+unsigned long long histogram_percentile(
+    const histogram_t * histogram, double percent
+) {
+    unsigned long rank, seen = 0;
+    unsigned int b;
+
+    if (histogram->count == 0) {
+        return 0;
+    }
+
+    rank = histogram->count * percent / 100;
+
+    if (rank >= histogram->count) {
+        rank = histogram->count - 1;
+    }
+
+    for (b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        if ((seen += histogram->buckets[b]) > rank) {
+            break;
+        }
+    }
+
+    return bucket_max(b) < histogram->max ? bucket_max(b) : histogram->max;
+}
+
+void histogram_print(
+    const histogram_t * histogram, FILE * stream, const char * name,
+    double unit
+) {
+    fprintf(
+        stream, "%-16s %8lu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+        name, histogram->count,
+        histogram->count ? histogram->min / unit : 0,
+        histogram_percentile(histogram, 50) / unit,
+        histogram_percentile(histogram, 90) / unit,
+        histogram_percentile(histogram, 99) / unit,
+        histogram_percentile(histogram, 99.9) / unit,
+        histogram->max / unit,
+        histogram->count ? histogram->sum / unit / histogram->count : 0
+    );
+}
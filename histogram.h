@@ -0,0 +1,69 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdio.h>
+
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_MAX_BITS 40
+#define HISTOGRAM_BUCKETS \
+    ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 2) << HISTOGRAM_SUB_BITS)
+
+typedef struct histogram_t histogram_t;
+
+/*
+ * fixed-memory histogram with logarithmic buckets: each power of two is split
+ * in 2^HISTOGRAM_SUB_BITS linear buckets, so a value is known within 12.5%,
+ * from 0 up to 2^HISTOGRAM_MAX_BITS (18 minutes, in ns), larger values land
+ * in the last bucket; count, sum, min and max are exact
+ *
+ * recording is a few integer operations, without any lock: one writer only
+ */
+
+struct histogram_t {
+    unsigned long count;
+    unsigned long long sum;
+    unsigned long long min;
+    unsigned long long max;
+    unsigned long buckets[HISTOGRAM_BUCKETS];
+};
+
+/*
+ * histogram_reset()
+ *
+ * forget every recorded value
+ */
+
+void histogram_reset(histogram_t * histogram);
+
+/*
+ * histogram_record()
+ *
+ * add value to histogram
+ */
+
+void histogram_record(histogram_t * histogram, unsigned long long value);
+
+/*
+ * histogram_percentile()
+ *
+ * return the value below which lies percent % of recorded values, rounded up
+ * to its bucket upper bound, but never above the exact max, 0 if empty
+ */
+
+unsigned long long histogram_percentile(
+    const histogram_t * histogram, double percent
+);
+
+/*
+ * histogram_print()
+ *
+ * write "name count min p50 p90 p99 p99.9 max mean" line to stream, values
+ * divided by unit
+ */
+
+void histogram_print(
+    const histogram_t * histogram, FILE * stream, const char * name,
+    double unit
+);
+
+#endif
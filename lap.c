@@ -0,0 +1,223 @@
+#include "lap.h"
+#include "fixed.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* private functions ======================================================== */
+static void cross(lap_t * lap, unsigned long long time) {
+    /* half the route at least, or it was jitter back and forth ------------ */
+    if (lap->timing && lap->progress >= (lap->count + 1) / 2) {
+        lap->current.time = time - lap->crossed;
+
+        if (lap->lap_count < LAP_MAX) {
+            lap->laps[lap->lap_count] = lap->current;
+        }
+
+        if (lap->lap_count == 0 || lap->current.time < lap->best.time) {
+            lap->best = lap->current;
+        }
+
+        lap->previous = lap->current;
+        ++lap->lap_count;
+    }
+
+    /* either way, the next lap starts here --------------------------------- */
+    memset(&lap->current, 0, sizeof lap->current);
+    lap->timing = 1;
+    lap->crossed = time;
+    lap->progress = 0;
+}
+
+static void enter(lap_t * lap, int sector, unsigned long long time) {
+    size_t forward;
+
+    lap->sector = sector;
+
+    if (sector == LAP_NONE) {
+        return;
+    }
+
+    ++lap->stats[sector].entries;
+
+    /* forward is at most half the route ahead, anything else is backward -- */
+    if (lap->last != LAP_NONE) {
+        forward = (lap->count + sector - lap->last) % lap->count;
+
+        if (forward > 0 && forward <= lap->count / 2) {
+            if (lap->last + forward >= lap->count) {
+                lap->progress += lap->count - lap->last;
+                cross(lap, time);
+                lap->progress = sector;
+            }
+            else {
+                lap->progress += forward;
+            }
+        }
+    }
+
+    lap->last = sector;
+}
+
+static void print_band(FILE * fp, const lap_band_t * band) {
+    fprintf(fp, " %10.3f %10.3f", band->time / 1e9, band->distance / 1e3);
+}
+
+/* public functions ========================================================= */
+int lap_init(
+    lap_t * lap, const sector_t * sectors, size_t count,
+    unsigned int wheel_length
+) {
+    memset(lap, 0, sizeof *lap);
+
+    /* one more, so an empty route still gets a valid pointer --------------- */
+    if ((lap->stats = calloc(count + 1, sizeof *lap->stats)) == NULL) {
+        return -1;
+    }
+
+    lap->sectors = sectors;
+    lap->count = count;
+    lap->wheel_length = wheel_length;
+    lap->sector = LAP_NONE;
+    lap->last = LAP_NONE;
+    lap->candidate = LAP_NONE;
+
+    return 0;
+}
+
+void lap_rotation(
+    lap_t * lap, unsigned long rotations, unsigned long long time
+) {
+    unsigned long long distance, span;
+    lap_band_t * band;
+
+    if (!lap->rotated || rotations < lap->rotations) {
+        lap->rotated = 1;
+        lap->rotations = rotations;
+        lap->time = time;
+        return;
+    }
+
+    if (rotations == lap->rotations || time <= lap->time) {
+        return;
+    }
+
+    distance = (unsigned long long) (rotations - lap->rotations) *
+        lap->wheel_length;
+    span = time - lap->time;
+
+    /* the band of the speed over the whole span, standstill included ------ */
+    if (lap->sector == LAP_NONE) {
+        band = &lap->outside;
+    }
+    else {
+        int b = sector_band(
+            &lap->sectors[lap->sector], fixed_mms(distance, span)
+        );
+
+        band = &lap->stats[lap->sector].bands[b + 1];
+
+        if (b == SECTOR_OVER) {
+            lap->current.over += span;
+        }
+    }
+
+    band->time += span;
+    band->distance += distance;
+    lap->current.distance += distance;
+
+    lap->rotations = rotations;
+    lap->time = time;
+}
+
+void lap_locate(lap_t * lap, int sector, unsigned long long time) {
+    if (sector < 0 || (size_t) sector >= lap->count) {
+        sector = LAP_NONE;
+    }
+
+    /* where we are already, whatever was told in between was jitter ------- */
+    if (sector == lap->sector) {
+        lap->candidate = sector;
+        lap->streak = 0;
+        return;
+    }
+
+    if (sector != lap->candidate) {
+        lap->candidate = sector;
+        lap->streak = 0;
+    }
+
+    if (++lap->streak < LAP_HYSTERESIS) {
+        return;
+    }
+
+    lap->streak = 0;
+    enter(lap, sector, time);
+}
+
+int lap_dump(const lap_t * lap, const char * pathname) {
+    unsigned long i, n;
+    FILE * fp;
+
+    if ((fp = fopen(pathname, "w")) == NULL) {
+        return -1;
+    }
+
+    /* s and m in each band, sectors never entered are left out ------------ */
+    fprintf(
+        fp, "%-8s %8s %10s %10s %10s %10s %10s %10s\n", "sector", "entries",
+        "under (s)", "(m)", "in (s)", "(m)", "over (s)", "(m)"
+    );
+
+    for (i = 0; i < lap->count; i++) {
+        const lap_sector_t * s = &lap->stats[i];
+
+        if (s->entries == 0) {
+            continue;
+        }
+
+        fprintf(fp, "%-8lu %8lu", i, s->entries);
+        print_band(fp, &s->bands[SECTOR_UNDER + 1]);
+        print_band(fp, &s->bands[SECTOR_IN + 1]);
+        print_band(fp, &s->bands[SECTOR_OVER + 1]);
+        fprintf(fp, "\n");
+    }
+
+    fprintf(fp, "%-8s %8s", "outside", "");
+    print_band(fp, &lap->outside);
+    fprintf(fp, "\n\n");
+
+    /* then laps, as many as were kept ------------------------------------- */
+    fprintf(
+        fp, "%-8s %10s %10s %10s\n", "lap", "time (s)", "(m)", "over (s)"
+    );
+
+    n = lap->lap_count < LAP_MAX ? lap->lap_count : LAP_MAX;
+
+    for (i = 0; i < n; i++) {
+        fprintf(
+            fp, "%-8lu %10.3f %10.3f %10.3f\n", i + 1,
+            lap->laps[i].time / 1e9, lap->laps[i].distance / 1e3,
+            lap->laps[i].over / 1e9
+        );
+    }
+
+    if (lap->lap_count > 0) {
+        fprintf(
+            fp, "%-8s %10.3f %10.3f %10.3f\n", "best", lap->best.time / 1e9,
+            lap->best.distance / 1e3, lap->best.over / 1e9
+        );
+    }
+
+    fprintf(fp, "%lu laps\n", lap->lap_count);
+
+    fclose(fp);
+
+    return 0;
+}
+
+void lap_free(lap_t * lap) {
+    free(lap->stats);
+    lap->stats = NULL;
+}
@@ -0,0 +1,134 @@
+#ifndef LAP_H
+#define LAP_H
+
+#include "sector.h"
+
+#include <stddef.h>
+
+#define LAP_HYSTERESIS 2        /* samples in a row to enter or leave */
+#define LAP_MAX 128             /* laps kept one by one, more are counted */
+#define LAP_NONE -1
+
+typedef struct lap_band_t lap_band_t;
+typedef struct lap_sector_t lap_sector_t;
+typedef struct lap_record_t lap_record_t;
+typedef struct lap_t lap_t;
+
+/*
+ * sector compliance and laps, updated as samples come, never rescanning:
+ * rotations tell how long and how far the vehicle went, at which speed, and
+ * that goes to the band (under, in or over, see sector_band()) of the sector
+ * it is in; matches, per rotation or per fix, tell which sector that is,
+ * but it only changes once LAP_HYSTERESIS samples in a row agree on another
+ * one, or on none, so a position jittering on a box edge does not flicker
+ *
+ * sectors are in route order, as in the sector file: moving forward from a
+ * sector to a later one, wrapping past the last one, crosses the start line,
+ * and completes a lap if at least half the route was gone through forward
+ * since the previous crossing; what comes before the first crossing is not
+ * a lap
+ *
+ * times are in ns, distances in mm
+ */
+
+struct lap_band_t {
+    unsigned long long time;
+    unsigned long long distance;
+};
+
+struct lap_sector_t {
+    lap_band_t bands[3];        /* indexed by sector_band() + 1 */
+    unsigned long entries;
+};
+
+struct lap_record_t {
+    unsigned long long time;
+    unsigned long long distance;
+    unsigned long long over;    /* time over speed_max */
+};
+
+struct lap_t {
+    const sector_t * sectors;
+    size_t count;
+    unsigned int wheel_length;  /* mm */
+    lap_sector_t * stats;       /* one per sector */
+    lap_band_t outside;         /* in no sector */
+
+    int sector;                 /* current one, LAP_NONE when none */
+    int last;                   /* latest one, LAP_NONE before any */
+    int candidate;              /* what matches tell, not agreed yet */
+    unsigned int streak;        /* samples in a row it was told */
+
+    int rotated;                /* has there been a rotation yet? */
+    unsigned long rotations;    /* at latest one */
+    unsigned long long time;
+
+    int timing;                 /* has the start line been crossed? */
+    unsigned long long crossed; /* when it was, latest */
+    size_t progress;            /* sectors gone forward since */
+    lap_record_t current;
+    lap_record_t previous;      /* latest lap completed */
+    lap_record_t best;
+    lap_record_t laps[LAP_MAX];
+    unsigned long lap_count;
+};
+
+/*
+ * lap_init()
+ *
+ * setup engine for the count sectors of a route, which must stay valid until
+ * lap_free(), and a wheel_length mm wheel, with everything at 0, in no
+ * sector and before the start line
+ *
+ * returns -1 if:
+ *  - there is not enough memory
+ */
+
+int lap_init(
+    lap_t * lap, const sector_t * sectors, size_t count,
+    unsigned int wheel_length
+);
+
+/*
+ * lap_rotation()
+ *
+ * feed engine with rotations, the wheel count since first rotation, as of
+ * time; the span since previous call goes to the current sector, in the band
+ * of the speed over it, missed rotations still count for distance
+ */
+
+void lap_rotation(
+    lap_t * lap, unsigned long rotations, unsigned long long time
+);
+
+/*
+ * lap_locate()
+ *
+ * feed engine with the sector a position was matched to at time, LAP_NONE
+ * if none, for sector entries, exits and laps; laps last from a start line
+ * crossing to the next one, whether the vehicle moves or not
+ */
+
+void lap_locate(lap_t * lap, int sector, unsigned long long time);
+
+/*
+ * lap_dump()
+ *
+ * save time and distance in each band of every sector entered, outside
+ * sectors, and every lap, to a pathname text file
+ *
+ * returns -1 if:
+ *  - pathname file could not be opened for writing
+ */
+
+int lap_dump(const lap_t * lap, const char * pathname);
+
+/*
+ * lap_free()
+ *
+ * release what lap holds
+ */
+
+void lap_free(lap_t * lap);
+
+#endif
@@ -0,0 +1,53 @@
+#include "latency.h"
+#include "histogram.h"
+
+#include <stdio.h>
+
+/* private variables ======================================================== */
+static histogram_t histograms[LATENCY_STAGES];
+
+static const char * const names[LATENCY_STAGES] = {
+    [LATENCY_IRQ_TO_QUEUE] = "irq-to-queue",
+    [LATENCY_QUEUE_TO_SOFT] = "queue-to-soft",
+    [LATENCY_SOFT_TO_PUBLISH] = "soft-to-publish",
+    [LATENCY_PUBLISH_TO_DRAW] = "publish-to-draw"
+};
+
+/* public functions ========================================================= */
+void latency_reset(void) {
+    int i;
+
+    for (i = 0; i < LATENCY_STAGES; i++) {
+        histogram_reset(&histograms[i]);
+    }
+}
+
+void latency_record(int stage, unsigned long long ns) {
+    histogram_record(&histograms[stage], ns);
+}
+
+int latency_dump(const char * pathname) {
+    FILE * fp;
+    int i;
+
+    if ((fp = fopen(pathname, "w")) == NULL) {
+        goto err_fp;
+    }
+
+    fprintf(
+        fp, "%-16s %8s %10s %10s %10s %10s %10s %10s %10s\n",
+        "stage (us)", "count", "min", "p50", "p90", "p99", "p99.9", "max",
+        "mean"
+    );
+
+    for (i = 0; i < LATENCY_STAGES; i++) {
+        histogram_print(&histograms[i], fp, names[i], 1e3);
+    }
+
+    fclose(fp);
+
+    return 0;
+
+err_fp:
+    return -1;
+}
@@ -0,0 +1,40 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#define LATENCY_IRQ_TO_QUEUE 0    /* rt_intr_wait() returns, to queued */
+#define LATENCY_QUEUE_TO_SOFT 1   /* queued, to read by the soft task */
+#define LATENCY_SOFT_TO_PUBLISH 2 /* read by the soft task, to published */
+#define LATENCY_PUBLISH_TO_DRAW 3 /* published, to drawn on the LCD */
+#define LATENCY_STAGES 4
+
+/*
+ * latency_reset()
+ *
+ * forget every recorded latency
+ */
+
+void latency_reset(void);
+
+/*
+ * latency_record()
+ *
+ * record that a wheel rotation went through stage in ns nanoseconds, cheap
+ * enough to be left on in production, but each stage must only be recorded
+ * by one task
+ */
+
+void latency_record(int stage, unsigned long long ns);
+
+/*
+ * latency_dump()
+ *
+ * save count, min, percentiles, max and mean (in us) of every stage in a
+ * pathname text file
+ *
+ * returns -1 if:
+ *  - pathname text file could not be opened for writing
+ */
+
+int latency_dump(const char * pathname);
+
+#endif
@@ -0,0 +1,441 @@
+#define _GNU_SOURCE
+
+#include "logger.h"
+#include "histogram.h"
+
+#include <pthread.h>
+#include <time.h>
+
+/* constants ================================================================ */
+#define LOGGER_PERIOD (100 * 1000 * 1000)
+#define LOGGER_PATH_MAX 256
+
+/* private variables ======================================================== */
+static int running;
+static int stopping;
+static int binary;
+static double sync_setting;
+static unsigned long long sync_period;
+static histogram_t sync_latency;
+
+static unsigned char chunks[LOGGER_CHANNEL_MAX][FLASH_CHUNK]
+    __attribute__((aligned(FLASH_CHUNK)));
+
+static pthread_t thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup;
+static pthread_cond_t drained;
+static unsigned long requested;
+static unsigned long completed;
+
+static logger_channel_t * channels[LOGGER_CHANNEL_MAX];
+static volatile size_t channel_count;
+
+/* private functions ======================================================== */
+static unsigned long long now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static ssize_t cookie_write(void * cookie, const char * data, size_t size) {
+    logger_channel_t * channel = cookie;
+
+    /* stdio takes 0 as an error, and keeps the stream in error ------------ */
+    return flash_write(&channel->file, data, size) == -1 ? 0 : (ssize_t) size;
+}
+
+static int cookie_close(void * cookie) {
+    logger_channel_t * channel = cookie;
+    int result = flash_close(&channel->file);
+
+    channel->bytes += channel->file.bytes;
+    channel->write_time += channel->file.write_time;
+    channel->errors += channel->file.errors;
+    channel->file.bytes = 0;
+    channel->file.write_time = 0;
+    channel->file.errors = 0;
+
+    return result;
+}
+
+static int open_part(logger_channel_t * channel) {
+    cookie_io_functions_t functions = {
+        .read = NULL,
+        .write = cookie_write,
+        .seek = NULL,
+        .close = cookie_close
+    };
+    char pathname[LOGGER_PATH_MAX];
+
+    /* first part goes by the channel name, next ones get a number --------- */
+    if (channel->parts == 0) {
+        snprintf(pathname, sizeof pathname, "%s", channel->pathname);
+    }
+    else {
+        snprintf(
+            pathname, sizeof pathname, "%s.%u", channel->pathname,
+            channel->parts
+        );
+    }
+
+    if (
+        flash_open(&channel->file, pathname, channel->chunk, &sync_latency)
+        == -1
+    ) {
+        goto err_file;
+    }
+
+    if ((channel->stream = fopencookie(channel, "w", functions)) == NULL) {
+        goto err_stream;
+    }
+
+    /* chunk is the buffer, so file size is always up to the last record --- */
+    setvbuf(channel->stream, NULL, _IONBF, 0);
+
+    ++channel->parts;
+
+    return 0;
+
+err_stream:
+    cookie_close(channel);
+
+err_file:
+    channel->stream = NULL;
+    return -1;
+}
+
+static void close_part(logger_channel_t * channel) {
+    if (channel->close != NULL) {
+        channel->close(channel->stream);
+    }
+
+    fclose(channel->stream);
+    channel->stream = NULL;
+}
+
+static int next_part(logger_channel_t * channel) {
+    close_part(channel);
+
+    return open_part(channel);
+}
+
+static void drain(void) {
+    unsigned char record[LOGGER_RECORD_MAX];
+    size_t i, n = channel_count;
+
+    /* channels opened up to n are fully setup ------------------------------ */
+    __sync_synchronize();
+
+    for (i = 0; i < n; i++) {
+        logger_channel_t * channel = channels[i];
+
+        /* a part that could not be opened is tried again, records wait ---- */
+        if (channel->stream == NULL && open_part(channel) == -1) {
+            continue;
+        }
+
+        /* write every waiting record in one batch ------------------------- */
+        while (ring_pop(&channel->ring, record) != -1) {
+            channel->format(channel->stream, record);
+            ++channel->written;
+
+            /* flash writer keeps what it could not write, stdio must not -- */
+            if (ferror(channel->stream)) {
+                clearerr(channel->stream);
+            }
+
+            /* next record could cross the vfat limit, on to next part ----- */
+            if (
+                flash_size(&channel->file) >= LOGGER_SPLIT &&
+                next_part(channel) == -1
+            ) {
+                break;
+            }
+        }
+
+    }
+}
+
+static void sync_all(void) {
+    size_t i, n = channel_count;
+
+    __sync_synchronize();
+
+    for (i = 0; i < n; i++) {
+        /* the medium may have dropped what it held, go on in a new part --- */
+        if (
+            channels[i]->stream != NULL &&
+            flash_sync(&channels[i]->file) == -1
+        ) {
+            next_part(channels[i]);
+        }
+    }
+}
+
+static void * thread_routine(void * cookie) {
+    struct timespec deadline;
+    unsigned long long next_sync = now() + sync_period;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    pthread_mutex_lock(&lock);
+
+    while (!stopping) {
+        unsigned long request = requested;
+
+        pthread_mutex_unlock(&lock);
+        drain();
+
+        /* once a sync period, wait for the medium, not for every drain ---- */
+        if (now() >= next_sync) {
+            sync_all();
+            next_sync += sync_period;
+        }
+
+        /* partial chunks too, for whoever reads the files back ------------ */
+        if (request != completed) {
+            size_t i;
+
+            for (i = 0; i < channel_count; i++) {
+                if (channels[i]->stream != NULL) {
+                    flash_flush(&channels[i]->file);
+                }
+            }
+        }
+
+        pthread_mutex_lock(&lock);
+
+        /* tell logger_sync() callers their records are in the files ------- */
+        completed = request;
+        pthread_cond_broadcast(&drained);
+
+        deadline.tv_nsec += LOGGER_PERIOD;
+
+        while (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_nsec -= 1000000000;
+            ++deadline.tv_sec;
+        }
+
+        /* sleep until next period, unless someone is waiting for a drain -- */
+        while (!stopping && requested == completed) {
+            if (pthread_cond_timedwait(&wakeup, &lock, &deadline) != 0) {
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return cookie;
+}
+
+/* public functions ========================================================= */
+int logger_init(void) {
+    pthread_condattr_t attr;
+
+    if (running) {
+        goto err_running;
+    }
+
+    channel_count = 0;
+    stopping = 0;
+    requested = 0;
+    completed = 0;
+    histogram_reset(&sync_latency);
+
+    sync_period = (sync_setting > 0 ? sync_setting : LOGGER_SYNC_PERIOD) * 1e9;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wakeup, &attr);
+    pthread_cond_init(&drained, NULL);
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_create(&thread, NULL, thread_routine, NULL) != 0) {
+        goto err_thread;
+    }
+
+    running = 1;
+
+    return 0;
+
+err_thread:
+    pthread_cond_destroy(&drained);
+    pthread_cond_destroy(&wakeup);
+
+err_running:
+    return -1;
+}
+
+int logger_exit(void) {
+    unsigned long long bytes = 0, write_time = 0;
+    size_t i;
+    FILE * fp;
+
+    if (!running) {
+        goto err_not_running;
+    }
+
+    running = 0;
+
+    pthread_mutex_lock(&lock);
+    stopping = 1;
+    pthread_cond_signal(&wakeup);
+    pthread_cond_broadcast(&drained);
+    pthread_mutex_unlock(&lock);
+
+    pthread_join(thread, NULL);
+
+    pthread_cond_destroy(&drained);
+    pthread_cond_destroy(&wakeup);
+
+    /* producers are gone, catch up on what they left behind ---------------- */
+    drain();
+
+    fp = fopen("logger", "w");
+
+    for (i = 0; i < channel_count; i++) {
+        logger_stats_t stats;
+
+        if (channels[i]->stream != NULL) {
+            close_part(channels[i]);
+        }
+
+        logger_get_stats(channels[i], &stats);
+        bytes += stats.bytes;
+        write_time += stats.write_time;
+
+        if (fp != NULL) {
+            fprintf(
+                fp, "%s %lu written, %lu/%lu high water, %lu dropped, "
+                "%llu bytes, %lu write errors, %u parts\n",
+                channels[i]->pathname, stats.written, stats.high_water,
+                stats.size, stats.dropped, stats.bytes, stats.errors,
+                stats.parts
+            );
+        }
+    }
+
+    if (fp != NULL) {
+        fprintf(
+            fp, "total %llu bytes, %.2f MB/s\n", bytes,
+            write_time > 0 ? bytes * 1e3 / write_time : 0.0
+        );
+
+        fprintf(
+            fp, "%-16s %8s %10s %10s %10s %10s %10s %10s %10s\n",
+            "sync (ms)", "count", "min", "p50", "p90", "p99", "p99.9", "max",
+            "mean"
+        );
+
+        histogram_print(&sync_latency, fp, "fdatasync", 1e6);
+
+        fclose(fp);
+    }
+
+    channel_count = 0;
+
+    return 0;
+
+err_not_running:
+    return -1;
+}
+
+int logger_sync(void) {
+    unsigned long request;
+
+    if (!running) {
+        goto err_not_running;
+    }
+
+    pthread_mutex_lock(&lock);
+
+    request = ++requested;
+    pthread_cond_signal(&wakeup);
+
+    while (!stopping && (long) (completed - request) < 0) {
+        pthread_cond_wait(&drained, &lock);
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return 0;
+
+err_not_running:
+    return -1;
+}
+
+void logger_set_sync(double seconds) {
+    sync_setting = seconds;
+}
+
+void logger_set_binary(int value) {
+    binary = value;
+}
+
+int logger_binary(void) {
+    return binary;
+}
+
+int logger_open(
+    logger_channel_t * channel, const char * pathname, logger_format_t format,
+    logger_close_t close, void * buffer, size_t size, unsigned long count
+) {
+    if (!running) {
+        goto err_not_running;
+    }
+
+    if (channel_count == LOGGER_CHANNEL_MAX) {
+        goto err_channel_max;
+    }
+
+    if (size > LOGGER_RECORD_MAX) {
+        goto err_record_max;
+    }
+
+    channel->pathname = pathname;
+    channel->format = format;
+    channel->close = close;
+    channel->chunk = chunks[channel_count];
+    channel->written = 0;
+    channel->parts = 0;
+    channel->bytes = 0;
+    channel->write_time = 0;
+    channel->errors = 0;
+
+    if (open_part(channel) == -1) {
+        goto err_stream;
+    }
+    ring_init(&channel->ring, buffer, size, count);
+
+    /* channel must be setup before the writer thread sees it -------------- */
+    channels[channel_count] = channel;
+    __sync_synchronize();
+    ++channel_count;
+
+    return 0;
+
+err_stream:
+err_record_max:
+err_channel_max:
+err_not_running:
+    return -1;
+}
+
+int logger_push(logger_channel_t * channel, const void * record) {
+    return ring_push(&channel->ring, record);
+}
+
+void logger_get_stats(const logger_channel_t * channel, logger_stats_t * dest) {
+    dest->written = channel->written;
+    dest->high_water = channel->ring.high_water;
+    dest->dropped = channel->ring.dropped;
+    dest->size = channel->ring.count;
+    dest->bytes = channel->bytes + channel->file.bytes;
+    dest->write_time = channel->write_time + channel->file.write_time;
+    dest->errors = channel->errors + channel->file.errors;
+    dest->parts = channel->parts;
+}
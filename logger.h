@@ -0,0 +1,168 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include "flash.h"
+#include "ring.h"
+
+#include <stdio.h>
+
+#define LOGGER_CHANNEL_MAX 8
+#define LOGGER_RECORD_MAX 256
+#define LOGGER_SYNC_PERIOD 1.0          /* s, data a power cut may lose */
+#define LOGGER_SPLIT (4095ULL << 20)    /* bytes, vfat files stop at 4 GB */
+
+typedef struct logger_channel_t logger_channel_t;
+typedef struct logger_stats_t logger_stats_t;
+
+typedef int (* logger_format_t)(FILE * stream, const void * record);
+typedef int (* logger_close_t)(FILE * stream);
+
+/*
+ * a log channel: fixed-size binary records pushed by one sensor thread into a
+ * ring, formatted by the writer thread into a file of the session directory
+ *
+ * formats write to a stdio stream, which goes to a flash friendly writer (see
+ * flash.h), synced every sync period; a file about to reach LOGGER_SPLIT is
+ * closed, in between two records, and followed by "pathname.1", "pathname.2",
+ * and so on, each one starting the way a new file would
+ *
+ * a write error does not stop a channel: the refused chunk is tried again,
+ * and records keep going; a file that could not be synced, as the medium may
+ * have dropped what it held, is closed and followed by the next one, and a
+ * file that could not be opened is tried again every drain
+ */
+
+struct logger_channel_t {
+    const char * pathname;
+    logger_format_t format;
+    logger_close_t close;
+    ring_t ring;
+    FILE * stream;
+    flash_file_t file;
+    unsigned char * chunk;
+    unsigned long written;
+    unsigned int parts;
+    unsigned long long bytes;       /* of previous parts, to the medium */
+    unsigned long long write_time;  /* ns spent writing them */
+    unsigned long errors;           /* writes they refused */
+};
+
+struct logger_stats_t {
+    unsigned long written;    /* records written to file */
+    unsigned long high_water; /* max records ever waiting in ring */
+    unsigned long dropped;    /* records lost because ring was full */
+    unsigned long size;       /* ring size (in records) */
+    unsigned long long bytes; /* handed to the medium */
+    unsigned long long write_time; /* ns spent handing them */
+    unsigned long errors;     /* writes the medium refused */
+    unsigned int parts;       /* files, more than one once split */
+};
+
+/*
+ * logger_init()
+ *
+ * start the writer thread, a low priority non real-time thread which drains
+ * every channel ring to its file every 100 ms, and syncs files every sync
+ * period (see logger_set_sync())
+ *
+ * returns -1 if:
+ *  - writer thread is already running
+ *  - writer thread could not be created
+ */
+
+int logger_init(void);
+
+/*
+ * logger_exit()
+ *
+ * stop the writer thread once every channel ring has been drained, sync and
+ * close every channel file, and save channel statistics, write throughput and
+ * sync latencies in a "./logger" text file
+ *
+ * returns -1 if:
+ *  - writer thread is not running
+ */
+
+int logger_exit(void);
+
+/*
+ * logger_sync()
+ *
+ * wake the writer thread up and wait until it has drained every channel ring
+ * to its file, from a plain Linux thread only, never from a real-time task;
+ * files are not synced for that
+ *
+ * returns -1 if:
+ *  - writer thread is not running
+ */
+
+int logger_sync(void);
+
+/*
+ * logger_set_sync()
+ *
+ * set how often, in seconds, files are synced, from next logger_init() on,
+ * which bounds how much data a power cut may lose; 0 for LOGGER_SYNC_PERIOD
+ */
+
+void logger_set_sync(double seconds);
+
+/*
+ * logger_set_binary()
+ *
+ * tell sensors whether to open their channels with a compact binary format
+ * (see session.h) rather than text, for the next session
+ */
+
+void logger_set_binary(int binary);
+
+/*
+ * logger_binary()
+ *
+ * returns whether channels should be opened with a binary format
+ */
+
+int logger_binary(void);
+
+/*
+ * logger_open()
+ *
+ * open channel, which will format records with format to a pathname file, and
+ * queue them in buffer, an array of count records of size bytes, count being
+ * a power of two; close, if not NULL, is called once every record has been
+ * formatted, right before the file is closed, for buffering formats to write
+ * what they still hold; channel must stay valid until logger_exit()
+ *
+ * returns -1 if:
+ *  - writer thread is not running
+ *  - LOGGER_CHANNEL_MAX channels are already opened
+ *  - size is bigger than LOGGER_RECORD_MAX
+ *  - pathname file could not be opened for writing
+ */
+
+int logger_open(
+    logger_channel_t * channel, const char * pathname, logger_format_t format,
+    logger_close_t close, void * buffer, size_t size, unsigned long count
+);
+
+/*
+ * logger_push()
+ *
+ * queue a copy of record to channel, never blocks and never enters Linux, so
+ * it can be called from a real-time task, but from one task only per channel
+ *
+ * returns -1 if:
+ *  - channel ring is full, record is dropped
+ */
+
+int logger_push(logger_channel_t * channel, const void * record);
+
+/*
+ * logger_get_stats()
+ *
+ * write channel statistics to dest
+ */
+
+void logger_get_stats(const logger_channel_t * channel, logger_stats_t * dest);
+
+#endif
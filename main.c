@@ -1,26 +1,35 @@
+#include "bus.h"
 #include "speed.h"
 #include "gps.h"
+#include "energy.h"
+#include "telemetry.h"
+#include "sector.h"
+#include "lap.h"
+#include "logger.h"
+#include "latency.h"
+#include "reckon.h"
+#include "render.h"
+#include "track.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <time.h>
 #include <errno.h>
 #include <math.h>
-#include <float.h>
 #include <unistd.h>
 #include <signal.h>
 #include <sys/mman.h>
 #include <sys/mount.h>
 #include <sys/stat.h>
 #include <xenomai/native/task.h>
+#include <xenomai/native/timer.h>
 #include <psgc.h>
 
 /* types ==================================================================== */
 typedef struct status_t status_t;
-typedef struct sensor_t sensor_t;
-typedef struct sector_t sector_t;
 typedef struct config_file_t config_file_t;
-typedef struct sector_file_t sector_file_t;
 
 /* structures =============================================================== */
 struct status_t {
@@ -28,31 +37,39 @@ struct status_t {
     unsigned int started:1;
 };
 
-struct sensor_t {
-    int (* init)(void);
-    int (* exit)(void);
-};
-
-struct sector_t {
-    double latitude;
-    double longitude;
-    double speed_min;
-    double speed_max;
-};
-
 struct config_file_t {
     unsigned int wheel_length;
     double gps_epsilon_latitude;
     double gps_epsilon_longitude;
-};
-
-struct sector_file_t {
-    sector_t sectors[8192];
-    size_t count;
+    unsigned long speed_window_rotations;
+    double speed_window_seconds;
+    double speed_debounce_fraction;
+    double speed_debounce_min;
+    double speed_debounce_max;
+    int log_binary;
+    unsigned long gps_baud;
+    unsigned long gps_rate;
+    char gps_device[64];
+    double log_sync;
+    char energy_source[64];
+    unsigned long energy_rate;
+    unsigned long energy_decimation;
+    double energy_voltage_scale;
+    double energy_current_scale;
+    char telemetry_link[64];
+    unsigned long telemetry_baud;
+    unsigned long telemetry_budget;
+    unsigned int speed_pulses;
+    double gps_latency;
 };
 
 /* constants ================================================================ */
+#ifndef ECOROOT
 #define ECOROOT "/var/lib/ecollect"
+#endif
+
+#define LCD_BUDGET (115200 / 10 / 2) /* bytes/s, half of the LCD link */
+#define LCD_BURST 64                 /* bytes */
 
 /* macros =================================================================== */
 #define BUG_ON(assertion) \
@@ -73,25 +90,35 @@ struct sector_file_t {
 static volatile int shutdown;
 
 static psgc_t * psgc;
+static render_t render;
 
 static status_t status = {
     .loaded = 0,
     .started = 0
 };
 
-static const sensor_t sensors[] = {
-    {
-        .init = speed_init,
-        .exit = speed_exit
-    },
-    {
-        .init = gps_init,
-        .exit = gps_exit
-    }
+static const bus_sensor_t speed_sensor = {
+    .name = "speed",
+    .init = speed_init,
+    .exit = speed_exit
+};
+
+static const bus_sensor_t gps_sensor = {
+    .name = "gps",
+    .init = gps_init,
+    .exit = gps_exit
+};
+
+static const bus_sensor_t energy_sensor = {
+    .name = "energy",
+    .init = energy_init,
+    .exit = energy_exit
 };
 
 static config_file_t config_file;
 static sector_file_t sector_file;
+static reckon_t reckon;
+static lap_t lap;
 
 /* private functions ======================================================== */
 static void handler(int signum) {
@@ -117,28 +144,62 @@ static void load(void) {
             fscanf(fp, "%lf", &config_file.gps_epsilon_latitude);
             fscanf(fp, "%lf", &config_file.gps_epsilon_longitude);
 
+            /* optional, speed rolling windows ------------------------------ */
+            fscanf(fp, "%lu", &config_file.speed_window_rotations);
+            fscanf(fp, "%lf", &config_file.speed_window_seconds);
+
+            /* optional, wheel sensor edge filter (in s) -------------------- */
+            fscanf(fp, "%lf", &config_file.speed_debounce_fraction);
+            fscanf(fp, "%lf", &config_file.speed_debounce_min);
+            fscanf(fp, "%lf", &config_file.speed_debounce_max);
+
+            /* optional, 1 for compact binary session files ----------------- */
+            fscanf(fp, "%d", &config_file.log_binary);
+
+            /* optional, GPS receiver baud & fix rate (in Hz), device ------- */
+            fscanf(fp, "%lu", &config_file.gps_baud);
+            fscanf(fp, "%lu", &config_file.gps_rate);
+            fscanf(fp, "%63s", config_file.gps_device);
+
+            /* optional, seconds of data a power cut may lose --------------- */
+            fscanf(fp, "%lf", &config_file.log_sync);
+
+            /* optional, ADC or recording, rate (in Hz), decimation, and
+               scales (in mV and mA per count), no energy without -------- */
+            fscanf(fp, "%63s", config_file.energy_source);
+            fscanf(fp, "%lu", &config_file.energy_rate);
+            fscanf(fp, "%lu", &config_file.energy_decimation);
+            fscanf(fp, "%lf", &config_file.energy_voltage_scale);
+            fscanf(fp, "%lf", &config_file.energy_current_scale);
+
+            /* optional, "udp:host:port" or radio tty, baud, and bytes/s --- */
+            fscanf(fp, "%63s", config_file.telemetry_link);
+            fscanf(fp, "%lu", &config_file.telemetry_baud);
+            fscanf(fp, "%lu", &config_file.telemetry_budget);
+
+            /* optional, wheel sensor pulses per rotation (magnets) --------- */
+            fscanf(fp, "%u", &config_file.speed_pulses);
+
+            /* optional, GPS receiver latency, fix epoch to output (in s) -- */
+            fscanf(fp, "%lf", &config_file.gps_latency);
+
             /* close config file -------------------------------------------- */
             fclose(fp);
         }
 
-        /* open sector file ------------------------------------------------- */
-        if ((fp = fopen(ECOROOT "/sectors", "r")) != NULL) {
-            /* load sector file into memory --------------------------------- */
-            while (
-                sector_file.count < ARRAY_SIZE(sector_file.sectors) &&
-                fscanf(
-                    fp, "%lf,%lf,%lf,%lf",
-                    &sector_file.sectors[sector_file.count].latitude,
-                    &sector_file.sectors[sector_file.count].longitude,
-                    &sector_file.sectors[sector_file.count].speed_min,
-                    &sector_file.sectors[sector_file.count].speed_max
-                ) == 4
-            ) {
-                ++sector_file.count;
-            }
-
-            /* close sector file -------------------------------------------- */
-            fclose(fp);
+        /* load compiled sector file, or text one, sized to the track ------- */
+        if (
+            sector_file_load(
+                &sector_file, ECOROOT "/sectors.bin",
+                config_file.gps_epsilon_latitude,
+                config_file.gps_epsilon_longitude
+            ) == -1
+        ) {
+            sector_file_load_text(
+                &sector_file, ECOROOT "/sectors",
+                config_file.gps_epsilon_latitude,
+                config_file.gps_epsilon_longitude
+            );
         }
 
         /* OK, USB key is mounted and data have been loaded ----------------- */
@@ -149,7 +210,7 @@ static void load(void) {
 static void unload(void) {
     /* clear loaded data ---------------------------------------------------- */
     memset(&config_file, 0, sizeof config_file);
-    memset(&sector_file, 0, sizeof sector_file);
+    sector_file_free(&sector_file);
 
     /* unmount & flush any data written to ECOROOT -------------------------- */
     BUG_ON(umount(ECOROOT) == -1);
@@ -159,7 +220,6 @@ static void unload(void) {
 }
 
 static void start() {
-    size_t i;
     time_t time_curr;
     struct tm tm_curr;
     char pathname[PATH_MAX];
@@ -171,23 +231,88 @@ static void start() {
     mkdir(pathname, 0777);
     chdir(pathname);
 
-    /* start sensor threads ------------------------------------------------- */
-    for (i = 0; i < ARRAY_SIZE(sensors); i++) {
-        BUG_ON(sensors[i].init() == -1);
+    /* start log writer thread, then sensor threads ------------------------- */
+    logger_set_binary(config_file.log_binary);
+    logger_set_sync(config_file.log_sync);
+    BUG_ON(logger_init() == -1);
+
+    speed_set_debounce(
+        config_file.speed_debounce_fraction, config_file.speed_debounce_min,
+        config_file.speed_debounce_max
+    );
+    speed_set_wheel(config_file.wheel_length);
+    speed_set_pulses(config_file.speed_pulses);
+    speed_set_windows(
+        config_file.speed_window_rotations, config_file.speed_window_seconds
+    );
+    gps_set_device(
+        config_file.gps_device, config_file.gps_baud, config_file.gps_rate
+    );
+    gps_set_latency(config_file.gps_latency);
+    energy_set_source(
+        config_file.energy_source, config_file.energy_voltage_scale,
+        config_file.energy_current_scale
+    );
+    energy_set_rate(config_file.energy_rate, config_file.energy_decimation);
+    telemetry_set_link(
+        config_file.telemetry_link, config_file.telemetry_baud,
+        config_file.telemetry_budget
+    );
+
+    /* sensors publish to the bus, which they attach to ------------------- */
+    bus_init();
+    BUG_ON(bus_attach(&speed_sensor) == -1);
+    BUG_ON(bus_attach(&gps_sensor) == -1);
+
+    if (config_file.energy_source[0] != '\0') {
+        BUG_ON(bus_attach(&energy_sensor) == -1);
+    }
+
+    /* tell the pit what the bus says, if there is a link ------------------- */
+    telemetry_set_sector(-1);
+
+    if (config_file.telemetry_link[0] != '\0') {
+        BUG_ON(telemetry_init() == -1);
     }
 
+    /* fuse what they log into a single track ------------------------------- */
+    BUG_ON(track_init(config_file.wheel_length, &sector_file) == -1);
+
+    /* no position until the first fix ------------------------------------- */
+    reckon_init(&reckon);
+
+    /* nothing in any sector yet, no lap either ----------------------------- */
+    BUG_ON(
+        lap_init(
+            &lap, sector_file.sectors, sector_file.count,
+            config_file.wheel_length
+        ) == -1
+    );
+
     /* ok, sensor threads are started --------------------------------------- */
     status.started = 1;
 }
 
 static void stop() {
-    size_t i;
-
-    /* stop sensor threads -------------------------------------------------- */
-    for (i = 0; i < ARRAY_SIZE(sensors); i++) {
-        BUG_ON(sensors[i].exit() == -1);
+    /* stop telemetry, if any, then sensor threads -------------------------- */
+    if (config_file.telemetry_link[0] != '\0') {
+        BUG_ON(telemetry_exit() == -1);
     }
 
+    BUG_ON(bus_exit() == -1);
+
+    BUG_ON(track_exit() == -1);
+
+    /* how far off dead reckoning was, whenever a fix landed ---------------- */
+    reckon_dump(&reckon, "reckon");
+
+    /* how each sector was driven, and how laps compared -------------------- */
+    lap_dump(&lap, "laps");
+    lap_free(&lap);
+
+    /* flush what sensors logged, and stop log writer thread ---------------- */
+    BUG_ON(logger_exit() == -1);
+
     /* chdir to a safe value ------------------------------------------------ */
     chdir("/");
 
@@ -238,8 +363,8 @@ static void screen_1(void) {
 static void screen_2(int * next) {
     int id = 0;
     size_t i = 0;
-    double speed_min = DBL_MIN;
-    double speed_max = DBL_MAX;
+    long speed_min = -1;
+    long speed_max = -1;
 
     /* display static content ----------------------------------------------- */
     psgc_clear(psgc);
@@ -272,7 +397,8 @@ static void screen_2(int * next) {
             psgc_draw_text(
                 psgc, 16, 48 + id * 32, PSGC_FONT_12X16,
                 PSGC_RGB555(31, 31, 31), 1, 1,
-                "S%d %8.1f %8.1f", id + 1, speed_min, speed_max
+                "S%d %8.1f %8.1f", id + 1, FIXED_TO_KMH(speed_min),
+                FIXED_TO_KMH(speed_max)
             );
 
             ++id;
@@ -307,6 +433,11 @@ static void screen_2(int * next) {
 
 static void screen_3(void) {
     size_t sector_curr = 0;
+    unsigned long rotations = 0;
+    unsigned long matched = 0;
+    unsigned long frames = 0;
+    u_int16_t color = PSGC_RGB555(31, 31, 31);
+    int instant, average, power, energy, laps, lap_last, lap_over;
 
     /* display static content ----------------------------------------------- */
     psgc_clear(psgc);
@@ -319,106 +450,170 @@ static void screen_3(void) {
     /* next blits must be in opaque mode ------------------------------------ */
     psgc_set_opaque(psgc, PSGC_OPAQUE_ON);
 
+    /* speeds only send what changed, instant speed and colour first -------- */
+    render_init(&render, psgc, LCD_BUDGET, LCD_BURST);
+
+    instant = render_add(&render, 16, 16, PSGC_FONT_12X16, 4, 4);
+    average = render_add(&render, 16, 112, PSGC_FONT_12X16, 4, 4);
+    power = render_add(&render, 144, 184, PSGC_FONT_12X16, 1, 1);
+    energy = render_add(&render, 144, 208, PSGC_FONT_12X16, 1, 1);
+    laps = render_add(&render, 264, 16, PSGC_FONT_8X12, 1, 1);
+    lap_last = render_add(&render, 264, 32, PSGC_FONT_8X12, 1, 1);
+    lap_over = render_add(&render, 264, 48, PSGC_FONT_8X12, 1, 1);
+
     /* start event loop ----------------------------------------------------- */
     while (!shutdown && status.started) {
-        double speed_instant, speed_average;
-        u_int16_t color = PSGC_RGB555(31, 31, 31);
+        speed_snapshot_t speed;
+        gps_fix_t fix;
+        energy_snapshot_t watts;
+        unsigned long speed_instant, speed_average, speed_smooth;
+        unsigned long power_tenths;
+        unsigned long long energy_hundredths;
+        double distance, latitude, longitude;
         u_int16_t event = PSGC_EVENT_NONE;
         u_int16_t x, y;
 
-        /* fetch speed sensor data ------------------------------------------ */
-        speed_get_instant(&speed_instant);
-        speed_get_average(&speed_average);
-
-        /* convert speed from Hz to km/h ------------------------------------ */
-        speed_instant *= config_file.wheel_length / 1000.0 * 3.6;
-        speed_average *= config_file.wheel_length / 1000.0 * 3.6;
-
-        /* if sector file has been loaded and was not empty ----------------- */
-        if (sector_file.count > 0) {
-            char gps_frame[GPS_FRAME_SIZE];
-            double latitude, longitude;
-            double latitude_min, longitude_min;
-            char latitude_dir, longitude_dir, fix;
-
-            /* fetch GPS sensor data ---------------------------------------- */
-            gps_get_frame(gps_frame);
-
-            /* decode GPS frame and check if it is valid (fix is 1 or 2) ---- */
-            if (
-                sscanf(
-                    gps_frame, "$GPGGA,%*f,%2lf%lf,%c,%3lf%lf,%c,%c",
-                    &latitude, &latitude_min, &latitude_dir,
-                    &longitude, &longitude_min, &longitude_dir,
-                    &fix
-                ) == 7 && (
-                    fix == '1' || fix == '2'
-                )
-            ) {
-                size_t k = 0;
-
-                /* convert dumb NMEA latitude format to real degrees -------- */
-                latitude += latitude_min / 60;
-                latitude *= latitude_dir == 'N' ? 1 : -1;
-
-                /* convert dumb NMEA longitude format to real degrees ------- */
-                longitude += longitude_min / 60;
-                longitude *= longitude_dir == 'E' ? 1 : -1;
-
-                /* try to match a sector ------------------------------------ */
-                while (
-                    k < sector_file.count &&
-                    ! COLLIDE(
-                        latitude, longitude,
-                        sector_file.sectors[sector_curr].latitude -
-                        config_file.gps_epsilon_latitude,
-                        sector_file.sectors[sector_curr].longitude -
-                        config_file.gps_epsilon_longitude,
-                        2 * config_file.gps_epsilon_latitude,
-                        2 * config_file.gps_epsilon_longitude
-                    )
-                ) {
-                    if (++sector_curr == sector_file.count) {
-                        sector_curr = 0;
-                    }
+        /* fetch speed and GPS sensor data, already decoded ----------------- */
+        bus_read(BUS_SPEED, &speed, sizeof speed, NULL);
+        bus_read(BUS_GPS, &fix, sizeof fix, NULL);
+
+        /* fuse whatever is new in them into the track ---------------------- */
+        track_update(&speed, &fix);
+
+        /* convert speed from mm/s to 1/10 km/h, the instant one falls while
+           the next pulse keeps not coming, smoothed one is already mm/s -- */
+        speed_instant = FIXED_TO_DECIKMH(speed_decay(&speed, rt_timer_read()));
+        speed_average = FIXED_TO_DECIKMH(speed.average);
+        speed_smooth = speed.by_rotations.mean;
 
-                    ++k;
+        /* wheel odometer (in m), only when a fix or a rotation needs it ---- */
+        if (fix.frames != frames || speed.rotations != matched) {
+            distance = speed.rotations * (config_file.wheel_length / 1000.0);
+        }
+
+        /* a new valid fix (fix is 1 or 2) corrects the position estimate --- */
+        if (fix.frames != frames) {
+            frames = fix.frames;
+
+            if (fix.nmea.quality == 1 || fix.nmea.quality == 2) {
+                reckon_fix(
+                    &reckon, FIXED_TO_DEGREES(fix.nmea.latitude),
+                    FIXED_TO_DEGREES(fix.nmea.longitude), distance
+                );
+
+                /* a fix tells where we are too, moving or not, once its time
+                   is on the rotations timebase (see gps.h) ------------- */
+                if (fix.fix_time != 0) {
+                    lap_locate(
+                        &lap, sector_file.count > 0 && sector_match(
+                            &sector_file.index, sector_file.sectors,
+                            sector_file.count, fix.nmea.latitude,
+                            fix.nmea.longitude, &sector_curr
+                        ) != -1 ? (int) sector_curr : LAP_NONE,
+                        fix.fix_time
+                    );
                 }
+            }
+        }
 
-                /* if we've matched a sector -------------------------------- */
-                if (k != sector_file.count) {
-                    /* change color to green, yellow or red ----------------- */
-                    sector_t sector = sector_file.sectors[sector_curr];
-
-                    if (
-                        speed_instant > sector.speed_min &&
-                        speed_instant < sector.speed_max
-                    ) {
-                        color = PSGC_RGB555(31, 31, 0);
-                    }
-                    else {
-                        if (speed_instant < sector.speed_min) {
-                            color = PSGC_RGB555(0, 31, 0);
-                        }
-                        else {
-                            color = PSGC_RGB555(31, 0, 0);
-                        }
-                    }
+        /* match sector and pick colour on every rotation, not every fix ---- */
+        if (speed.rotations != matched) {
+            matched = speed.rotations;
+            color = PSGC_RGB555(31, 31, 31);
+
+            /* the rotations since previous one go where we were ----------- */
+            lap_rotation(&lap, speed.rotations, speed.rotation_time);
+
+            /* if sector file has been loaded and was not empty, and we know
+               where we are, try to match a sector, if we've matched one --- */
+            lap_locate(
+                &lap, sector_file.count > 0 && reckon_position(
+                    &reckon, distance, &latitude, &longitude
+                ) != -1 && sector_match(
+                    &sector_file.index, sector_file.sectors,
+                    sector_file.count, FIXED_FROM_DEGREES(latitude),
+                    FIXED_FROM_DEGREES(longitude), &sector_curr
+                ) != -1 ? (int) sector_curr : LAP_NONE, speed.rotation_time
+            );
+
+            /* the sector we are in, once matches agree on it -------------- */
+            telemetry_set_sector(lap.sector);
+
+            if (lap.sector != LAP_NONE) {
+                /* green, yellow or red, from smoothed speed ---------------- */
+                switch (
+                    sector_band(&sector_file.sectors[lap.sector], speed_smooth)
+                ) {
+                case SECTOR_IN:
+                    color = PSGC_RGB555(31, 31, 0);
+                    break;
+                case SECTOR_UNDER:
+                    color = PSGC_RGB555(0, 31, 0);
+                    break;
+                default:
+                    color = PSGC_RGB555(31, 0, 0);
+                    break;
                 }
             }
         }
 
-        /* display instant speed -------------------------------------------- */
-        psgc_draw_text(
-            psgc, 16, 16, PSGC_FONT_12X16, color, 4, 4,
-            "%5.1f", speed_instant
+        /* display instant and average speed -------------------------------- */
+        render_set(
+            &render, instant, color, "%3lu.%lu", speed_instant / 10,
+            speed_instant % 10
+        );
+        render_set(
+            &render, average, PSGC_RGB555(31, 31, 31), "%3lu.%lu",
+            speed_average / 10, speed_average % 10
         );
 
-        /* display average speed -------------------------------------------- */
-        psgc_draw_text(
-            psgc, 16, 112, PSGC_FONT_12X16, PSGC_RGB555(31, 31, 31), 4, 4,
-            "%5.1f", speed_average
+        /* display power and energy, signed as regen brakes charge, if any */
+        if (bus_read(BUS_ENERGY, &watts, sizeof watts, NULL) != -1) {
+            power_tenths = labs(watts.power) / 100;
+            energy_hundredths = (watts.energy < 0 ? -watts.energy :
+                watts.energy) / (ENERGY_NJ_PER_WH / 100);
+
+            render_set(
+                &render, power, PSGC_RGB555(31, 31, 31), "%c%5lu.%lu W",
+                watts.power < 0 ? '-' : ' ', power_tenths / 10,
+                power_tenths % 10
+            );
+            render_set(
+                &render, energy, PSGC_RGB555(31, 31, 31), "%c%4llu.%02llu Wh",
+                watts.energy < 0 ? '-' : ' ', energy_hundredths / 100,
+                energy_hundredths % 100
+            );
+        }
+
+        /* display laps, latest lap time, and time over in this lap ------- */
+        render_set(
+            &render, laps, PSGC_RGB555(31, 31, 31), "LAP%3lu", lap.lap_count
         );
+        render_set(
+            &render, lap_last, PSGC_RGB555(31, 31, 31), "%2llu:%02llu.%llu",
+            lap.previous.time / 60000000000ULL % 100,
+            lap.previous.time / 1000000000 % 60,
+            lap.previous.time / 100000000 % 10
+        );
+        render_set(
+            &render, lap_over, lap.current.over > 0 ?
+            PSGC_RGB555(31, 0, 0) : PSGC_RGB555(31, 31, 31), "+%4llu.%llu",
+            lap.current.over / 1000000000 % 10000,
+            lap.current.over / 100000000 % 10
+        );
+
+        render_flush(&render, rt_timer_read());
+
+        /* a new rotation made it to the LCD, how long did it take? --------- */
+        if (
+            speed.rotations != rotations && !render_pending(&render, instant)
+        ) {
+            rotations = speed.rotations;
+
+            latency_record(
+                LATENCY_PUBLISH_TO_DRAW, rt_timer_read() - speed.published
+            );
+        }
 
         /* check if user is pushing "STOP" button --------------------------- */
         psgc_read_touchscreen(psgc, &event, &x, &y);
@@ -465,7 +660,7 @@ int main(void) {
     screen = 1;
 
     while (!shutdown) {
-        int next;
+        int next = 1;
 
         switch (screen) {
         case 1:
@@ -0,0 +1,457 @@
+#include "nmea.h"
+
+#include <limits.h>
+#include <string.h>
+
+/* constants ================================================================ */
+#define STATE_IDLE 0
+#define STATE_BODY 1
+#define STATE_CHECKSUM_HIGH 2
+#define STATE_CHECKSUM_LOW 3
+
+#define TYPE_UNKNOWN 0
+#define TYPE_GGA NMEA_GGA
+#define TYPE_RMC NMEA_RMC
+#define TYPE_VTG NMEA_VTG
+#define TYPE_OTHER NMEA_OTHER
+
+#define GGA_TIME 1
+#define GGA_LATITUDE 2
+#define GGA_LATITUDE_DIR 3
+#define GGA_LONGITUDE 4
+#define GGA_LONGITUDE_DIR 5
+#define GGA_QUALITY 6
+#define GGA_SATELLITES 7
+#define GGA_HDOP 8
+
+#define GGA_FIX ( \
+    1 << GGA_TIME | 1 << GGA_LATITUDE | 1 << GGA_LATITUDE_DIR | \
+    1 << GGA_LONGITUDE | 1 << GGA_LONGITUDE_DIR \
+)
+
+#define RMC_TIME 1
+#define RMC_STATUS 2
+#define RMC_SPEED 7
+#define RMC_COURSE 8
+
+#define VTG_COURSE 1
+#define VTG_SPEED_KNOTS 5
+#define VTG_SPEED 7
+#define VTG_MODE 9
+
+#define KNOTS 1.852 /* km/h */
+
+#define DIGITS_MAX 9
+#define DECIMALS_MAX 7
+
+#define MINUTE_SCALE 100000UL /* minutes are decoded to 1e-5 */
+
+/* private functions ======================================================== */
+static int hex(int c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+
+    return -1;
+}
+
+static void reject(nmea_parser_t * parser) {
+    ++parser->errors;
+    parser->state = STATE_IDLE;
+}
+
+static void field_begin(nmea_parser_t * parser) {
+    parser->digits = 0;
+    parser->decimals = 0;
+    parser->dot = 0;
+    parser->integer = 0;
+    parser->fraction = 0;
+    parser->scale = 1;
+    parser->letter = 0;
+    parser->invalid = 0;
+}
+
+static void field_char(nmea_parser_t * parser, int c) {
+    if (parser->field == 0) {
+        if (parser->digits < sizeof parser->address) {
+            parser->address[parser->digits] = c;
+        }
+
+        ++parser->digits;
+        return;
+    }
+
+    if (c >= '0' && c <= '9' && !parser->letter) {
+        if (parser->dot) {
+            /* decimals past DECIMALS_MAX are way below a cm, ignore them -- */
+            if (parser->decimals < DECIMALS_MAX) {
+                parser->fraction = parser->fraction * 10 + (c - '0');
+                parser->scale *= 10;
+                ++parser->decimals;
+            }
+        }
+        else if (parser->digits < DIGITS_MAX) {
+            parser->integer = parser->integer * 10 + (c - '0');
+            ++parser->digits;
+        }
+        else {
+            parser->invalid = 1;
+        }
+    }
+    else if (c == '.' && !parser->dot && !parser->letter) {
+        parser->dot = 1;
+    }
+    else if (!parser->letter && !parser->digits && !parser->dot) {
+        parser->letter = c;
+    }
+    else {
+        parser->invalid = 1;
+    }
+}
+
+static double field_real(const nmea_parser_t * parser) {
+    return parser->integer + (double) parser->fraction / parser->scale;
+}
+
+static long field_degrees(const nmea_parser_t * parser) {
+    unsigned long fraction = parser->fraction;
+    unsigned long scale = parser->scale;
+    unsigned long minutes;
+
+    /* bring decimals to MINUTE_SCALE by powers of ten, no division call --- */
+    for (; scale < MINUTE_SCALE; scale *= 10) {
+        fraction *= 10;
+    }
+
+    for (; scale > MINUTE_SCALE; scale /= 10) {
+        fraction /= 10;
+    }
+
+    /* dumb NMEA format: (d)ddmm.mmmm, degrees and minutes ------------------ */
+    minutes = parser->integer % 100 * MINUTE_SCALE + fraction;
+
+    /* 1e-5 minute is 1 / 6 micro-degree, round to nearest ----------------- */
+    return parser->integer / 100 * FIXED_DEGREE + (minutes + 3) / 6;
+}
+
+static unsigned long field_time(const nmea_parser_t * parser) {
+    /* hhmmss.sss, to ms of the day ----------------------------------------- */
+    return (
+        parser->integer / 10000 * 3600 +
+        parser->integer / 100 % 100 * 60 +
+        parser->integer % 100
+    ) * 1000 + parser->fraction * 1000 / parser->scale;
+}
+
+static int field_gga(nmea_parser_t * parser) {
+    nmea_fix_t * fix = &parser->fix;
+
+    switch (parser->field) {
+    case GGA_TIME:
+        fix->time = field_time(parser);
+        break;
+    case GGA_LATITUDE:
+        fix->latitude = field_degrees(parser);
+        break;
+    case GGA_LATITUDE_DIR:
+        if (parser->letter == 'S') {
+            fix->latitude = -fix->latitude;
+        }
+        else if (parser->letter != 'N') {
+            return -1;
+        }
+        break;
+    case GGA_LONGITUDE:
+        fix->longitude = field_degrees(parser);
+        break;
+    case GGA_LONGITUDE_DIR:
+        if (parser->letter == 'W') {
+            fix->longitude = -fix->longitude;
+        }
+        else if (parser->letter != 'E') {
+            return -1;
+        }
+        break;
+    case GGA_QUALITY:
+        fix->quality = parser->integer;
+        break;
+    case GGA_SATELLITES:
+        fix->satellites = parser->integer;
+        break;
+    case GGA_HDOP:
+        fix->hdop = field_real(parser);
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+static int field_rmc(nmea_parser_t * parser) {
+    nmea_motion_t * motion = &parser->motion;
+
+    switch (parser->field) {
+    case RMC_TIME:
+        motion->time = field_time(parser);
+        break;
+    case RMC_STATUS:
+        if (parser->letter != 'A' && parser->letter != 'V') {
+            return -1;
+        }
+
+        motion->valid = parser->letter == 'A';
+        break;
+    case RMC_SPEED:
+        motion->speed = field_real(parser) * KNOTS;
+        break;
+    case RMC_COURSE:
+        motion->course = field_real(parser);
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+static int field_vtg(nmea_parser_t * parser) {
+    nmea_motion_t * motion = &parser->motion;
+
+    switch (parser->field) {
+    case VTG_COURSE:
+        motion->course = field_real(parser);
+        break;
+    case VTG_SPEED_KNOTS:
+        /* km/h field, if any, comes next and is more precise -------------- */
+        motion->speed = field_real(parser) * KNOTS;
+        break;
+    case VTG_SPEED:
+        motion->speed = field_real(parser);
+        break;
+    case VTG_MODE:
+        /* NMEA 2.3 and later: N for data not valid ------------------------ */
+        if (parser->letter == 'N') {
+            motion->valid = 0;
+        }
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+static int field_end(nmea_parser_t * parser) {
+    int empty = !parser->digits && !parser->dot && !parser->letter;
+
+    if (parser->field == 0) {
+        /* $ttGGA, $ttRMC, $ttVTG, whatever the talker --------------------- */
+        parser->type = TYPE_OTHER;
+
+        if (parser->digits == 5) {
+            if (memcmp(parser->address + 2, "GGA", 3) == 0) {
+                parser->type = TYPE_GGA;
+                memset(&parser->fix, 0, sizeof parser->fix);
+            }
+            else if (memcmp(parser->address + 2, "RMC", 3) == 0) {
+                parser->type = TYPE_RMC;
+                memset(&parser->motion, 0, sizeof parser->motion);
+            }
+            else if (memcmp(parser->address + 2, "VTG", 3) == 0) {
+                parser->type = TYPE_VTG;
+                memset(&parser->motion, 0, sizeof parser->motion);
+                parser->motion.valid = 1;
+            }
+        }
+
+        /* anything else is only checked, not decoded ---------------------- */
+        return 0;
+    }
+
+    if (parser->type == TYPE_OTHER) {
+        return 0;
+    }
+
+    if (parser->invalid) {
+        return -1;
+    }
+
+    if (empty) {
+        return 0;
+    }
+
+    /* fields past any the type defines are never decoded, nor masked ---- */
+    if (parser->field < sizeof parser->fields * CHAR_BIT) {
+        parser->fields |= 1U << parser->field;
+    }
+
+    switch (parser->type) {
+    case TYPE_GGA:
+        return field_gga(parser);
+    case TYPE_RMC:
+        return field_rmc(parser);
+    default:
+        return field_vtg(parser);
+    }
+}
+
+static int field_next(nmea_parser_t * parser) {
+    if (field_end(parser) == -1) {
+        reject(parser);
+        return -1;
+    }
+
+    ++parser->field;
+    field_begin(parser);
+
+    return 0;
+}
+
+static int sentence_end(nmea_parser_t * parser) {
+    parser->state = STATE_IDLE;
+
+    if (parser->checksum != parser->expected) {
+        ++parser->errors;
+        return NMEA_NONE;
+    }
+
+    switch (parser->type) {
+    case TYPE_GGA:
+        /* a fix must at least tell how good it is ------------------------- */
+        if (
+            !(parser->fields & 1 << GGA_QUALITY) || parser->field <= GGA_HDOP
+        ) {
+            ++parser->errors;
+            return NMEA_NONE;
+        }
+
+        /* and when and where it is, if it claims to be one ---------------- */
+        if (
+            parser->fix.quality != 0 &&
+            (parser->fields & GGA_FIX) != GGA_FIX
+        ) {
+            ++parser->errors;
+            return NMEA_NONE;
+        }
+        break;
+    case TYPE_RMC:
+        /* motion must tell whether it can be trusted ---------------------- */
+        if (!(parser->fields & 1 << RMC_STATUS)) {
+            ++parser->errors;
+            return NMEA_NONE;
+        }
+
+        /* and how fast, if it claims it can ------------------------------- */
+        if (parser->motion.valid && !(parser->fields & 1 << RMC_SPEED)) {
+            parser->motion.valid = 0;
+        }
+        break;
+    case TYPE_VTG:
+        /* a receiver without a fix sends empty fields --------------------- */
+        if (
+            !(parser->fields & (1 << VTG_SPEED | 1 << VTG_SPEED_KNOTS))
+        ) {
+            parser->motion.valid = 0;
+        }
+        break;
+    default:
+        break;
+    }
+
+    parser->sentence[parser->length] = '\0';
+
+    return parser->type;
+}
+
+/* public functions ========================================================= */
+void nmea_init(nmea_parser_t * parser) {
+    memset(parser, 0, sizeof *parser);
+    parser->state = STATE_IDLE;
+}
+
+int nmea_parse(nmea_parser_t * parser, int c) {
+    /* a '$' always starts a new sentence, even in the middle of one -------- */
+    if (c == '$') {
+        if (parser->state != STATE_IDLE) {
+            ++parser->errors;
+        }
+
+        parser->state = STATE_BODY;
+        parser->type = TYPE_UNKNOWN;
+        parser->field = 0;
+        parser->fields = 0;
+        parser->checksum = 0;
+        parser->length = 0;
+        parser->sentence[parser->length++] = c;
+        field_begin(parser);
+
+        return NMEA_NONE;
+    }
+
+    if (parser->state == STATE_IDLE) {
+        return NMEA_NONE;
+    }
+
+    /* keep raw sentence for logging, reject it if it is too long ----------- */
+    if (parser->length == NMEA_SENTENCE_MAX) {
+        reject(parser);
+        return NMEA_NONE;
+    }
+
+    parser->sentence[parser->length++] = c;
+
+    switch (parser->state) {
+    case STATE_BODY:
+        if (c == '\r' || c == '\n') {
+            /* truncated, or no checksum: not trusted ---------------------- */
+            reject(parser);
+        }
+        else if (c == '*') {
+            if (field_next(parser) != -1) {
+                parser->state = STATE_CHECKSUM_HIGH;
+            }
+        }
+        else if (c == ',') {
+            parser->checksum ^= c;
+            field_next(parser);
+        }
+        else {
+            parser->checksum ^= c;
+            field_char(parser, c);
+        }
+        break;
+    case STATE_CHECKSUM_HIGH:
+        if (hex(c) == -1) {
+            reject(parser);
+        }
+        else {
+            parser->expected = hex(c) << 4;
+            parser->state = STATE_CHECKSUM_LOW;
+        }
+        break;
+    case STATE_CHECKSUM_LOW:
+        if (hex(c) == -1) {
+            reject(parser);
+        }
+        else {
+            parser->expected |= hex(c);
+
+            return sentence_end(parser);
+        }
+        break;
+    default:
+        parser->state = STATE_IDLE;
+        break;
+    }
+
+    return NMEA_NONE;
+}
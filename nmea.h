@@ -0,0 +1,98 @@
+#ifndef NMEA_H
+#define NMEA_H
+
+#include "fixed.h"
+
+#include <stddef.h>
+
+#define NMEA_SENTENCE_MAX 96
+
+#define NMEA_NONE 0
+#define NMEA_GGA 1
+#define NMEA_RMC 2
+#define NMEA_VTG 3
+#define NMEA_OTHER 4
+
+typedef struct nmea_fix_t nmea_fix_t;
+typedef struct nmea_motion_t nmea_motion_t;
+typedef struct nmea_parser_t nmea_parser_t;
+
+struct nmea_fix_t {
+    unsigned long time;      /* UTC time of day (in ms) */
+    long latitude;           /* micro-degrees, positive north */
+    long longitude;          /* micro-degrees, positive east */
+    unsigned int quality;    /* 0 invalid, 1 GPS, 2 DGPS, ... */
+    unsigned int satellites; /* satellites in use */
+    double hdop;             /* horizontal dilution of precision */
+};
+
+struct nmea_motion_t {
+    unsigned long time;      /* UTC time of day (in ms), RMC only */
+    double speed;            /* over ground (in km/h) */
+    double course;           /* over ground (degrees, true north) */
+    int valid;               /* can speed and course be trusted? */
+};
+
+/*
+ * incremental NMEA 0183 parser: bytes are fed one by one as they come from
+ * the receiver, fields are decoded on the fly, so a sentence is never
+ * tokenized nor scanned twice, and is only accepted once its "*hh" checksum
+ * has been checked
+ */
+
+struct nmea_parser_t {
+    int state;
+    int type;
+    unsigned int field;
+    unsigned int fields;       /* bit mask of non empty decoded fields */
+    unsigned char checksum;    /* running XOR, from '$' (excluded) to '*' */
+    unsigned char expected;    /* checksum read after '*' */
+
+    /* field being decoded */
+    char address[5];
+    unsigned int digits;
+    unsigned int decimals;
+    int dot;
+    unsigned long integer;
+    unsigned long fraction;
+    unsigned long scale;
+    char letter;
+    int invalid;
+
+    /* sentence being decoded */
+    nmea_fix_t fix;
+    nmea_motion_t motion;
+    size_t length;
+    char sentence[NMEA_SENTENCE_MAX + 1];
+
+    unsigned long errors;      /* corrupt or truncated sentences */
+};
+
+/*
+ * nmea_init()
+ *
+ * reset parser, it will wait for the next '$'
+ */
+
+void nmea_init(nmea_parser_t * parser);
+
+/*
+ * nmea_parse()
+ *
+ * feed parser with one more byte c; when c completes a valid sentence, the
+ * sentence itself, from '$' to checksum, is a C string in parser->sentence,
+ * and what was decoded from it is in parser->fix (GGA) or parser->motion (RMC
+ * and VTG), until next call
+ *
+ * returns:
+ *  - NMEA_GGA if c completes a valid $--GGA sentence
+ *  - NMEA_RMC if c completes a valid $--RMC sentence
+ *  - NMEA_VTG if c completes a valid $--VTG sentence
+ *  - NMEA_OTHER if c completes a sentence of any other type, with a valid
+ *    checksum, such as a $PMTK001 acknowledgement
+ *  - NMEA_NONE otherwise
+ */
+
+int nmea_parse(nmea_parser_t * parser, int c);
+
+#endif
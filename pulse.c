@@ -0,0 +1,66 @@
+#include "pulse.h"
+#include "fixed.h"
+
+#include <string.h>
+
+/* public functions ========================================================= */
+void pulse_init(pulse_t * pulse, unsigned int per_revolution) {
+    memset(pulse, 0, sizeof *pulse);
+
+    pulse->per_revolution =
+        per_revolution > 0 && per_revolution <= PULSE_MAX ? per_revolution : 1;
+}
+
+void pulse_resync(pulse_t * pulse, unsigned long long time) {
+    pulse->times[0] = time;
+    pulse->next = 1;
+    pulse->known = 1;
+}
+
+unsigned int pulse_push(
+    pulse_t * pulse, unsigned long long time, unsigned long long * span
+) {
+    unsigned int periods, first;
+
+    if (pulse->known == 0) {
+        pulse_resync(pulse, time);
+        *span = 0;
+        return 0;
+    }
+
+    /* back a revolution, or to the oldest pulse known --------------------- */
+    periods = pulse->known < pulse->per_revolution ?
+        pulse->known : pulse->per_revolution;
+    first = (pulse->next + PULSE_MAX + 1 - periods) % (PULSE_MAX + 1);
+
+    *span = time - pulse->times[first];
+
+    pulse->times[pulse->next] = time;
+    pulse->next = (pulse->next + 1) % (PULSE_MAX + 1);
+
+    if (pulse->known <= pulse->per_revolution) {
+        ++pulse->known;
+    }
+
+    return periods;
+}
+
+unsigned long pulse_decay(
+    unsigned long instant, unsigned int wheel_length,
+    unsigned int per_revolution, unsigned long long elapsed
+) {
+    unsigned long bound;
+
+    if (elapsed == 0) {
+        return instant;
+    }
+
+    if (elapsed >= PULSE_STALE) {
+        return 0;
+    }
+
+    /* a pulse in elapsed at most, same mm/s as fixed_mms() of a pulse ----- */
+    bound = fixed_mms(wheel_length, elapsed * per_revolution);
+
+    return bound < instant ? bound : instant;
+}
@@ -0,0 +1,71 @@
+#ifndef PULSE_H
+#define PULSE_H
+
+#define PULSE_MAX 16            /* pulses per revolution, at most */
+#define PULSE_STALE (3ULL * 1000 * 1000 * 1000) /* ns, wheel stopped after */
+
+typedef struct pulse_t pulse_t;
+
+/*
+ * wheel sensor pulses, several per revolution when the wheel carries several
+ * magnets: a speed is timed from the latest pulse back to the one a whole
+ * revolution before, or as far back as pulses are known since the latest
+ * resync, so it changes on every pulse while uneven magnet spacing averages
+ * out, once a revolution is known
+ *
+ * times are in ns
+ */
+
+struct pulse_t {
+    unsigned int per_revolution;
+    unsigned long long times[PULSE_MAX + 1]; /* latest pulses, a ring */
+    unsigned int next;          /* where the next one goes */
+    unsigned int known;         /* pulses in ring, since latest resync */
+};
+
+/*
+ * pulse_init()
+ *
+ * setup for per_revolution pulses per revolution, 1 if 0 or more than
+ * PULSE_MAX, with no pulse known yet
+ */
+
+void pulse_init(pulse_t * pulse, unsigned int per_revolution);
+
+/*
+ * pulse_resync()
+ *
+ * forget every pulse but a new one at time, as after pulses were missed
+ */
+
+void pulse_resync(pulse_t * pulse, unsigned long long time);
+
+/*
+ * pulse_push()
+ *
+ * feed a pulse at time, and tell span, how long the latest pulse periods
+ * took, at most a revolution of them
+ *
+ * returns how many pulse periods span covers, 0 if it is the first pulse
+ */
+
+unsigned int pulse_push(
+    pulse_t * pulse, unsigned long long time, unsigned long long * span
+);
+
+/*
+ * pulse_decay()
+ *
+ * speed (in mm/s) to tell elapsed ns after the latest pulse, for a
+ * wheel_length mm wheel and per_revolution pulses, when instant was the
+ * speed at it: the next pulse has not come yet, so the wheel goes at most a
+ * pulse in elapsed, instant falls towards that, and to 0 once PULSE_STALE
+ * has gone by
+ */
+
+unsigned long pulse_decay(
+    unsigned long instant, unsigned int wheel_length,
+    unsigned int per_revolution, unsigned long long elapsed
+);
+
+#endif
@@ -0,0 +1,144 @@
+#include "reckon.h"
+
+#include <string.h>
+
+/* constants ================================================================ */
+#define METERS_PER_DEGREE 111320.0
+#define PI 3.14159265358979323846
+
+/* private functions ======================================================== */
+static double cosine(double degrees) {
+    /* Taylor series, well within a meter up to the poles, without libm ---- */
+    double x = degrees * PI / 180, x2 = x * x;
+
+    return 1 - x2 / 2 * (1 - x2 / 12 * (1 - x2 / 30 * (1 - x2 / 56)));
+}
+
+static double root(double x) {
+    double r = x > 1 ? x : 1, previous = 0;
+    int i;
+
+    /* Newton, converges from above, once per fix only ---------------------- */
+    for (i = 0; i < 64 && r != previous; i++) {
+        previous = r;
+        r = (r + x / r) / 2;
+    }
+
+    return x > 0 ? r : 0;
+}
+
+static void estimate(
+    const reckon_t * reckon, double distance, double * latitude,
+    double * longitude
+) {
+    double travelled = distance - reckon->distance;
+    double fade = 1 - travelled / RECKON_BLEND;
+
+    if (travelled < 0) {
+        travelled = 0;
+    }
+
+    if (fade < 0) {
+        fade = 0;
+    }
+
+    if (fade > 1) {
+        fade = 1;
+    }
+
+    *latitude =
+        reckon->latitude + reckon->heading_latitude * travelled +
+        reckon->offset_latitude * fade;
+    *longitude =
+        reckon->longitude + reckon->heading_longitude * travelled +
+        reckon->offset_longitude * fade;
+}
+
+/* public functions ========================================================= */
+void reckon_init(reckon_t * reckon) {
+    memset(reckon, 0, sizeof *reckon);
+    histogram_reset(&reckon->error);
+}
+
+void reckon_fix(
+    reckon_t * reckon, double latitude, double longitude, double distance
+) {
+    double estimate_latitude, estimate_longitude;
+    double travelled;
+
+    if (!reckon->located) {
+        reckon->located = 1;
+        reckon->base_latitude = latitude;
+        reckon->base_longitude = longitude;
+        reckon->base_distance = distance;
+    }
+    else if (
+        reckon_position(
+            reckon, distance, &estimate_latitude, &estimate_longitude
+        ) != -1
+    ) {
+        /* how wrong were we, in mm ---------------------------------------- */
+        double north = (estimate_latitude - latitude) * METERS_PER_DEGREE;
+        double east =
+            (estimate_longitude - longitude) * METERS_PER_DEGREE *
+            cosine(latitude);
+
+        histogram_record(
+            &reckon->error, root(north * north + east * east) * 1e3
+        );
+
+        /* fade from where we thought we were, rather than jump ------------ */
+        reckon->offset_latitude = estimate_latitude - latitude;
+        reckon->offset_longitude = estimate_longitude - longitude;
+    }
+    else {
+        ++reckon->missed;
+        reckon->offset_latitude = 0;
+        reckon->offset_longitude = 0;
+    }
+
+    /* enough travelled to tell the way, keep the previous one otherwise --- */
+    travelled = distance - reckon->base_distance;
+
+    if (travelled >= RECKON_BASELINE) {
+        reckon->heading_latitude =
+            (latitude - reckon->base_latitude) / travelled;
+        reckon->heading_longitude =
+            (longitude - reckon->base_longitude) / travelled;
+        reckon->base_latitude = latitude;
+        reckon->base_longitude = longitude;
+        reckon->base_distance = distance;
+    }
+
+    reckon->latitude = latitude;
+    reckon->longitude = longitude;
+    reckon->distance = distance;
+}
+
+int reckon_position(
+    const reckon_t * reckon, double distance, double * latitude,
+    double * longitude
+) {
+    if (!reckon->located || distance - reckon->distance > RECKON_RANGE) {
+        return -1;
+    }
+
+    estimate(reckon, distance, latitude, longitude);
+
+    return 0;
+}
+
+int reckon_dump(const reckon_t * reckon, const char * pathname) {
+    FILE * fp;
+
+    if ((fp = fopen(pathname, "w")) == NULL) {
+        return -1;
+    }
+
+    histogram_print(&reckon->error, fp, "error", 1e3);
+    fprintf(fp, "%lu fixes out of range\n", reckon->missed);
+
+    fclose(fp);
+
+    return 0;
+}
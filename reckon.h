@@ -0,0 +1,90 @@
+#ifndef RECKON_H
+#define RECKON_H
+
+#include "histogram.h"
+
+#define RECKON_BASELINE 2.0     /* m, travelled in between fixes for heading */
+#define RECKON_BLEND 10.0       /* m, to fade a fix correction over */
+#define RECKON_RANGE 100.0      /* m, since latest fix, before giving up */
+
+typedef struct reckon_t reckon_t;
+
+/*
+ * wheel odometry dead reckoning: the position is the latest fix, advanced by
+ * the distance the wheel travelled since, along the way the vehicle went in
+ * between the two latest fixes; that way is kept as degrees per wheel meter,
+ * so it needs no trigonometry and absorbs both the wheel length error and
+ * the shortcut a chord makes through a bend
+ *
+ * when a fix lands, the estimate does not jump to it: the gap in between is
+ * faded out over the next RECKON_BLEND meters; the gap itself, the estimate
+ * error against the real fix, is recorded (in mm) as a metric
+ *
+ * distances are the wheel odometer, in m, positions are in degrees
+ */
+
+struct reckon_t {
+    int located;                /* has there been a fix yet? */
+    double latitude;            /* latest fix */
+    double longitude;
+    double distance;            /* odometer at latest fix */
+    double base_latitude;       /* fix the way was last measured from */
+    double base_longitude;
+    double base_distance;
+    double heading_latitude;    /* degrees per wheel meter */
+    double heading_longitude;
+    double offset_latitude;     /* estimate - fix, when it landed */
+    double offset_longitude;
+
+    histogram_t error;          /* estimate error at each fix (in mm) */
+    unsigned long missed;       /* fixes that landed out of range */
+};
+
+/*
+ * reckon_init()
+ *
+ * setup estimator with no fix yet, and an empty error metric
+ */
+
+void reckon_init(reckon_t * reckon);
+
+/*
+ * reckon_fix()
+ *
+ * feed estimator with a valid fix, which landed when the odometer was at
+ * distance; the way is taken from the previous fix, unless too few meters
+ * were travelled since
+ */
+
+void reckon_fix(
+    reckon_t * reckon, double latitude, double longitude, double distance
+);
+
+/*
+ * reckon_position()
+ *
+ * estimate where the vehicle is, now that the odometer is at distance, to
+ * latitude and longitude
+ *
+ * returns -1 if:
+ *  - there has been no fix yet
+ *  - more than RECKON_RANGE meters were travelled since the latest one
+ */
+
+int reckon_position(
+    const reckon_t * reckon, double distance, double * latitude,
+    double * longitude
+);
+
+/*
+ * reckon_dump()
+ *
+ * save error metric (in m) to a pathname text file
+ *
+ * returns -1 if:
+ *  - pathname file could not be opened for writing
+ */
+
+int reckon_dump(const reckon_t * reckon, const char * pathname);
+
+#endif
@@ -0,0 +1,178 @@
+#include "render.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/* constants ================================================================ */
+#define NS 1000000000ULL
+
+/* 's' command: header, text and terminating NUL, then ACK */
+#define TEXT_OVERHEAD 12
+
+#define GLYPH_WIDTH_12X16 12
+
+/* private functions ======================================================== */
+static void refill(render_t * render, unsigned long long now) {
+    unsigned long long elapsed;
+
+    if (now <= render->time) {
+        return;
+    }
+
+    /* more than a second is a full bucket anyway, avoid overflows ---------- */
+    elapsed = now - render->time;
+    elapsed = elapsed > NS ? NS : elapsed;
+
+    render->credit += elapsed * render->budget;
+    render->time = now;
+
+    if (render->credit > render->burst * NS) {
+        render->credit = render->burst * NS;
+    }
+}
+
+/* public functions ========================================================= */
+void render_init(
+    render_t * render, psgc_t * psgc, unsigned long budget,
+    unsigned long burst
+) {
+    memset(render, 0, sizeof *render);
+
+    render->psgc = psgc;
+    render->budget = budget;
+    render->burst = burst;
+    render->credit = burst * NS;
+}
+
+int render_add(
+    render_t * render, u_int16_t x, u_int16_t y, int font, int width,
+    int height
+) {
+    render_widget_t * widget;
+
+    if (render->count == RENDER_WIDGET_MAX) {
+        return -1;
+    }
+
+    widget = &render->widgets[render->count];
+
+    memset(widget, 0, sizeof *widget);
+    widget->x = x;
+    widget->y = y;
+    widget->font = font;
+    widget->width = width;
+    widget->height = height;
+
+    return render->count++;
+}
+
+void render_set(
+    render_t * render, int id, u_int16_t color, const char * format, ...
+) {
+    render_widget_t * widget = &render->widgets[id];
+    va_list ap;
+
+    va_start(ap, format);
+    vsnprintf(widget->text, sizeof widget->text, format, ap);
+    va_end(ap);
+
+    widget->color = color;
+}
+
+int render_flush(render_t * render, unsigned long long now) {
+    size_t i;
+
+    refill(render, now);
+
+    for (i = 0; i < render->count; i++) {
+        render_widget_t * widget = &render->widgets[i];
+        char run[RENDER_TEXT_MAX];
+        size_t length = strlen(widget->text);
+        size_t drawn = strlen(widget->drawn_text);
+        size_t first = 0, last, size;
+
+        if (!render_pending(render, i)) {
+            continue;
+        }
+
+        /* blank what the new text no longer covers ------------------------ */
+        while (length < drawn) {
+            widget->text[length++] = ' ';
+        }
+
+        widget->text[length] = '\0';
+
+        /* same colour: only the glyphs in between first and last changes -- */
+        last = length;
+
+        if (
+            widget->drawn && widget->color == widget->drawn_color &&
+            widget->font == PSGC_FONT_12X16
+        ) {
+            while (
+                first < length && first < drawn &&
+                widget->text[first] == widget->drawn_text[first]
+            ) {
+                ++first;
+            }
+
+            while (
+                last > first && last <= drawn &&
+                widget->text[last - 1] == widget->drawn_text[last - 1]
+            ) {
+                --last;
+            }
+        }
+
+        size = TEXT_OVERHEAD + last - first;
+
+        /* out of budget, this one and the lower priority ones must wait --- */
+        if (size * NS > render->credit) {
+            ++render->deferred;
+            break;
+        }
+
+        memcpy(run, widget->text + first, last - first);
+        run[last - first] = '\0';
+
+        if (
+            psgc_draw_text(
+                render->psgc,
+                widget->x + first * GLYPH_WIDTH_12X16 * widget->width,
+                widget->y, widget->font, widget->color, widget->width,
+                widget->height, "%s", run
+            ) == -1
+        ) {
+            return -1;
+        }
+
+        render->credit -= size * NS;
+        ++render->commands;
+        render->bytes += size;
+
+        strcpy(widget->drawn_text, widget->text);
+        widget->drawn_color = widget->color;
+        widget->drawn = 1;
+    }
+
+    return 0;
+}
+
+int render_pending(const render_t * render, int id) {
+    const render_widget_t * widget = &render->widgets[id];
+
+    /* trailing blanks are already on screen when the text shrank ----------- */
+    size_t length = strlen(widget->text);
+    size_t drawn = strlen(widget->drawn_text);
+
+    if (!widget->drawn || widget->color != widget->drawn_color) {
+        return 1;
+    }
+
+    if (length > drawn || strncmp(widget->text, widget->drawn_text, length)) {
+        return 1;
+    }
+
+    return strspn(widget->drawn_text + length, " ") != drawn - length;
+}
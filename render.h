@@ -0,0 +1,109 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stddef.h>
+#include <psgc.h>
+
+#define RENDER_WIDGET_MAX 8
+#define RENDER_TEXT_MAX 16
+
+typedef struct render_widget_t render_widget_t;
+typedef struct render_t render_t;
+
+/*
+ * text widgets over the LCD serial link: the last drawn string and colour of
+ * every widget are cached, only glyphs that changed are sent again, and what
+ * is sent is paced by a byte budget (token bucket), so that the link is never
+ * saturated and touchscreen polling is not held back
+ *
+ * widgets are flushed in the order they were added, the first ones have
+ * priority: when the budget is spent, the following ones wait for next flush
+ */
+
+struct render_widget_t {
+    u_int16_t x;
+    u_int16_t y;
+    int font;
+    int width;                  /* glyph scaling, as for psgc_draw_text() */
+    int height;
+    int drawn;                  /* is something on screen yet? */
+    u_int16_t drawn_color;
+    char drawn_text[RENDER_TEXT_MAX];
+    u_int16_t color;            /* wanted */
+    char text[RENDER_TEXT_MAX];
+};
+
+struct render_t {
+    psgc_t * psgc;
+    render_widget_t widgets[RENDER_WIDGET_MAX];
+    size_t count;
+    unsigned long budget;       /* bytes per second */
+    unsigned long burst;        /* bytes, bucket size */
+    unsigned long long credit;  /* bytes, times 10^9 */
+    unsigned long long time;    /* last flush (in ns) */
+    unsigned long commands;     /* sent so far */
+    unsigned long bytes;
+    unsigned long deferred;     /* flushes cut short by the budget */
+};
+
+/*
+ * render_init()
+ *
+ * setup render over a freshly cleared psgc screen, with budget bytes per
+ * second on the link, burst bytes at most at once, which must be more than
+ * any single widget update
+ */
+
+void render_init(
+    render_t * render, psgc_t * psgc, unsigned long budget,
+    unsigned long burst
+);
+
+/*
+ * render_add()
+ *
+ * add a text widget at x, y, font and scaling as for psgc_draw_text(), it
+ * has lower priority than those already added; only PSGC_FONT_12X16 widgets
+ * are updated glyph by glyph, others are redrawn whole when they change
+ *
+ * returns -1 if:
+ *  - there are already RENDER_WIDGET_MAX widgets
+ */
+
+int render_add(
+    render_t * render, u_int16_t x, u_int16_t y, int font, int width,
+    int height
+);
+
+/*
+ * render_set()
+ *
+ * set what widget id should display, nothing is sent until render_flush(),
+ * text is truncated to RENDER_TEXT_MAX - 1 characters
+ */
+
+void render_set(
+    render_t * render, int id, u_int16_t color, const char * format, ...
+);
+
+/*
+ * render_flush()
+ *
+ * send changed glyphs of every widget, by priority, as long as the budget
+ * allows it at time now (in ns)
+ *
+ * returns -1 if:
+ *  - a psgc command failed
+ */
+
+int render_flush(render_t * render, unsigned long long now);
+
+/*
+ * render_pending()
+ *
+ * returns 1 if widget id has changes not sent yet, 0 if it is up to date
+ */
+
+int render_pending(const render_t * render, int id);
+
+#endif
@@ -0,0 +1,64 @@
+#include "ring.h"
+
+#include <string.h>
+
+/* public functions ========================================================= */
+void ring_init(ring_t * ring, void * buffer, size_t size, unsigned long count) {
+    ring->buffer = buffer;
+    ring->size = size;
+    ring->count = count;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->high_water = 0;
+    ring->dropped = 0;
+
+    __sync_synchronize();
+}
+
+int ring_push(ring_t * ring, const void * element) {
+    unsigned long head = ring->head;
+    unsigned long used = head - ring->tail;
+
+    if (used == ring->count) {
+        ++ring->dropped;
+        return -1;
+    }
+
+    memcpy(
+        ring->buffer + (head & (ring->count - 1)) * ring->size,
+        element, ring->size
+    );
+
+    if (used + 1 > ring->high_water) {
+        ring->high_water = used + 1;
+    }
+
+    /* element must be visible before the consumer sees the new head ------- */
+    __sync_synchronize();
+    ring->head = head + 1;
+
+    return 0;
+}
+
+int ring_pop(ring_t * ring, void * element) {
+    unsigned long tail = ring->tail;
+
+    if (tail == ring->head) {
+        return -1;
+    }
+
+    /* head has been read before the element it publishes ------------------ */
+    __sync_synchronize();
+
+    memcpy(
+        element,
+        ring->buffer + (tail & (ring->count - 1)) * ring->size,
+        ring->size
+    );
+
+    /* element must be copied before the producer may overwrite it --------- */
+    __sync_synchronize();
+    ring->tail = tail + 1;
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stddef.h>
+
+typedef struct ring_t ring_t;
+
+/*
+ * lock-free single-producer/single-consumer ring of fixed-size elements, over
+ * a preallocated buffer: pushing and popping only copy memory, so the producer
+ * may be a real-time task and the consumer a plain Linux thread
+ */
+
+struct ring_t {
+    unsigned char * buffer;
+    size_t size;                /* element size (in bytes) */
+    unsigned long count;        /* element count, a power of two */
+    volatile unsigned long head; /* next element to push, producer owned */
+    volatile unsigned long tail; /* next element to pop, consumer owned */
+    unsigned long high_water;   /* max elements ever queued, producer owned */
+    unsigned long dropped;      /* elements pushed while full, producer owned */
+};
+
+/*
+ * ring_init()
+ *
+ * setup ring over buffer, which must hold count elements of size bytes,
+ * count being a power of two
+ */
+
+void ring_init(ring_t * ring, void * buffer, size_t size, unsigned long count);
+
+/*
+ * ring_push()
+ *
+ * copy element to ring, only called by the producer
+ *
+ * returns -1 if:
+ *  - ring is full, element is dropped and counted as such
+ */
+
+int ring_push(ring_t * ring, const void * element);
+
+/*
+ * ring_pop()
+ *
+ * copy oldest element from ring to element, only called by the consumer
+ *
+ * returns -1 if:
+ *  - ring is empty
+ */
+
+int ring_pop(ring_t * ring, void * element);
+
+#endif
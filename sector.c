@@ -0,0 +1,464 @@
+#include "sector.h"
+#include "crc32.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* constants ================================================================ */
+#define FILE_MAGIC "ESEC"
+#define FILE_INDEXED 1
+
+#define TEXT_CAPACITY 256
+
+/* types ==================================================================== */
+typedef struct header_t header_t;
+
+/* structures =============================================================== */
+struct header_t {
+    char magic[4];
+    uint32_t version;
+    uint32_t count;
+    uint32_t flags;
+    int32_t epsilon_latitude;   /* index was built for, if FILE_INDEXED */
+    int32_t epsilon_longitude;
+    uint32_t index_size;        /* SECTOR_INDEX_SIZE, if FILE_INDEXED */
+    uint32_t checksum;          /* CRC-32 of everything after header */
+};
+
+/* private functions ======================================================== */
+static long cell(long x, long size) {
+    long c = x / size;
+
+    /* floor, C division truncates toward zero ------------------------------ */
+    if (x % size < 0) {
+        --c;
+    }
+
+    return c;
+}
+
+static unsigned int bucket(long row, long col) {
+    return (
+        (unsigned long) row * 73856093UL ^ (unsigned long) col * 19349663UL
+    ) & (SECTOR_INDEX_SIZE - 1);
+}
+
+static int collide(
+    const sector_index_t * index, const sector_t * sector,
+    long latitude, long longitude
+) {
+    return
+        latitude > sector->latitude - index->epsilon_latitude &&
+        latitude < sector->latitude + index->epsilon_latitude &&
+        longitude > sector->longitude - index->epsilon_longitude &&
+        longitude < sector->longitude + index->epsilon_longitude;
+}
+
+static int index_check(const int * head, const int * next, size_t count) {
+    size_t i;
+
+    /* CRC only tells the file is as written, not that it was written right:
+       heads must be sectors, and chains go to lower ones only, as
+       sector_index_build() makes them, so they always end ------------- */
+    for (i = 0; i < SECTOR_INDEX_SIZE; i++) {
+        if (head[i] < -1 || head[i] >= (long) count) {
+            return -1;
+        }
+    }
+
+    for (i = 0; i < count; i++) {
+        if (next[i] < -1 || next[i] >= (long) i) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int read_all(int fd, void * buffer, size_t size) {
+    unsigned char * p = buffer;
+
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+
+        if (n <= 0) {
+            return -1;
+        }
+
+        p += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+static int write_all(FILE * fp, const void * buffer, size_t size) {
+    return fwrite(buffer, 1, size, fp) == size ? 0 : -1;
+}
+
+/* public functions ========================================================= */
+void sector_index_build(
+    sector_index_t * index, const sector_t * sectors, size_t count,
+    long epsilon_latitude, long epsilon_longitude
+) {
+    size_t i;
+
+    index->epsilon_latitude = epsilon_latitude;
+    index->epsilon_longitude = epsilon_longitude;
+
+    for (i = 0; i < SECTOR_INDEX_SIZE; i++) {
+        index->head[i] = -1;
+    }
+
+    /* boxes are empty, keep index empty too -------------------------------- */
+    if (epsilon_latitude <= 0 || epsilon_longitude <= 0) {
+        return;
+    }
+
+    /* chain each sector in the bucket of the cell holding its center ------- */
+    for (i = 0; i < count; i++) {
+        unsigned int b = bucket(
+            cell(sectors[i].latitude, 2 * epsilon_latitude),
+            cell(sectors[i].longitude, 2 * epsilon_longitude)
+        );
+
+        index->next[i] = index->head[b];
+        index->head[b] = i;
+    }
+}
+
+int sector_match(
+    const sector_index_t * index, const sector_t * sectors, size_t count,
+    long latitude, long longitude, size_t * current
+) {
+    long row, col, r, c;
+    size_t best_distance = count;
+    int best = -1;
+
+    if (index->epsilon_latitude <= 0 || index->epsilon_longitude <= 0) {
+        return -1;
+    }
+
+    row = cell(latitude, 2 * index->epsilon_latitude);
+    col = cell(longitude, 2 * index->epsilon_longitude);
+
+    /*
+       A box is 2 * epsilon wide and centered on its sector, so a point can
+       only be inside if the sector center is less than one epsilon away, which
+       is at most one cell away. Among the candidates, keep the one the linear
+       wrap-around scan would have met first, starting from *current.
+    */
+    for (r = row - 1; r <= row + 1; r++) {
+        for (c = col - 1; c <= col + 1; c++) {
+            int i;
+
+            for (i = index->head[bucket(r, c)]; i != -1; i = index->next[i]) {
+                size_t distance = (i + count - *current) % count;
+
+                if (
+                    distance < best_distance &&
+                    collide(index, &sectors[i], latitude, longitude)
+                ) {
+                    best_distance = distance;
+                    best = i;
+                }
+            }
+        }
+    }
+
+    if (best == -1) {
+        return -1;
+    }
+
+    *current = best;
+
+    return 0;
+}
+
+int sector_scan(
+    const sector_index_t * index, const sector_t * sectors, size_t count,
+    long latitude, long longitude, size_t * current
+) {
+    size_t k;
+    size_t i = *current;
+
+    for (k = 0; k < count; k++) {
+        if (collide(index, &sectors[i], latitude, longitude)) {
+            *current = i;
+            return 0;
+        }
+
+        if (++i == count) {
+            i = 0;
+        }
+    }
+
+    return -1;
+}
+
+int sector_band(const sector_t * sector, long speed) {
+    if (speed > sector->speed_min && speed < sector->speed_max) {
+        return SECTOR_IN;
+    }
+
+    return speed < sector->speed_min ? SECTOR_UNDER : SECTOR_OVER;
+}
+
+int sector_file_load(
+    sector_file_t * file, const char * pathname, double epsilon_latitude,
+    double epsilon_longitude
+) {
+    header_t header;
+    struct stat st;
+    size_t sectors_size, index_size;
+    unsigned char * memory;
+    uint32_t checksum;
+    long latitude = FIXED_FROM_DEGREES(epsilon_latitude);
+    long longitude = FIXED_FROM_DEGREES(epsilon_longitude);
+    int fd;
+
+    memset(file, 0, sizeof *file);
+
+    if ((fd = open(pathname, O_RDONLY)) == -1) {
+        goto err_open;
+    }
+
+    if (fstat(fd, &st) == -1 || read_all(fd, &header, sizeof header) == -1) {
+        goto err_header;
+    }
+
+    if (
+        memcmp(header.magic, FILE_MAGIC, sizeof header.magic) != 0 ||
+        header.version != SECTOR_FILE_VERSION ||
+        header.count > INT32_MAX / sizeof (sector_t)
+    ) {
+        goto err_header;
+    }
+
+    if (
+        header.flags & FILE_INDEXED &&
+        header.index_size != SECTOR_INDEX_SIZE
+    ) {
+        goto err_header;
+    }
+
+    /* file must hold exactly what header tells ----------------------------- */
+    sectors_size = header.count * sizeof (sector_t);
+    index_size = (SECTOR_INDEX_SIZE + header.count) * sizeof (int);
+
+    if (
+        (size_t) st.st_size != sizeof header + sectors_size +
+        (header.flags & FILE_INDEXED ? index_size : 0)
+    ) {
+        goto err_header;
+    }
+
+    /* room for the index, whether it is in the file or not ---------------- */
+    if ((memory = malloc(sectors_size + index_size)) == NULL) {
+        goto err_memory;
+    }
+
+    /* one bulk read, USB keys are slow at many small ones ------------------ */
+    if (read_all(fd, memory, st.st_size - sizeof header) == -1) {
+        goto err_read;
+    }
+
+    checksum = crc32(0, memory, st.st_size - sizeof header);
+
+    if (checksum != header.checksum) {
+        goto err_read;
+    }
+
+    close(fd);
+
+    file->memory = memory;
+    file->sectors = (sector_t *) memory;
+    file->count = header.count;
+    file->index.next = (int *) (
+        memory + sectors_size + SECTOR_INDEX_SIZE * sizeof (int)
+    );
+
+    /* an index that does not check out is rebuilt, as sectors are fine --- */
+    if (
+        header.flags & FILE_INDEXED &&
+        header.epsilon_latitude == latitude &&
+        header.epsilon_longitude == longitude &&
+        index_check(
+            (const int *) (memory + sectors_size), file->index.next,
+            file->count
+        ) == 0
+    ) {
+        file->index.epsilon_latitude = latitude;
+        file->index.epsilon_longitude = longitude;
+        memcpy(
+            file->index.head, memory + sectors_size, sizeof file->index.head
+        );
+    }
+    else {
+        sector_index_build(
+            &file->index, file->sectors, file->count, latitude, longitude
+        );
+    }
+
+    return 0;
+
+err_read:
+    free(memory);
+err_memory:
+err_header:
+    close(fd);
+err_open:
+    return -1;
+}
+
+int sector_file_load_text(
+    sector_file_t * file, const char * pathname, double epsilon_latitude,
+    double epsilon_longitude
+) {
+    FILE * fp;
+    double latitude, longitude, speed_min, speed_max;
+    sector_t * sectors;
+    size_t count = 0, capacity = TEXT_CAPACITY;
+    void * memory;
+
+    memset(file, 0, sizeof *file);
+
+    if ((fp = fopen(pathname, "r")) == NULL) {
+        goto err_fp;
+    }
+
+    if ((sectors = malloc(capacity * sizeof *sectors)) == NULL) {
+        goto err_sectors;
+    }
+
+    /* as many sectors as there are, growing by doubling -------------------- */
+    while (
+        fscanf(
+            fp, "%lf,%lf,%lf,%lf", &latitude, &longitude, &speed_min,
+            &speed_max
+        ) == 4
+    ) {
+        if (count == capacity) {
+            memory = realloc(sectors, 2 * capacity * sizeof *sectors);
+
+            if (memory == NULL) {
+                goto err_grow;
+            }
+
+            sectors = memory;
+            capacity *= 2;
+        }
+
+        /* once and for all to fixed point ------------------------------- */
+        sectors[count].latitude = FIXED_FROM_DEGREES(latitude);
+        sectors[count].longitude = FIXED_FROM_DEGREES(longitude);
+        sectors[count].speed_min = FIXED_FROM_KMH(speed_min);
+        sectors[count].speed_max = FIXED_FROM_KMH(speed_max);
+        ++count;
+    }
+
+    /* sized to the track, index next array right after sectors ------------- */
+    if (count > 0) {
+        memory = realloc(sectors, count * (sizeof *sectors + sizeof (int)));
+
+        if (memory == NULL) {
+            goto err_grow;
+        }
+
+        sectors = memory;
+    }
+
+    fclose(fp);
+
+    file->memory = sectors;
+    file->sectors = sectors;
+    file->count = count;
+    file->index.next = (int *) (sectors + count);
+
+    sector_index_build(
+        &file->index, file->sectors, file->count,
+        FIXED_FROM_DEGREES(epsilon_latitude),
+        FIXED_FROM_DEGREES(epsilon_longitude)
+    );
+
+    return 0;
+
+err_grow:
+    free(sectors);
+err_sectors:
+    fclose(fp);
+err_fp:
+    return -1;
+}
+
+int sector_file_save(const sector_file_t * file, const char * pathname) {
+    header_t header;
+    FILE * fp;
+    int indexed =
+        file->index.epsilon_latitude > 0 && file->index.epsilon_longitude > 0;
+
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, FILE_MAGIC, sizeof header.magic);
+    header.version = SECTOR_FILE_VERSION;
+    header.count = file->count;
+
+    header.checksum = crc32(
+        0, file->sectors, file->count * sizeof *file->sectors
+    );
+
+    if (indexed) {
+        header.flags = FILE_INDEXED;
+        header.epsilon_latitude = file->index.epsilon_latitude;
+        header.epsilon_longitude = file->index.epsilon_longitude;
+        header.index_size = SECTOR_INDEX_SIZE;
+        header.checksum = crc32(
+            header.checksum, file->index.head, sizeof file->index.head
+        );
+        header.checksum = crc32(
+            header.checksum, file->index.next, file->count * sizeof (int)
+        );
+    }
+
+    if ((fp = fopen(pathname, "wb")) == NULL) {
+        goto err_fp;
+    }
+
+    if (
+        write_all(fp, &header, sizeof header) == -1 ||
+        write_all(
+            fp, file->sectors, file->count * sizeof *file->sectors
+        ) == -1
+    ) {
+        goto err_write;
+    }
+
+    if (
+        indexed && (
+            write_all(fp, file->index.head, sizeof file->index.head) == -1 ||
+            write_all(fp, file->index.next, file->count * sizeof (int)) == -1
+        )
+    ) {
+        goto err_write;
+    }
+
+    if (fclose(fp) == EOF) {
+        goto err_fp;
+    }
+
+    return 0;
+
+err_write:
+    fclose(fp);
+err_fp:
+    return -1;
+}
+
+void sector_file_free(sector_file_t * file) {
+    free(file->memory);
+    memset(file, 0, sizeof *file);
+}
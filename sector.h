@@ -0,0 +1,179 @@
+#ifndef SECTOR_H
+#define SECTOR_H
+
+#include "fixed.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SECTOR_INDEX_SIZE 4096
+#define SECTOR_FILE_VERSION 2
+
+#define SECTOR_UNDER -1
+#define SECTOR_IN 0
+#define SECTOR_OVER 1
+
+typedef struct sector_t sector_t;
+typedef struct sector_index_t sector_index_t;
+typedef struct sector_file_t sector_file_t;
+
+/*
+ * a sector is a box of 2 * epsilon by 2 * epsilon degrees around its center,
+ * with a target speed band; all fixed point (see fixed.h), so matching a fix
+ * takes no double operation: center in micro-degrees, speeds in mm/s
+ */
+
+struct sector_t {
+    int32_t latitude;
+    int32_t longitude;
+    int32_t speed_min;
+    int32_t speed_max;
+};
+
+/*
+ * uniform latitude/longitude grid over sector centers, with cells of
+ * 2 * epsilon_latitude by 2 * epsilon_longitude degrees hashed into
+ * SECTOR_INDEX_SIZE buckets; a fix can only collide with sectors whose center
+ * lies in its own cell or in one of the 8 neighbouring cells
+ */
+
+struct sector_index_t {
+    long epsilon_latitude;      /* micro-degrees */
+    long epsilon_longitude;
+    int head[SECTOR_INDEX_SIZE];
+    int * next;                 /* one per sector, storage given by caller */
+};
+
+/*
+ * sectors of a track, as loaded from a file, and their index: everything
+ * lives in a single block sized to the track
+ *
+ * binary files are laid out as that block, so they are loaded with a single
+ * read and no parsing: a header (magic, version, count, index epsilons, CRC-32
+ * of what follows), then sectors, then, if the file was compiled with the
+ * epsilons the index is wanted for, the index head and next arrays; ints are
+ * stored as the target sees them (little endian, 32 bits int)
+ */
+
+struct sector_file_t {
+    sector_t * sectors;
+    size_t count;
+    sector_index_t index;
+    void * memory;
+};
+
+/*
+ * sector_index_build()
+ *
+ * build index over the count first sectors, index->next must point to count
+ * ints, epsilons are in micro-degrees, a non positive one gives an empty index
+ * (nothing can ever be matched)
+ */
+
+void sector_index_build(
+    sector_index_t * index, const sector_t * sectors, size_t count,
+    long epsilon_latitude, long epsilon_longitude
+);
+
+/*
+ * sector_match()
+ *
+ * find the sector whose box contains (latitude, longitude), in micro-degrees,
+ * using index; when several boxes overlap, pick the first one met when
+ * walking sectors from *current, wrapping around, and write its position to
+ * *current
+ *
+ * returns -1 if:
+ *  - no sector box contains (latitude, longitude), *current is left unchanged
+ */
+
+int sector_match(
+    const sector_index_t * index, const sector_t * sectors, size_t count,
+    long latitude, long longitude, size_t * current
+);
+
+/*
+ * sector_scan()
+ *
+ * same as sector_match(), by testing every sector box in turn
+ *
+ * returns -1 if:
+ *  - no sector box contains (latitude, longitude), *current is left unchanged
+ */
+
+int sector_scan(
+    const sector_index_t * index, const sector_t * sectors, size_t count,
+    long latitude, long longitude, size_t * current
+);
+
+/*
+ * sector_band()
+ *
+ * tell how speed (in mm/s) compares to sector target band, bounds excluded
+ *
+ * returns:
+ *  - SECTOR_IN if speed is strictly in between speed_min and speed_max
+ *  - SECTOR_UNDER if speed is below speed_min
+ *  - SECTOR_OVER otherwise
+ */
+
+int sector_band(const sector_t * sector, long speed);
+
+/*
+ * sector_file_load()
+ *
+ * load binary sector file pathname into file, use its precomputed index if
+ * it was built for epsilon_latitude and epsilon_longitude (in degrees, as in
+ * the config file), and only points to sectors in file through chains
+ * going to lower sectors, as sector_index_build() makes them, build it
+ * otherwise
+ *
+ * returns -1 if:
+ *  - pathname could not be opened or read
+ *  - pathname is not a sector file of SECTOR_FILE_VERSION
+ *  - pathname is truncated or its checksum does not match
+ *  - there is not enough memory
+ */
+
+int sector_file_load(
+    sector_file_t * file, const char * pathname, double epsilon_latitude,
+    double epsilon_longitude
+);
+
+/*
+ * sector_file_load_text()
+ *
+ * same as sector_file_load(), from a text file of "lat,lon,min,max" lines,
+ * in degrees and km/h, loading stops at the first line that is not one
+ *
+ * returns -1 if:
+ *  - pathname could not be opened
+ *  - there is not enough memory
+ */
+
+int sector_file_load_text(
+    sector_file_t * file, const char * pathname, double epsilon_latitude,
+    double epsilon_longitude
+);
+
+/*
+ * sector_file_save()
+ *
+ * save file to binary sector file pathname, with its index if it was built
+ * with positive epsilons
+ *
+ * returns -1 if:
+ *  - pathname could not be written
+ */
+
+int sector_file_save(const sector_file_t * file, const char * pathname);
+
+/*
+ * sector_file_free()
+ *
+ * release what file holds, file is then empty
+ */
+
+void sector_file_free(sector_file_t * file);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+/*
+ * latched sequence lock, publishing a value from one writer to any number of
+ * readers without ever blocking: the protected value is kept twice, as
+ * buffer[2], the writer always fills the buffer readers are not told to use,
+ * then flips the sequence, so a reader preempting a writer still copies a
+ * consistent value, and only retries when a whole publication happened
+ * during its copy
+ *
+ * writer:
+ *
+ *   buffer[seqlock_write_begin(&lock)] = value;
+ *   seqlock_write_end(&lock);
+ *
+ * reader:
+ *
+ *   do {
+ *       sequence = seqlock_read_begin(&lock);
+ *       value = buffer[sequence & 1];
+ *   } while (seqlock_read_retry(&lock, sequence));
+ */
+
+typedef struct seqlock_t seqlock_t;
+
+struct seqlock_t {
+    volatile unsigned long sequence;
+};
+
+static inline void seqlock_init(seqlock_t * lock) {
+    lock->sequence = 0;
+    __sync_synchronize();
+}
+
+static inline unsigned long seqlock_write_begin(seqlock_t * lock) {
+    return (lock->sequence + 1) & 1;
+}
+
+static inline void seqlock_write_end(seqlock_t * lock) {
+    __sync_synchronize();
+    lock->sequence = lock->sequence + 1;
+}
+
+static inline unsigned long seqlock_read_begin(const seqlock_t * lock) {
+    unsigned long sequence = lock->sequence;
+
+    __sync_synchronize();
+
+    return sequence;
+}
+
+static inline int seqlock_read_retry(
+    const seqlock_t * lock, unsigned long sequence
+) {
+    __sync_synchronize();
+
+    return lock->sequence != sequence;
+}
+
+#endif
@@ -0,0 +1,391 @@
+#include "session.h"
+#include "crc32.h"
+
+#include <string.h>
+
+/* constants ================================================================ */
+#define FILE_MAGIC "ESES"
+#define FILE_HEADER_SIZE 8
+
+#define BLOCK_SYNC_0 0xe5
+#define BLOCK_SYNC_1 0x5e
+#define BLOCK_HEADER_SIZE 8
+#define BLOCK_CRC_SIZE 4
+
+#define RECORD_MAX 64           /* worst case gps record, 10 bytes varints */
+
+#define DEGREES_SCALE 10        /* 1e-7 degrees per micro-degree */
+#define HDOP_SCALE 1e2
+
+/* private functions ======================================================== */
+static void put_u16(unsigned char * p, unsigned int x) {
+    p[0] = x;
+    p[1] = x >> 8;
+}
+
+static void put_u32(unsigned char * p, uint32_t x) {
+    p[0] = x;
+    p[1] = x >> 8;
+    p[2] = x >> 16;
+    p[3] = x >> 24;
+}
+
+static unsigned int get_u16(const unsigned char * p) {
+    return p[0] | p[1] << 8;
+}
+
+static uint32_t get_u32(const unsigned char * p) {
+    return
+        (uint32_t) p[0] | (uint32_t) p[1] << 8 |
+        (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24;
+}
+
+static size_t put_varint(unsigned char * p, unsigned long long x) {
+    size_t n = 0;
+
+    while (x >= 0x80) {
+        p[n++] = x | 0x80;
+        x >>= 7;
+    }
+
+    p[n++] = x;
+
+    return n;
+}
+
+static size_t put_zigzag(unsigned char * p, long long x) {
+    return put_varint(
+        p, (unsigned long long) x << 1 ^ (unsigned long long) (x >> 63)
+    );
+}
+
+static int get_varint(
+    session_reader_t * reader, unsigned long long * dest
+) {
+    unsigned long long x = 0;
+    unsigned int shift;
+
+    for (shift = 0; shift < 64; shift += 7) {
+        unsigned char c;
+
+        if (reader->offset == reader->size) {
+            return -1;
+        }
+
+        c = reader->block[reader->offset++];
+        x |= (unsigned long long) (c & 0x7f) << shift;
+
+        if (!(c & 0x80)) {
+            *dest = x;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static int get_zigzag(session_reader_t * reader, long long * dest) {
+    unsigned long long x;
+
+    if (get_varint(reader, &x) == -1) {
+        return -1;
+    }
+
+    *dest = (long long) (x >> 1) ^ -(long long) (x & 1);
+
+    return 0;
+}
+
+static long long fixed(double x, double scale) {
+    /* round to nearest, without dragging libm in --------------------------- */
+    return (long long) (x * scale + (x < 0 ? -0.5 : 0.5));
+}
+
+static long scale_down(long long x, long scale) {
+    /* round to nearest, files may hold finer values than we keep ---------- */
+    return (x + (x < 0 ? -scale / 2 : scale / 2)) / scale;
+}
+
+static void block_reset(session_writer_t * writer) {
+    writer->size = 0;
+    writer->count = 0;
+    writer->delta = 0;
+    memset(&writer->previous, 0, sizeof writer->previous);
+}
+
+static int decode(session_reader_t * reader, session_record_t * dest) {
+    session_record_t * previous = &reader->previous;
+    unsigned long long u;
+    long long s;
+
+    if (get_zigzag(reader, &s) == -1) {
+        return -1;
+    }
+
+    reader->delta += s;
+    previous->time += reader->delta;
+
+    if (reader->type == SESSION_GPS) {
+        nmea_fix_t * fix = &previous->fix;
+
+        if (get_zigzag(reader, &s) == -1) {
+            return -1;
+        }
+
+        fix->time += s;
+
+        if (get_zigzag(reader, &s) == -1) {
+            return -1;
+        }
+
+        reader->latitude += s;
+        fix->latitude = scale_down(reader->latitude, DEGREES_SCALE);
+
+        if (get_zigzag(reader, &s) == -1) {
+            return -1;
+        }
+
+        reader->longitude += s;
+        fix->longitude = scale_down(reader->longitude, DEGREES_SCALE);
+
+        if (reader->offset + 2 > reader->size) {
+            return -1;
+        }
+
+        fix->quality = reader->block[reader->offset++];
+        fix->satellites = reader->block[reader->offset++];
+
+        if (get_varint(reader, &u) == -1) {
+            return -1;
+        }
+
+        fix->hdop = u / HDOP_SCALE;
+    }
+    else if (reader->type == SESSION_ENERGY) {
+        if (get_zigzag(reader, &s) == -1) {
+            return -1;
+        }
+
+        previous->voltage += s;
+
+        if (get_zigzag(reader, &s) == -1) {
+            return -1;
+        }
+
+        previous->current += s;
+    }
+
+    *dest = *previous;
+
+    return 0;
+}
+
+static int block_read(session_reader_t * reader) {
+    unsigned char header[BLOCK_HEADER_SIZE];
+    unsigned char crc[BLOCK_CRC_SIZE];
+    int c;
+
+    while ((c = getc(reader->stream)) != EOF) {
+        long resync;
+
+        if (c != BLOCK_SYNC_0) {
+            ++reader->skipped;
+            continue;
+        }
+
+        /* if anything is wrong, start over right after this sync byte ----- */
+        resync = ftell(reader->stream);
+        header[0] = c;
+
+        if (
+            fread(header + 1, BLOCK_HEADER_SIZE - 1, 1, reader->stream) != 1
+        ) {
+            ++reader->skipped;
+            break;
+        }
+
+        reader->size = get_u16(header + 2);
+        reader->count = get_u16(header + 4);
+
+        if (
+            header[1] == BLOCK_SYNC_1 && reader->size <= SESSION_BLOCK_MAX &&
+            fread(reader->block, reader->size, 1, reader->stream) == 1 &&
+            fread(crc, sizeof crc, 1, reader->stream) == 1 &&
+            crc32(
+                crc32(0, header, sizeof header), reader->block, reader->size
+            ) == get_u32(crc)
+        ) {
+            reader->offset = 0;
+            reader->delta = 0;
+            memset(&reader->previous, 0, sizeof reader->previous);
+            reader->latitude = 0;
+            reader->longitude = 0;
+            ++reader->blocks;
+
+            return 0;
+        }
+
+        ++reader->skipped;
+        clearerr(reader->stream);
+
+        if (resync == -1 || fseek(reader->stream, resync, SEEK_SET) == -1) {
+            break;
+        }
+    }
+
+    return -1;
+}
+
+/* public functions ========================================================= */
+int session_writer_open(session_writer_t * writer, FILE * stream, int type) {
+    unsigned char header[FILE_HEADER_SIZE] = { 0 };
+
+    writer->stream = stream;
+    writer->type = type;
+    writer->blocks = 0;
+    block_reset(writer);
+
+    memcpy(header, FILE_MAGIC, 4);
+    header[4] = SESSION_VERSION;
+    header[5] = type;
+
+    if (fwrite(header, sizeof header, 1, stream) != 1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int session_write(session_writer_t * writer, const session_record_t * record) {
+    session_record_t * previous = &writer->previous;
+    unsigned char * p;
+    long long delta;
+
+    if (
+        writer->size + RECORD_MAX > SESSION_BLOCK_MAX &&
+        session_writer_flush(writer) == -1
+    ) {
+        return -1;
+    }
+
+    if (writer->count == 0) {
+        writer->first = record->time;
+    }
+
+    p = writer->block + writer->size;
+
+    /* timestamp, as the change of its delta -------------------------------- */
+    delta = record->time - previous->time;
+    p += put_zigzag(p, delta - writer->delta);
+    writer->delta = delta;
+
+    if (writer->type == SESSION_GPS) {
+        const nmea_fix_t * fix = &record->fix;
+
+        p += put_zigzag(
+            p, (long long) fix->time - (long long) previous->fix.time
+        );
+        p += put_zigzag(
+            p,
+            (long long) (fix->latitude - previous->fix.latitude) *
+            DEGREES_SCALE
+        );
+        p += put_zigzag(
+            p,
+            (long long) (fix->longitude - previous->fix.longitude) *
+            DEGREES_SCALE
+        );
+        *p++ = fix->quality < 0xff ? fix->quality : 0xff;
+        *p++ = fix->satellites < 0xff ? fix->satellites : 0xff;
+        p += put_varint(p, fix->hdop > 0 ? fixed(fix->hdop, HDOP_SCALE) : 0);
+    }
+    else if (writer->type == SESSION_ENERGY) {
+        p += put_zigzag(p, record->voltage - previous->voltage);
+        p += put_zigzag(p, record->current - previous->current);
+    }
+
+    writer->size = p - writer->block;
+    ++writer->count;
+    *previous = *record;
+
+    /* do not keep more than SESSION_BLOCK_PERIOD at risk ------------------- */
+    if (record->time - writer->first >= SESSION_BLOCK_PERIOD) {
+        return session_writer_flush(writer);
+    }
+
+    return 0;
+}
+
+int session_writer_flush(session_writer_t * writer) {
+    unsigned char header[BLOCK_HEADER_SIZE] = { 0 };
+    unsigned char crc[BLOCK_CRC_SIZE];
+
+    if (writer->count == 0) {
+        return 0;
+    }
+
+    header[0] = BLOCK_SYNC_0;
+    header[1] = BLOCK_SYNC_1;
+    put_u16(header + 2, writer->size);
+    put_u16(header + 4, writer->count);
+    put_u32(
+        crc,
+        crc32(crc32(0, header, sizeof header), writer->block, writer->size)
+    );
+
+    if (
+        fwrite(header, sizeof header, 1, writer->stream) != 1 ||
+        fwrite(writer->block, writer->size, 1, writer->stream) != 1 ||
+        fwrite(crc, sizeof crc, 1, writer->stream) != 1
+    ) {
+        block_reset(writer);
+        return -1;
+    }
+
+    block_reset(writer);
+    ++writer->blocks;
+
+    return 0;
+}
+
+int session_reader_open(session_reader_t * reader, FILE * stream) {
+    unsigned char header[FILE_HEADER_SIZE];
+
+    memset(reader, 0, sizeof *reader);
+    reader->stream = stream;
+
+    if (
+        fread(header, sizeof header, 1, stream) != 1 ||
+        memcmp(header, FILE_MAGIC, 4) != 0 ||
+        header[4] != SESSION_VERSION ||
+        (
+            header[5] != SESSION_SPEED && header[5] != SESSION_GPS &&
+            header[5] != SESSION_ENERGY
+        )
+    ) {
+        return -1;
+    }
+
+    reader->type = header[5];
+
+    return 0;
+}
+
+int session_read(session_reader_t * reader, session_record_t * dest) {
+    /* next block once this one is done, corrupt records spoil the rest ----- */
+    while (reader->count == 0 || decode(reader, dest) == -1) {
+        if (reader->count != 0) {
+            ++reader->skipped;
+        }
+
+        reader->count = 0;
+
+        if (block_read(reader) == -1) {
+            return -1;
+        }
+    }
+
+    --reader->count;
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "nmea.h"
+
+#include <stdio.h>
+
+#define SESSION_VERSION 1
+#define SESSION_SPEED 1
+#define SESSION_GPS 2
+#define SESSION_ENERGY 3
+
+#define SESSION_BLOCK_MAX 4096
+#define SESSION_BLOCK_PERIOD (10ULL * 1000 * 1000 * 1000)
+
+typedef struct session_record_t session_record_t;
+typedef struct session_writer_t session_writer_t;
+typedef struct session_reader_t session_reader_t;
+
+/*
+ * compact binary session file, one per sensor, as an alternative to the text
+ * files: an 8 bytes header ("ESES", version, type), then blocks of records
+ *
+ * a block is a sync word, payload size and record count, the payload, then a
+ * CRC-32 of all that; records are delta encoded from the previous one in the
+ * same block only, as LEB128 varints (zigzag for signed fields), so any block
+ * can be decoded on its own and a truncated or corrupt file loses no more
+ * than the blocks it hits:
+ *
+ *  - speed: rotation timestamp (ns)
+ *  - gps: reception timestamp (ns), then the decoded fix, UTC time (ms),
+ *    latitude and longitude (1e-7 degrees), quality, satellites, and HDOP
+ *    (1e-2)
+ *  - energy: sample timestamp (ns), then voltage (mV) and current (mA)
+ *
+ * timestamps are encoded as the change of their delta, as rotations and
+ * sentences come at a steady pace, the other fields as their plain delta
+ *
+ * a block is written once full, or once it spans SESSION_BLOCK_PERIOD, so a
+ * power cut never loses more than that; every multi-byte field is little
+ * endian
+ */
+
+struct session_record_t {
+    unsigned long long time;
+    nmea_fix_t fix;             /* gps only */
+    long voltage;               /* energy only (in mV) */
+    long current;               /* energy only (in mA) */
+};
+
+struct session_writer_t {
+    FILE * stream;
+    int type;
+    unsigned char block[SESSION_BLOCK_MAX];
+    size_t size;                /* payload bytes in block */
+    unsigned int count;         /* records in block */
+    unsigned long long first;   /* first record timestamp in block */
+    session_record_t previous;  /* delta base, zero at block start */
+    long long delta;            /* previous timestamp delta */
+    unsigned long blocks;       /* written so far */
+};
+
+struct session_reader_t {
+    FILE * stream;
+    int type;
+    unsigned char block[SESSION_BLOCK_MAX];
+    size_t size;
+    size_t offset;              /* next record in block */
+    unsigned int count;         /* records left in block */
+    session_record_t previous;
+    long long delta;
+    long long latitude;         /* previous position, as in file */
+    long long longitude;
+    unsigned long blocks;       /* read so far */
+    unsigned long skipped;      /* bad blocks, and stray bytes in between */
+};
+
+/*
+ * session_writer_open()
+ *
+ * setup writer to write type records to stream, starting with the header
+ *
+ * returns -1 if:
+ *  - header could not be written
+ */
+
+int session_writer_open(session_writer_t * writer, FILE * stream, int type);
+
+/*
+ * session_write()
+ *
+ * append record to writer, writing the current block to stream first if
+ * record does not fit, or after, if the block is now old enough
+ *
+ * returns -1 if:
+ *  - a block could not be written
+ */
+
+int session_write(session_writer_t * writer, const session_record_t * record);
+
+/*
+ * session_writer_flush()
+ *
+ * write the current block to stream, even if it is not full
+ *
+ * returns -1 if:
+ *  - block could not be written
+ */
+
+int session_writer_flush(session_writer_t * writer);
+
+/*
+ * session_reader_open()
+ *
+ * setup reader to read records from stream, reader->type tells which ones
+ *
+ * returns -1 if:
+ *  - stream does not start with a session header of SESSION_VERSION
+ */
+
+int session_reader_open(session_reader_t * reader, FILE * stream);
+
+/*
+ * session_read()
+ *
+ * decode the next record to dest, corrupt blocks are skipped (and counted)
+ *
+ * returns -1 if:
+ *  - there is no more valid block in stream
+ */
+
+int session_read(session_reader_t * reader, session_record_t * dest);
+
+#endif
@@ -0,0 +1,421 @@
+#include "sim.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/mount.h>
+#include <xenomai/native/event.h>
+#include <xenomai/native/intr.h>
+#include <xenomai/native/mutex.h>
+#include <xenomai/native/queue.h>
+#include <xenomai/native/task.h>
+#include <xenomai/native/timer.h>
+
+/* types ==================================================================== */
+typedef struct rt_queue_message_t rt_queue_message_t;
+
+/* structures =============================================================== */
+struct rt_queue_message_t {
+    rt_queue_message_t * next;
+    size_t size;
+    unsigned char data[];
+};
+
+/* private variables ======================================================== */
+static __thread RT_TASK * self;
+
+/* private functions ======================================================== */
+static void * task_routine(void * cookie) {
+    RT_TASK * task = cookie;
+
+    self = task;
+    task->entry(task->cookie);
+
+    return NULL;
+}
+
+static void unlock(void * cookie) {
+    pthread_mutex_unlock(cookie);
+}
+
+/* task ===================================================================== */
+int rt_task_spawn(
+    RT_TASK * task, const char * name, int stksize, int prio, int mode,
+    void (* entry)(void * cookie), void * cookie
+) {
+    sim_init();
+
+    task->entry = entry;
+    task->cookie = cookie;
+    task->period = 0;
+
+    (void) name;
+    (void) stksize;
+    (void) prio;
+    (void) mode;
+
+    return -pthread_create(&task->thread, NULL, task_routine, task);
+}
+
+int rt_task_delete(RT_TASK * task) {
+    /* tasks loop forever, they are cancelled on their next blocking call -- */
+    pthread_cancel(task->thread);
+
+    return -pthread_join(task->thread, NULL);
+}
+
+int rt_task_shadow(RT_TASK * task, const char * name, int prio, int mode) {
+    sim_init();
+
+    (void) task;
+    (void) name;
+    (void) prio;
+    (void) mode;
+
+    return 0;
+}
+
+int rt_task_sleep(RTIME delay) {
+    sim_clock_sleep(delay);
+
+    return 0;
+}
+
+int rt_task_set_periodic(RT_TASK * task, RTIME idate, RTIME period) {
+    if (task == NULL && (task = self) == NULL) {
+        return -EPERM;
+    }
+
+    task->period = period;
+    task->release = idate == TM_NOW ? sim_clock_read() : idate;
+
+    return 0;
+}
+
+int rt_task_wait_period(unsigned long * overruns) {
+    RT_TASK * task = self;
+    unsigned long missed;
+    RTIME now;
+
+    if (task == NULL || task->period == 0) {
+        return -EWOULDBLOCK;
+    }
+
+    task->release += task->period;
+
+    /* as fast as possible, the clock only moves with events, keep yielding
+     * until one gets it there ------------------------------------------- */
+    while ((now = sim_clock_read()) < task->release) {
+        sim_clock_sleep(task->release - now);
+        pthread_testcancel();
+    }
+
+    /* release points the clock went past are overruns, as on a late task - */
+    missed = (now - task->release) / task->period;
+    task->release += missed * task->period;
+
+    if (overruns != NULL) {
+        *overruns = missed;
+    }
+
+    return missed > 0 ? -ETIMEDOUT : 0;
+}
+
+/* mutex ==================================================================== */
+int rt_mutex_create(RT_MUTEX * mutex, const char * name) {
+    (void) name;
+
+    return -pthread_mutex_init(&mutex->mutex, NULL);
+}
+
+int rt_mutex_delete(RT_MUTEX * mutex) {
+    return -pthread_mutex_destroy(&mutex->mutex);
+}
+
+int rt_mutex_acquire(RT_MUTEX * mutex, RTIME timeout) {
+    if (timeout == TM_NONBLOCK) {
+        return pthread_mutex_trylock(&mutex->mutex) ? -EWOULDBLOCK : 0;
+    }
+
+    return -pthread_mutex_lock(&mutex->mutex);
+}
+
+int rt_mutex_release(RT_MUTEX * mutex) {
+    return -pthread_mutex_unlock(&mutex->mutex);
+}
+
+/* queue ==================================================================== */
+int rt_queue_create(
+    RT_QUEUE * queue, const char * name, size_t poolsize, size_t qlimit,
+    int mode
+) {
+    (void) name;
+    (void) poolsize;
+    (void) qlimit;
+    (void) mode;
+
+    queue->head = NULL;
+    queue->tail = NULL;
+
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+
+    return 0;
+}
+
+int rt_queue_delete(RT_QUEUE * queue) {
+    while (queue->head != NULL) {
+        rt_queue_message_t * message = queue->head;
+
+        queue->head = message->next;
+        free(message);
+    }
+
+    pthread_cond_destroy(&queue->cond);
+    pthread_mutex_destroy(&queue->lock);
+
+    return 0;
+}
+
+ssize_t rt_queue_write(
+    RT_QUEUE * queue, const void * buf, size_t size, int mode
+) {
+    rt_queue_message_t * message = malloc(sizeof *message + size);
+
+    if (message == NULL) {
+        return -ENOMEM;
+    }
+
+    message->next = NULL;
+    message->size = size;
+    memcpy(message->data, buf, size);
+
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->tail == NULL) {
+        queue->head = message;
+    }
+    else {
+        queue->tail->next = message;
+    }
+
+    queue->tail = message;
+
+    pthread_cond_signal(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+
+    (void) mode;
+
+    return 1;
+}
+
+ssize_t rt_queue_read(
+    RT_QUEUE * queue, void * buf, size_t size, RTIME timeout
+) {
+    rt_queue_message_t * message;
+
+    pthread_mutex_lock(&queue->lock);
+    pthread_cleanup_push(unlock, &queue->lock);
+
+    while (queue->head == NULL && timeout != TM_NONBLOCK) {
+        pthread_cond_wait(&queue->cond, &queue->lock);
+    }
+
+    if ((message = queue->head) != NULL) {
+        if ((queue->head = message->next) == NULL) {
+            queue->tail = NULL;
+        }
+    }
+
+    pthread_cleanup_pop(1);
+
+    if (message == NULL) {
+        return -EWOULDBLOCK;
+    }
+
+    if (size > message->size) {
+        size = message->size;
+    }
+
+    memcpy(buf, message->data, size);
+    free(message);
+
+    return size;
+}
+
+/* intr ===================================================================== */
+int rt_intr_create(RT_INTR * intr, const char * name, unsigned irq, int mode) {
+    (void) name;
+    (void) mode;
+
+    intr->irq = irq;
+    intr->pending = 0;
+    intr->lost = 0;
+    intr->enabled = 0;
+    intr->waiting = 0;
+
+    pthread_mutex_init(&intr->lock, NULL);
+    pthread_cond_init(&intr->cond, NULL);
+
+    sim_intr_attach(intr);
+
+    return 0;
+}
+
+int rt_intr_delete(RT_INTR * intr) {
+    sim_intr_detach(intr);
+
+    pthread_cond_destroy(&intr->cond);
+    pthread_mutex_destroy(&intr->lock);
+
+    return 0;
+}
+
+int rt_intr_wait(RT_INTR * intr, RTIME timeout) {
+    int pending;
+
+    pthread_mutex_lock(&intr->lock);
+    pthread_cleanup_push(unlock, &intr->lock);
+
+    /* let the replay know we are done with the previous IRQ ---------------- */
+    intr->waiting = 1;
+    pthread_cond_broadcast(&intr->cond);
+
+    while (intr->pending == 0 && timeout != TM_NONBLOCK) {
+        pthread_cond_wait(&intr->cond, &intr->lock);
+    }
+
+    pending = intr->pending;
+    intr->pending = 0;
+    intr->waiting = 0;
+
+    pthread_cleanup_pop(1);
+
+    return pending ? pending : -EWOULDBLOCK;
+}
+
+int rt_intr_enable(RT_INTR * intr) {
+    pthread_mutex_lock(&intr->lock);
+    intr->enabled = 1;
+    pthread_mutex_unlock(&intr->lock);
+
+    return 0;
+}
+
+int rt_intr_disable(RT_INTR * intr) {
+    pthread_mutex_lock(&intr->lock);
+    intr->enabled = 0;
+    pthread_cond_broadcast(&intr->cond);
+    pthread_mutex_unlock(&intr->lock);
+
+    return 0;
+}
+
+/* event ==================================================================== */
+int rt_event_create(
+    RT_EVENT * event, const char * name, unsigned long ivalue, int mode
+) {
+    (void) name;
+    (void) mode;
+
+    event->value = ivalue;
+
+    pthread_mutex_init(&event->lock, NULL);
+    pthread_cond_init(&event->cond, NULL);
+
+    return 0;
+}
+
+int rt_event_delete(RT_EVENT * event) {
+    pthread_cond_destroy(&event->cond);
+    pthread_mutex_destroy(&event->lock);
+
+    return 0;
+}
+
+int rt_event_signal(RT_EVENT * event, unsigned long mask) {
+    pthread_mutex_lock(&event->lock);
+    event->value |= mask;
+    pthread_cond_broadcast(&event->cond);
+    pthread_mutex_unlock(&event->lock);
+
+    return 0;
+}
+
+int rt_event_wait(
+    RT_EVENT * event, unsigned long mask, unsigned long * mask_r, int mode,
+    RTIME timeout
+) {
+    unsigned long value;
+
+    pthread_mutex_lock(&event->lock);
+    pthread_cleanup_push(unlock, &event->lock);
+
+    while (
+        timeout != TM_NONBLOCK &&
+        (mode & EV_ANY ? !(event->value & mask) : (event->value & mask) != mask)
+    ) {
+        pthread_cond_wait(&event->cond, &event->lock);
+    }
+
+    value = event->value;
+
+    pthread_cleanup_pop(1);
+
+    if (mask_r != NULL) {
+        *mask_r = value;
+    }
+
+    if (mode & EV_ANY ? !(value & mask) : (value & mask) != mask) {
+        return -EWOULDBLOCK;
+    }
+
+    return 0;
+}
+
+int rt_event_clear(
+    RT_EVENT * event, unsigned long mask, unsigned long * mask_r
+) {
+    pthread_mutex_lock(&event->lock);
+
+    if (mask_r != NULL) {
+        *mask_r = event->value;
+    }
+
+    event->value &= ~mask;
+    pthread_mutex_unlock(&event->lock);
+
+    return 0;
+}
+
+/* timer ==================================================================== */
+RTIME rt_timer_read(void) {
+    return sim_clock_read();
+}
+
+/* mount ==================================================================== */
+int sim_mount(
+    const char * source, const char * target, const char * type,
+    unsigned long flags, const void * data
+) {
+    struct stat st;
+
+    (void) source;
+    (void) type;
+    (void) flags;
+    (void) data;
+
+    /* the "USB key" is always plugged in, as long as ECOROOT exists -------- */
+    if (stat(target, &st) == -1 || !S_ISDIR(st.st_mode)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int sim_umount(const char * target) {
+    (void) target;
+
+    return 0;
+}
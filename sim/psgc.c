@@ -0,0 +1,230 @@
+#include "sim.h"
+
+#include <psgc.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* constants ================================================================ */
+#define BAUD 115200
+#define BUTTON_MAX 4
+#define TEXT_MAX 64
+#define POLL_PERIOD (10ULL * 1000 * 1000)
+
+/* types ==================================================================== */
+typedef struct button_t button_t;
+
+/* structures =============================================================== */
+struct button_t {
+    char text[TEXT_MAX];
+    u_int16_t x;
+    u_int16_t y;
+};
+
+struct psgc_t {
+    FILE * fp;
+    button_t buttons[BUTTON_MAX];
+    size_t count;
+    int started;
+    unsigned long commands;
+    unsigned long bytes;
+};
+
+/* private functions ======================================================== */
+static void command(psgc_t * psgc, unsigned long size) {
+    /* first command after GO: start() is over, sensors are all set up ----- */
+    if (psgc->started == 1) {
+        psgc->started = 2;
+        sim_start();
+    }
+
+    /* hold the caller as long as the serial link would -------------------- */
+    sim_clock_sleep(size * 10 * 1000000000ULL / BAUD);
+
+    ++psgc->commands;
+    psgc->bytes += size;
+}
+
+static void record(psgc_t * psgc, const char * format, ...) {
+    va_list ap;
+
+    fprintf(psgc->fp, "%llu ", sim_clock_read());
+
+    va_start(ap, format);
+    vfprintf(psgc->fp, format, ap);
+    va_end(ap);
+
+    fputc('\n', psgc->fp);
+}
+
+static const button_t * find(const psgc_t * psgc, const char * text) {
+    size_t i;
+
+    for (i = 0; i < psgc->count; i++) {
+        if (strcmp(psgc->buttons[i].text, text) == 0) {
+            return &psgc->buttons[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* public functions ========================================================= */
+int psgc_init(psgc_t ** psgc, const char * pathname) {
+    const char * display = getenv("ECOSIM_DISPLAY");
+
+    sim_init();
+
+    if ((*psgc = calloc(1, sizeof **psgc)) == NULL) {
+        return -1;
+    }
+
+    if (((*psgc)->fp = fopen(display ? display : "display", "w")) == NULL) {
+        free(*psgc);
+        return -1;
+    }
+
+    record(*psgc, "init %s", pathname);
+
+    return 0;
+}
+
+int psgc_exit(psgc_t * psgc) {
+    fprintf(
+        stderr, "ecollect-sim: display sent %lu commands, %lu bytes\n",
+        psgc->commands, psgc->bytes
+    );
+
+    fclose(psgc->fp);
+    free(psgc);
+
+    return 0;
+}
+
+int psgc_clear(psgc_t * psgc) {
+    psgc->count = 0;
+
+    command(psgc, 2);
+    record(psgc, "clear");
+
+    return 0;
+}
+
+int psgc_set_background(psgc_t * psgc, u_int16_t color) {
+    command(psgc, 4);
+    record(psgc, "background 0x%04x", color);
+
+    return 0;
+}
+
+int psgc_set_orientation(psgc_t * psgc, int orientation) {
+    command(psgc, 4);
+    record(psgc, "orientation %d", orientation);
+
+    return 0;
+}
+
+int psgc_set_touchscreen(psgc_t * psgc, int touchscreen) {
+    command(psgc, 4);
+    record(psgc, "touchscreen %d", touchscreen);
+
+    return 0;
+}
+
+int psgc_set_opaque(psgc_t * psgc, int opaque) {
+    command(psgc, 4);
+    record(psgc, "opaque %d", opaque);
+
+    return 0;
+}
+
+int psgc_draw_text(
+    psgc_t * psgc, u_int16_t x, u_int16_t y, int font, u_int16_t color,
+    int width, int height, const char * format, ...
+) {
+    char text[TEXT_MAX];
+    va_list ap;
+
+    va_start(ap, format);
+    vsnprintf(text, sizeof text, format, ap);
+    va_end(ap);
+
+    /* 's' command: header, text and terminating NUL, then ACK -------------- */
+    command(psgc, 12 + strlen(text));
+    record(
+        psgc, "text %u %u %d 0x%04x %dx%d \"%s\"",
+        x, y, font, color, width, height, text
+    );
+
+    return 0;
+}
+
+int psgc_draw_button(
+    psgc_t * psgc, int state, u_int16_t x, u_int16_t y,
+    u_int16_t button_color, int font, u_int16_t text_color,
+    int width, int height, const char * format, ...
+) {
+    char text[TEXT_MAX];
+    va_list ap;
+
+    va_start(ap, format);
+    vsnprintf(text, sizeof text, format, ap);
+    va_end(ap);
+
+    if (psgc->count < BUTTON_MAX) {
+        button_t * button = &psgc->buttons[psgc->count++];
+
+        strcpy(button->text, text);
+        button->x = x + strlen(text) * 12 * width / 2;
+        button->y = y + 16 * height / 2;
+    }
+
+    /* 'b' command: header, text and terminating NUL, then ACK -------------- */
+    command(psgc, 15 + strlen(text));
+    record(
+        psgc, "button %d %u %u 0x%04x %d 0x%04x %dx%d \"%s\"",
+        state, x, y, button_color, font, text_color, width, height, text
+    );
+
+    return 0;
+}
+
+int psgc_read_touchscreen(
+    psgc_t * psgc, u_int16_t * event, u_int16_t * x, u_int16_t * y
+) {
+    const button_t * button = NULL;
+
+    /* 'o' command and its 4 bytes answer, the panel is polled -------------- */
+    command(psgc, 6);
+    sim_clock_sleep(POLL_PERIOD);
+
+    *event = PSGC_EVENT_NONE;
+
+    /* LOAD then GO start the replay, STOP once it is over, then quit ------- */
+    if (!sim_done()) {
+        if ((button = find(psgc, "LOAD")) == NULL) {
+            button = find(psgc, " GO ");
+        }
+    }
+    else if ((button = find(psgc, "STOP")) == NULL) {
+        if (find(psgc, "LOAD") != NULL) {
+            raise(SIGTERM);
+        }
+    }
+
+    if (button != NULL) {
+        *event = PSGC_EVENT_PRESS;
+        *x = button->x;
+        *y = button->y;
+
+        record(psgc, "press %u %u \"%s\"", *x, *y, button->text);
+
+        if (strcmp(button->text, " GO ") == 0 && !psgc->started) {
+            psgc->started = 1;
+        }
+    }
+
+    return 0;
+}
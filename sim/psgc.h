@@ -0,0 +1,58 @@
+#ifndef SIM_PSGC_H
+#define SIM_PSGC_H
+
+#include <sys/types.h>
+
+/*
+ * headless stand-in for libpsgc: every command is recorded with its virtual
+ * timestamp and its size on the serial link, and the touchscreen is driven
+ * by the replay (LOAD, GO, then STOP once the recording is over)
+ */
+
+typedef struct psgc_t psgc_t;
+
+#define PSGC_RGB555(r, g, b) \
+    ((u_int16_t) (((r) & 0x1f) << 11 | ((g) & 0x1f) << 6 | ((b) & 0x1f)))
+
+#define PSGC_FONT_5X7 0
+#define PSGC_FONT_8X8 1
+#define PSGC_FONT_8X12 2
+#define PSGC_FONT_12X16 3
+
+#define PSGC_EVENT_NONE 0
+#define PSGC_EVENT_PRESS 1
+#define PSGC_EVENT_RELEASE 2
+#define PSGC_EVENT_MOVING 3
+
+#define PSGC_OPAQUE_OFF 0
+#define PSGC_OPAQUE_ON 1
+
+#define PSGC_ORIENTATION_90 1
+#define PSGC_ORIENTATION_270 2
+#define PSGC_ORIENTATION_0 3
+#define PSGC_ORIENTATION_180 4
+
+#define PSGC_TOUCHSCREEN_ON 0
+#define PSGC_TOUCHSCREEN_OFF 1
+
+int psgc_init(psgc_t ** psgc, const char * pathname);
+int psgc_exit(psgc_t * psgc);
+int psgc_clear(psgc_t * psgc);
+int psgc_set_background(psgc_t * psgc, u_int16_t color);
+int psgc_set_orientation(psgc_t * psgc, int orientation);
+int psgc_set_touchscreen(psgc_t * psgc, int touchscreen);
+int psgc_set_opaque(psgc_t * psgc, int opaque);
+int psgc_draw_text(
+    psgc_t * psgc, u_int16_t x, u_int16_t y, int font, u_int16_t color,
+    int width, int height, const char * format, ...
+);
+int psgc_draw_button(
+    psgc_t * psgc, int state, u_int16_t x, u_int16_t y,
+    u_int16_t button_color, int font, u_int16_t text_color,
+    int width, int height, const char * format, ...
+);
+int psgc_read_touchscreen(
+    psgc_t * psgc, u_int16_t * event, u_int16_t * x, u_int16_t * y
+);
+
+#endif
@@ -0,0 +1,424 @@
+#define _GNU_SOURCE
+
+#include "sim.h"
+#include "logger.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+/* constants ================================================================ */
+#define LEAD (1000ULL * 1000 * 1000)
+#define TAIL (200ULL * 1000 * 1000)
+#define HANDSHAKE_TIMEOUT 1
+#define SYNC_EVENTS 32
+
+#define EVENT_NONE 0
+#define EVENT_SPEED 1
+#define EVENT_GPS 2
+
+/* types ==================================================================== */
+typedef struct source_t source_t;
+
+/* structures =============================================================== */
+struct source_t {
+    FILE * fp;
+    RTIME time;
+    char line[256];
+    int valid;
+};
+
+/* private variables ======================================================== */
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+static pthread_t thread;
+
+static double rate;
+static RTIME clock_base;
+static struct timespec wall_start;
+static volatile RTIME clock_now;
+static volatile int started;
+static volatile int done;
+
+static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static int starting;
+
+static pthread_mutex_t intr_lock = PTHREAD_MUTEX_INITIALIZER;
+static RT_INTR * intr;
+
+static source_t speed;
+static source_t gps;
+static int master = -1;
+static int slave = -1;
+
+static unsigned long rotations;
+static unsigned long sentences;
+static unsigned long lost;
+static RTIME time_first;
+static RTIME time_last;
+static struct timespec wall_end;
+
+/* private functions ======================================================== */
+static double elapsed(const struct timespec * from, const struct timespec * to) {
+    return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+static void source_next(source_t * source, int type) {
+    source->valid = 0;
+
+    while (
+        source->fp != NULL &&
+        fgets(source->line, sizeof source->line, source->fp) != NULL
+    ) {
+        char * comma;
+
+        source->line[strcspn(source->line, "\r\n")] = '\0';
+
+        if (type == EVENT_SPEED) {
+            if (sscanf(source->line, "%llu", &source->time) == 1) {
+                source->valid = 1;
+                return;
+            }
+        }
+        else if ((comma = strrchr(source->line, ',')) != NULL) {
+            /* "$GPGGA,...*hh,%llu", split sentence and timestamp ----------- */
+            *comma = '\0';
+
+            if (sscanf(comma + 1, "%llu", &source->time) == 1) {
+                source->valid = 1;
+                return;
+            }
+        }
+    }
+}
+
+static void source_open(source_t * source, const char * pathname, int type) {
+    if (pathname == NULL) {
+        return;
+    }
+
+    if ((source->fp = fopen(pathname, "r")) == NULL) {
+        perror(pathname);
+        exit(EXIT_FAILURE);
+    }
+
+    source_next(source, type);
+}
+
+static void raise_irq(void) {
+    struct timespec deadline;
+
+    pthread_mutex_lock(&intr_lock);
+
+    if (intr == NULL) {
+        ++lost;
+        pthread_mutex_unlock(&intr_lock);
+        return;
+    }
+
+    pthread_mutex_lock(&intr->lock);
+
+    if (!intr->enabled) {
+        ++lost;
+    }
+    else {
+        ++intr->pending;
+        pthread_cond_broadcast(&intr->cond);
+
+        /* IRQ are delivered one by one, as the hardware would, until the
+         * line is masked ------------------------------------------------- */
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += HANDSHAKE_TIMEOUT;
+
+        while (intr->enabled && (intr->pending != 0 || !intr->waiting)) {
+            if (
+                pthread_cond_timedwait(&intr->cond, &intr->lock, &deadline)
+            ) {
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&intr->lock);
+    pthread_mutex_unlock(&intr_lock);
+}
+
+static void write_sentence(const char * sentence) {
+    char buffer[300];
+    size_t n = strlen(sentence);
+
+    memcpy(buffer, sentence, n);
+
+    /* recordings from older receivers may lack a checksum, add one --------- */
+    if (strchr(sentence, '*') == NULL) {
+        unsigned char checksum = 0;
+        const char * c;
+
+        for (c = sentence + 1; *c; c++) {
+            checksum ^= *c;
+        }
+
+        n += sprintf(buffer + n, "*%02X", checksum);
+    }
+
+    memcpy(buffer + n, "\r\n", 2);
+    n += 2;
+
+    if (write(master, buffer, n) != (ssize_t) n) {
+        ++lost;
+    }
+
+    /* as fast as possible, wait for the GPS task to take it ---------------- */
+    if (rate == 0) {
+        int i, pending = 0;
+
+        for (i = 0; i < 1000; i++) {
+            if (ioctl(slave, FIONREAD, &pending) == -1 || pending == 0) {
+                break;
+            }
+
+            usleep(100);
+        }
+
+        usleep(100);
+    }
+}
+
+static void wait_until(RTIME time) {
+    if (rate == 0) {
+        if (time > clock_now) {
+            clock_now = time;
+        }
+    }
+    else if (time > clock_base) {
+        double seconds = (time - clock_base) / 1e9 / rate;
+        struct timespec deadline = wall_start;
+
+        deadline.tv_sec += (time_t) seconds;
+        deadline.tv_nsec += (long) ((seconds - (time_t) seconds) * 1e9);
+
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_nsec -= 1000000000;
+            ++deadline.tv_sec;
+        }
+
+        while (
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL)
+        ) {
+        }
+    }
+}
+
+static void * thread_routine(void * cookie) {
+    unsigned long events = 0;
+
+    /* replay starts once sensors are started ------------------------------- */
+    pthread_mutex_lock(&start_lock);
+
+    while (!starting) {
+        pthread_cond_wait(&start_cond, &start_lock);
+    }
+
+    pthread_mutex_unlock(&start_lock);
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+    started = 1;
+
+    /* merge both recordings on their timestamps ---------------------------- */
+    while (speed.valid || gps.valid) {
+        int type = EVENT_SPEED;
+        source_t * source = &speed;
+
+        if (!speed.valid || (gps.valid && gps.time < speed.time)) {
+            type = EVENT_GPS;
+            source = &gps;
+        }
+
+        wait_until(source->time);
+
+        if (type == EVENT_SPEED) {
+            /* both edges of the wheel sensor pulse ------------------------ */
+            raise_irq();
+            raise_irq();
+            ++rotations;
+        }
+        else {
+            write_sentence(source->line);
+            ++sentences;
+        }
+
+        time_last = source->time;
+        source_next(source, type);
+
+        /* as fast as possible, do not outrun the log writer thread -------- */
+        if (rate == 0 && ++events % SYNC_EVENTS == 0) {
+            logger_sync();
+        }
+    }
+
+    if (rate == 0) {
+        logger_sync();
+    }
+
+    /* let the pipeline settle before telling the display to stop ----------- */
+    wait_until(time_last + TAIL);
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    done = 1;
+
+    return cookie;
+}
+
+static void summary(void) {
+    double wall;
+
+    if (!done) {
+        clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    }
+
+    wall = started ? elapsed(&wall_start, &wall_end) : 0;
+
+    fprintf(
+        stderr,
+        "ecollect-sim: %lu rotations, %lu sentences, %.3f s recorded, "
+        "replayed in %.3f s (%.1fx), %lu events lost\n",
+        rotations, sentences, (time_last - time_first) / 1e9, wall,
+        wall > 0 ? (time_last - time_first) / 1e9 / wall : 0, lost
+    );
+
+    unlink(GPS_DEVICE);
+}
+
+static void init(void) {
+    const char * session = getenv("ECOSIM_SESSION");
+    const char * speed_pathname = getenv("ECOSIM_SPEED");
+    const char * gps_pathname = getenv("ECOSIM_GPS");
+    const char * rate_string = getenv("ECOSIM_RATE");
+    char speed_default[4096], gps_default[4096];
+    struct termios termios;
+
+    if (session != NULL) {
+        snprintf(speed_default, sizeof speed_default, "%s/speed", session);
+        snprintf(gps_default, sizeof gps_default, "%s/gps", session);
+
+        speed_pathname = speed_pathname ? speed_pathname : speed_default;
+        gps_pathname = gps_pathname ? gps_pathname : gps_default;
+    }
+
+    if (speed_pathname == NULL && gps_pathname == NULL) {
+        fprintf(
+            stderr, "ecollect-sim: set ECOSIM_SESSION, or ECOSIM_SPEED and "
+            "ECOSIM_GPS, to a recorded session\n"
+        );
+        exit(EXIT_FAILURE);
+    }
+
+    rate = rate_string ? atof(rate_string) : 1;
+
+    source_open(&speed, speed_pathname, EVENT_SPEED);
+    source_open(&gps, gps_pathname, EVENT_GPS);
+
+    /* virtual clock starts a bit before the first recorded event ----------- */
+    time_first = speed.valid ? speed.time : gps.time;
+
+    if (gps.valid && gps.time < time_first) {
+        time_first = gps.time;
+    }
+
+    time_last = time_first;
+    clock_base = time_first > LEAD ? time_first - LEAD : 0;
+    clock_now = clock_base;
+
+    /* GPS receiver is a pseudo-terminal, raw until gps_init() sets it up --- */
+    if (
+        (master = posix_openpt(O_RDWR | O_NOCTTY)) == -1 ||
+        grantpt(master) == -1 || unlockpt(master) == -1 ||
+        (slave = open(ptsname(master), O_RDWR | O_NOCTTY)) == -1
+    ) {
+        perror("ecollect-sim: pseudo-terminal");
+        exit(EXIT_FAILURE);
+    }
+
+    tcgetattr(slave, &termios);
+    cfmakeraw(&termios);
+    tcsetattr(slave, TCSANOW, &termios);
+
+    unlink(GPS_DEVICE);
+
+    if (symlink(ptsname(master), GPS_DEVICE) == -1) {
+        perror("ecollect-sim: " GPS_DEVICE);
+        exit(EXIT_FAILURE);
+    }
+
+    atexit(summary);
+
+    pthread_create(&thread, NULL, thread_routine, NULL);
+}
+
+/* public functions ========================================================= */
+void sim_init(void) {
+    pthread_once(&once, init);
+}
+
+RTIME sim_clock_read(void) {
+    struct timespec now;
+
+    if (rate == 0 || !started) {
+        return clock_now;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return clock_base + (RTIME) (elapsed(&wall_start, &now) * rate * 1e9);
+}
+
+void sim_clock_sleep(RTIME delay) {
+    if (rate == 0) {
+        /* the clock only moves with events, just let others run ----------- */
+        sched_yield();
+    }
+    else {
+        double seconds = delay / 1e9 / rate;
+        struct timespec ts;
+
+        ts.tv_sec = (time_t) seconds;
+        ts.tv_nsec = (long) ((seconds - ts.tv_sec) * 1e9);
+
+        nanosleep(&ts, NULL);
+    }
+}
+
+int sim_done(void) {
+    return done;
+}
+
+void sim_start(void) {
+    pthread_mutex_lock(&start_lock);
+    starting = 1;
+    pthread_cond_signal(&start_cond);
+    pthread_mutex_unlock(&start_lock);
+}
+
+void sim_intr_attach(RT_INTR * target) {
+    if (target->irq != SIM_SPEED_IRQ) {
+        return;
+    }
+
+    pthread_mutex_lock(&intr_lock);
+    intr = target;
+    pthread_mutex_unlock(&intr_lock);
+}
+
+void sim_intr_detach(RT_INTR * target) {
+    pthread_mutex_lock(&intr_lock);
+
+    if (intr == target) {
+        intr = NULL;
+    }
+
+    pthread_mutex_unlock(&intr_lock);
+}
@@ -0,0 +1,75 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <xenomai/native/types.h>
+
+/*
+ * host simulation backend: ecollect is built against the POSIX stand-ins of
+ * sim/ instead of Xenomai and libpsgc ("make sim"), and its sensors are fed
+ * from a recorded session, configured through the environment:
+ *
+ *  - ECOSIM_SESSION: recorded session directory, holding "speed" and "gps"
+ *  - ECOSIM_SPEED, ECOSIM_GPS: or each recorded file on its own
+ *  - ECOSIM_RATE: 1 for real-time replay (default), N for N times faster,
+ *    0 for as fast as possible (the clock then jumps from event to event)
+ *  - ECOSIM_DISPLAY: where to record display commands ("display" default)
+ *
+ * wheel rotations are raised as IRQ SIM_SPEED_IRQ, GGA sentences are written
+ * to a pseudo-terminal linked as GPS_DEVICE, which the build points to a
+ * writable place
+ */
+
+#define SIM_SPEED_IRQ 81
+
+/*
+ * sim_init()
+ *
+ * load replay configuration and start the replay thread, which waits for
+ * sim_start() before replaying anything, only the first call does something,
+ * exits the process on error
+ */
+
+void sim_init(void);
+
+/*
+ * sim_start()
+ *
+ * start replaying, once sensors are started
+ */
+
+void sim_start(void);
+
+/*
+ * sim_clock_read()
+ *
+ * return the virtual time (in ns), on the recording timebase
+ */
+
+RTIME sim_clock_read(void);
+
+/*
+ * sim_clock_sleep()
+ *
+ * sleep for delay virtual nanoseconds
+ */
+
+void sim_clock_sleep(RTIME delay);
+
+/*
+ * sim_done()
+ *
+ * returns 1 once the whole recording has been replayed, 0 before
+ */
+
+int sim_done(void);
+
+/*
+ * sim_intr_attach(), sim_intr_detach()
+ *
+ * register or unregister intr as the target of IRQs raised by the replay
+ */
+
+void sim_intr_attach(RT_INTR * intr);
+void sim_intr_detach(RT_INTR * intr);
+
+#endif
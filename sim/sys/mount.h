@@ -0,0 +1,17 @@
+#ifndef SIM_SYS_MOUNT_H
+#define SIM_SYS_MOUNT_H
+
+/*
+ * there is no USB key to mount on a workstation, ECOROOT is a plain directory
+ */
+
+int sim_mount(
+    const char * source, const char * target, const char * type,
+    unsigned long flags, const void * data
+);
+int sim_umount(const char * target);
+
+#define mount sim_mount
+#define umount sim_umount
+
+#endif
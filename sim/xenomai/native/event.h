@@ -0,0 +1,24 @@
+#ifndef SIM_NATIVE_EVENT_H
+#define SIM_NATIVE_EVENT_H
+
+#include "types.h"
+
+#define EV_PRIO 0x1
+#define EV_FIFO 0x0
+#define EV_ANY 0x1
+#define EV_ALL 0x0
+
+int rt_event_create(
+    RT_EVENT * event, const char * name, unsigned long ivalue, int mode
+);
+int rt_event_delete(RT_EVENT * event);
+int rt_event_signal(RT_EVENT * event, unsigned long mask);
+int rt_event_wait(
+    RT_EVENT * event, unsigned long mask, unsigned long * mask_r, int mode,
+    RTIME timeout
+);
+int rt_event_clear(
+    RT_EVENT * event, unsigned long mask, unsigned long * mask_r
+);
+
+#endif
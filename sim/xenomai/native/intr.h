@@ -0,0 +1,12 @@
+#ifndef SIM_NATIVE_INTR_H
+#define SIM_NATIVE_INTR_H
+
+#include "types.h"
+
+int rt_intr_create(RT_INTR * intr, const char * name, unsigned irq, int mode);
+int rt_intr_delete(RT_INTR * intr);
+int rt_intr_wait(RT_INTR * intr, RTIME timeout);
+int rt_intr_enable(RT_INTR * intr);
+int rt_intr_disable(RT_INTR * intr);
+
+#endif
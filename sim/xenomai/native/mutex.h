@@ -0,0 +1,11 @@
+#ifndef SIM_NATIVE_MUTEX_H
+#define SIM_NATIVE_MUTEX_H
+
+#include "types.h"
+
+int rt_mutex_create(RT_MUTEX * mutex, const char * name);
+int rt_mutex_delete(RT_MUTEX * mutex);
+int rt_mutex_acquire(RT_MUTEX * mutex, RTIME timeout);
+int rt_mutex_release(RT_MUTEX * mutex);
+
+#endif
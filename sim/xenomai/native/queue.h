@@ -0,0 +1,26 @@
+#ifndef SIM_NATIVE_QUEUE_H
+#define SIM_NATIVE_QUEUE_H
+
+#include "types.h"
+
+#include <sys/types.h>
+
+#define Q_FIFO 0x0
+#define Q_PRIO 0x1
+#define Q_UNLIMITED 0
+#define Q_NORMAL 0x0
+#define Q_URGENT 0x1
+
+int rt_queue_create(
+    RT_QUEUE * queue, const char * name, size_t poolsize, size_t qlimit,
+    int mode
+);
+int rt_queue_delete(RT_QUEUE * queue);
+ssize_t rt_queue_write(
+    RT_QUEUE * queue, const void * buf, size_t size, int mode
+);
+ssize_t rt_queue_read(
+    RT_QUEUE * queue, void * buf, size_t size, RTIME timeout
+);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef SIM_NATIVE_TASK_H
+#define SIM_NATIVE_TASK_H
+
+#include "types.h"
+
+int rt_task_spawn(
+    RT_TASK * task, const char * name, int stksize, int prio, int mode,
+    void (* entry)(void * cookie), void * cookie
+);
+int rt_task_delete(RT_TASK * task);
+int rt_task_shadow(RT_TASK * task, const char * name, int prio, int mode);
+int rt_task_sleep(RTIME delay);
+int rt_task_set_periodic(RT_TASK * task, RTIME idate, RTIME period);
+int rt_task_wait_period(unsigned long * overruns);
+
+#endif
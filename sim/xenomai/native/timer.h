@@ -0,0 +1,8 @@
+#ifndef SIM_NATIVE_TIMER_H
+#define SIM_NATIVE_TIMER_H
+
+#include "types.h"
+
+RTIME rt_timer_read(void);
+
+#endif
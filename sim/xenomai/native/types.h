@@ -0,0 +1,59 @@
+#ifndef SIM_NATIVE_TYPES_H
+#define SIM_NATIVE_TYPES_H
+
+#include <pthread.h>
+
+/*
+ * POSIX stand-ins for the Xenomai native skin objects used by ecollect, so
+ * the whole pipeline can be built and replayed on a workstation (see sim.h)
+ */
+
+typedef unsigned long long RTIME;
+typedef long long SRTIME;
+
+#define TM_INFINITE 0
+#define TM_NOW 0
+#define TM_NONBLOCK ((RTIME) -1)
+
+typedef struct rt_task_t RT_TASK;
+typedef struct rt_mutex_t RT_MUTEX;
+typedef struct rt_queue_t RT_QUEUE;
+typedef struct rt_intr_t RT_INTR;
+typedef struct rt_event_t RT_EVENT;
+
+struct rt_task_t {
+    pthread_t thread;
+    void (* entry)(void * cookie);
+    void * cookie;
+    RTIME period;   /* 0 unless periodic */
+    RTIME release;  /* next release point */
+};
+
+struct rt_mutex_t {
+    pthread_mutex_t mutex;
+};
+
+struct rt_queue_t {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct rt_queue_message_t * head;
+    struct rt_queue_message_t * tail;
+};
+
+struct rt_intr_t {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned int irq;
+    unsigned long pending;
+    unsigned long lost;
+    int enabled;
+    int waiting;
+};
+
+struct rt_event_t {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned long value;
+};
+
+#endif
@@ -1,84 +1,206 @@
 #include "speed.h"
+#include "bus.h"
+#include "debounce.h"
+#include "fixed.h"
+#include "latency.h"
+#include "logger.h"
+#include "session.h"
+#include "ring.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <xenomai/native/event.h>
 #include <xenomai/native/intr.h>
-#include <xenomai/native/mutex.h>
-#include <xenomai/native/queue.h>
 #include <xenomai/native/task.h>
 #include <xenomai/native/timer.h>
 
 /* constants ================================================================ */
-#define QUEUE_SIZE (64 * sizeof (RTIME))
+#define SAMPLES_SIZE 64
+#define EVENT_SAMPLES 0x1
+#define RECORDS_SIZE 1024
+
+/* types ==================================================================== */
+typedef struct sample_t sample_t;
+
+/* structures =============================================================== */
+struct sample_t {
+    RTIME time;   /* when did the IRQ come? */
+    RTIME queued; /* when was it pushed to the ring? */
+    int resync;   /* no previous rotation to time this one from */
+};
 
 /* private variables ======================================================== */
 static int running;
 
-static FILE * ostream;
+static bus_channel_t channel;
+static session_writer_t writer;
 static RT_INTR intr;
-static RT_MUTEX mutex_instant;
-static RT_MUTEX mutex_average;
-static RT_QUEUE queue;
+static RT_EVENT event;
+static ring_t ring;
+static sample_t samples[SAMPLES_SIZE];
+static unsigned long batch;
+static unsigned long batch_max;
 static RT_TASK task_soft;
 static RT_TASK task_hard;
 
-static double instant;
-static double average;
+static double debounce_fraction;
+static double debounce_min;
+static double debounce_max;
+static debounce_t debounce;
+
+static unsigned int wheel;
+static unsigned int pulses = 1;
+static pulse_t pulse;
+
+static unsigned long window_rotations = SPEED_WINDOW_ROTATIONS;
+static double window_seconds = SPEED_WINDOW_SECONDS;
+static window_t by_rotations;
+static window_t by_time;
 
 /* private functions ======================================================== */
+static int format(FILE * stream, const void * record) {
+    return fprintf(stream, "%llu\n", *(const RTIME *) record);
+}
+
+static int encode(FILE * stream, const void * record) {
+    session_record_t r;
+
+    /* header goes first, once the writer thread owns stream --------------- */
+    if (
+        writer.stream != stream &&
+        session_writer_open(&writer, stream, SESSION_SPEED) == -1
+    ) {
+        return -1;
+    }
+
+    r.time = *(const RTIME *) record;
+
+    return session_write(&writer, &r);
+}
+
+static int encode_close(FILE * stream) {
+    int result = session_writer_flush(&writer);
+
+    /* next stream, if the file is split, starts over with a header -------- */
+    writer.stream = NULL;
+
+    (void) stream;
+
+    return result;
+}
+
+static void sample_read(sample_t * sample) {
+    unsigned long mask;
+
+    /* only sleep once the hard task has nothing left for us, so samples
+       pushed in the meantime are drained in one batch */
+    while (ring_pop(&ring, sample) == -1) {
+        rt_event_wait(&event, EVENT_SAMPLES, &mask, EV_ANY, TM_INFINITE);
+        rt_event_clear(&event, EVENT_SAMPLES, NULL);
+        batch = 0;
+    }
+
+    if (++batch > batch_max) {
+        batch_max = batch;
+    }
+}
+
 static void task_soft_routine(void * cookie) {
-    unsigned long n = 0; /* how many wheel rotations since init? */
+    unsigned long n = 0; /* how many pulses since init? */
+    unsigned long since = 0; /* and since the latest resync? */
+    unsigned int periods; /* how many pulse periods is span? */
+    int rotation;        /* does the current pulse complete one? */
     RTIME time_init = 0; /* when did we start? */
-    RTIME time_prev = 0; /* when was the previous rotation? */
-    RTIME time_curr = 0; /* when was the current rotation? */
+    RTIME time_curr = 0; /* when was the current pulse? */
+    RTIME time_read = 0; /* when did we get the current pulse? */
+    RTIME span = 0;      /* how long did the latest pulses take? */
+    speed_snapshot_t speed;
+    sample_t sample;
+
+    memset(&speed, 0, sizeof speed);
 
-    /* we start now! (first wheel rotation) */
-    rt_queue_read(&queue, &time_init, sizeof time_curr, TM_INFINITE);
+    /* we start now! (first pulse) */
+    sample_read(&sample);
+    time_init = sample.time;
  
-    /* previous rotation is now! (init value) */ 
-    time_prev = time_init;
+    /* previous pulse is now! (init value) */ 
+    pulse_resync(&pulse, time_init);
 
     while (1) {
-        /* extract the current rotation timestamp from message queue */
-        rt_queue_read(&queue, &time_curr, sizeof time_curr, TM_INFINITE);
+        /* extract the current pulse timestamp from the ring */
+        sample_read(&sample);
+        time_read = rt_timer_read();
+        time_curr = sample.time;
+
+        latency_record(LATENCY_QUEUE_TO_SOFT, time_read - sample.queued);
+
+        /* the IRQ was masked and pulses were missed, start over from here,
+           rotations too, which count from this pulse on ------------------ */
+        if (sample.resync) {
+            pulse_resync(&pulse, time_curr);
+            since = 0;
+            continue;
+        }
 
         /* 
-           Let's compute instant speed. We want an Hz value, we've got previous 
-           rotation timestamp and current rotation timestamp, substracting them
-           give us the time elapsed since previous rotation in nanoseconds. 
-           Hz = 1 / s, so Hz = 10^9 / ns, our final value is 10^9 / dt
+           Let's compute instant speed. We want a mm/s value, we've got the
+           current pulse timestamp and the one a rotation before (or as far
+           back as we know), substracting them give us the time elapsed over
+           periods pulses in nanoseconds, during which the wheel went periods
+           / pulses of its length. No double here, we are soft-float:
+           integers only, see fixed_mms().
         */
-        rt_mutex_acquire(&mutex_instant, TM_INFINITE);
-        instant = 1e9 / (time_curr - time_prev);
-        rt_mutex_release(&mutex_instant);
+        periods = pulse_push(&pulse, time_curr, &span);
+        speed.instant = fixed_mms(
+            (unsigned long long) periods * wheel, span * pulses
+        );
 
 	/*
-           Let's compute average speed. We want an Hz value, we've got init
-           rotation timestamp and current rotation timestamp, substracting
-           them gives us the time elapsed since init rotation in nanoseconds.
-           ++n is the number of wheel rotations since init.
-           Hz = 1 / s, so Hz = 10^9 / ns, our final value is 10^9 * dx / dt
+           Let's compute average speed. We want a mm/s value, we've got init
+           pulse timestamp and current pulse timestamp, substracting them
+           gives us the time elapsed since init pulse in nanoseconds. ++n is
+           the number of pulses since init, times the wheel length over
+           pulses is how far we went.
         */
-        rt_mutex_acquire(&mutex_average, TM_INFINITE);
-        average = 1e9 * ++n / (time_curr - time_init);
-        rt_mutex_release(&mutex_average);
+        speed.average = fixed_mms(
+            (unsigned long long) ++n * wheel, (time_curr - time_init) * pulses
+        );
+
+        speed.pulses = n;
+        speed.time = time_curr;
+
+        /* a whole rotation since the latest resync, or the previous one:
+           rolling statistics, each rotation enters and leaves only once,
+           spanning pulses periods, none of them across a resync */
+        rotation = ++since % pulses == 0;
+
+        if (rotation) {
+            ++speed.rotations;
+            speed.rotation_time = time_curr;
+
+            window_push(&by_rotations, time_curr, span);
+            window_push(&by_time, time_curr, span);
+            window_get_stats(&by_rotations, &speed.by_rotations);
+            window_get_stats(&by_time, &speed.by_time);
+        }
 
-        /* dump current timestamp to file */
-        fprintf(ostream, "%llu\n", time_curr);
+        speed.published = rt_timer_read();
 
-        /* our job is done, we are now the previous rotation */ 
-        time_prev = time_curr;
+        /* publish instant and average speed at once, and hand current
+           timestamp to the writer thread if it is a rotation */
+        bus_publish(
+            &channel, time_curr, &speed, rotation ? &time_curr : NULL
+        );
+
+        latency_record(LATENCY_SOFT_TO_PUBLISH, speed.published - time_read);
     }
 
     (void) cookie;
 }
 
 static void task_hard_routine(void * cookie) {
-    unsigned long n = 0; /* how many IRQ since init? */
-    RTIME time_prev = 0; /* when was the previous IRQ? */
     RTIME time_curr = 0; /* when was the current IRQ? */
-
-    /* last IRQ is now! (init value) */
-    time_prev = rt_timer_read();
+    sample_t sample;
 
     while (1) {
         /* wait for an IRQ */
@@ -92,47 +214,113 @@ static void task_hard_routine(void * cookie) {
            - is it a "good transition" (edge triggering, two IRQ = 1 hit)?
            - is it a "real wheel rotation" (our crappy sensor wire sometimes
              decides to become an antenna, so here's a nasty software filter...)
+           Both are told by timing: the second edge of a pulse, as a glitch,
+           comes much sooner after the previous rotation than its period.
         */
-#define EPSILON 100 * 1000 * 1000
-        if (++n % 2 && time_curr > time_prev + EPSILON) {
-#undef  EPSILON
-            /* post the current timestamp to the message queue */
-            rt_queue_write(&queue, &time_curr, sizeof time_curr, Q_NORMAL);
-            
-            /* our job is done, we are now the previous IRQ */
-            time_prev = time_curr;
+        switch (debounce_edge(&debounce, time_curr)) {
+        case DEBOUNCE_ACCEPT:
+        case DEBOUNCE_RESYNC:
+            /* push the current timestamp to the ring, wake the soft task up
+               (a full ring drops it, and counts it) */
+            sample.time = time_curr;
+            sample.resync = debounce.period == 0;
+            sample.queued = rt_timer_read();
+            ring_push(&ring, &sample);
+            rt_event_signal(&event, EVENT_SAMPLES);
+
+            latency_record(LATENCY_IRQ_TO_QUEUE, sample.queued - time_curr);
+            break;
+        case DEBOUNCE_STORM:
+            /* the wire is an antenna right now, stop listening for a while */
+            rt_intr_disable(&intr);
+            rt_task_sleep(DEBOUNCE_STORM_MASK);
+            rt_intr_enable(&intr);
+            break;
+        default:
+            break;
         }
     }
 
     (void) cookie;
 }
 
+static void save_irq(const char * pathname) {
+    FILE * fp;
+
+    if ((fp = fopen(pathname, "w")) == NULL) {
+        return;
+    }
+
+    fprintf(
+        fp, "%lu edges, %lu pulses, %lu rejected, %lu storms "
+        "(%.3f s masked)\n", debounce.edges, debounce.accepted,
+        debounce.rejected, debounce.storms,
+        debounce.storms * (DEBOUNCE_STORM_MASK / 1e9)
+    );
+
+    fprintf(
+        fp, "%lu/%lu high water, %lu max batch, %lu dropped\n",
+        ring.high_water, ring.count, batch_max, ring.dropped
+    );
+
+    fclose(fp);
+}
+
 /* public functions ========================================================= */
 int speed_init(void) {
     if (running) {
         goto err_running;
     }
 
-    if ((ostream = fopen("speed", "w")) == NULL) {
-        goto err_ostream;
+    writer.stream = NULL;
+
+    if (logger_binary()) {
+        if (
+            bus_open(
+                &channel, BUS_SPEED, sizeof (speed_snapshot_t), "speed.bin",
+                encode, encode_close, sizeof (RTIME), RECORDS_SIZE
+            ) == -1
+        ) {
+            goto err_channel;
+        }
+    }
+    else if (
+        bus_open(
+            &channel, BUS_SPEED, sizeof (speed_snapshot_t), "speed", format,
+            NULL, sizeof (RTIME), RECORDS_SIZE
+        ) == -1
+    ) {
+        goto err_channel;
     }
 
+    ring_init(&ring, samples, sizeof *samples, SAMPLES_SIZE);
+    batch = 0;
+    batch_max = 0;
+
+    rt_event_create(&event, "irq81", 0, EV_FIFO);
     rt_intr_create(&intr, NULL, 81, 0);
     rt_intr_enable(&intr);
-    rt_mutex_create(&mutex_instant, NULL);
-    rt_mutex_create(&mutex_average, NULL);
-    rt_queue_create(&queue, "irq81", QUEUE_SIZE, Q_UNLIMITED, Q_FIFO);
+
+    latency_reset();
+
+    debounce_init(
+        &debounce, debounce_fraction, debounce_min * 1e9, debounce_max * 1e9,
+        pulses
+    );
+
+    pulse_init(&pulse, pulses);
+
+    window_init(&by_rotations, wheel, window_rotations, 0);
+    window_init(&by_time, wheel, 0, window_seconds * 1e9);
+
     rt_task_spawn(&task_soft, NULL, 0, 80, 0, task_soft_routine, NULL);
     rt_task_spawn(&task_hard, NULL, 0, 90, 0, task_hard_routine, NULL);
 
-    instant = 0;
-    average = 0;
-
     running = 1;
 
     return 0;
 
-err_ostream:
+err_channel:
 err_running:
     return -1;
 }
@@ -146,21 +334,13 @@ int speed_exit(void) {
 
     rt_task_delete(&task_hard);
     rt_task_delete(&task_soft);
-    rt_queue_delete(&queue);
-    rt_mutex_delete(&mutex_average);
-    rt_mutex_delete(&mutex_instant);
     rt_intr_disable(&intr);
     rt_intr_delete(&intr);
+    rt_event_delete(&event);
 
-    fclose(ostream);
-
-/* START DEBUG DEBUG DEBUG */
-    {
-        FILE * fp = fopen("average", "w");
-        fprintf(fp, "%f\n", average);
-        fclose(fp);
-    }
-/* STOP DEBUG DEBUG DEBUG */
+    /* save how long rotations took from IRQ to LCD, and what was filtered */
+    latency_dump("latency");
+    save_irq("irq");
 
     return 0;
 
@@ -168,33 +348,33 @@ err_not_running:
     return -1;
 }
 
-int speed_get_instant(double * dest) {
-    if (!running) {
-        goto err_not_running;
-    }
-
-    rt_mutex_acquire(&mutex_instant, TM_INFINITE);
-    *dest = instant;
-    rt_mutex_release(&mutex_instant);
+void speed_set_debounce(double fraction, double min, double max) {
+    debounce_fraction = fraction;
+    debounce_min = min;
+    debounce_max = max;
+}
 
-    return 0;
+void speed_set_wheel(unsigned int wheel_length) {
+    wheel = wheel_length;
+}
 
-err_not_running:
-    return -1;
+void speed_set_pulses(unsigned int per_revolution) {
+    pulses =
+        per_revolution > 0 && per_revolution <= PULSE_MAX ? per_revolution : 1;
 }
 
+void speed_set_windows(unsigned long rotations, double seconds) {
+    window_rotations = rotations ? rotations : SPEED_WINDOW_ROTATIONS;
+    window_seconds = seconds > 0 ? seconds : SPEED_WINDOW_SECONDS;
+}
 
-int speed_get_average(double * dest) {
-    if (!running) {
-        goto err_not_running;
+unsigned long speed_decay(
+    const speed_snapshot_t * speed, unsigned long long now
+) {
+    /* nothing yet, or a pulse newer than now: as it was published --------- */
+    if (speed->pulses == 0 || now <= speed->time) {
+        return speed->instant;
     }
 
-    rt_mutex_acquire(&mutex_average, TM_INFINITE);
-    *dest = average;
-    rt_mutex_release(&mutex_average);
-
-    return 0;
-
-err_not_running:
-    return -1;
+    return pulse_decay(speed->instant, wheel, pulses, now - speed->time);
 }
@@ -1,51 +1,111 @@
 #ifndef SPEED_H
 #define SPEED_H
 
+#include "pulse.h"
+#include "window.h"
+
+#define SPEED_WINDOW_ROTATIONS 8
+#define SPEED_WINDOW_SECONDS 5.0
+
+typedef struct speed_snapshot_t speed_snapshot_t;
+
+struct speed_snapshot_t {
+    unsigned long instant;   /* speed over the latest pulses, up to a
+                                rotation of them (in mm/s) */
+    unsigned long average;   /* speed since the first pulse (in mm/s) */
+    unsigned long rotations; /* whole rotations since the first pulse, each
+                                one spanning pulses since a resync only */
+    unsigned long pulses;    /* pulses since the first one */
+    unsigned long long time; /* latest pulse timestamp (in ns) */
+    unsigned long long rotation_time; /* latest whole rotation one (in ns) */
+    unsigned long long published; /* when this snapshot was published */
+    window_stats_t by_rotations; /* over the latest rotations (in mm/s) */
+    window_stats_t by_time;      /* over the latest seconds (in mm/s) */
+};
+
 /*
- * speed_init()
+ * speed_set_debounce()
  *
- * start speed sensor thread, which will save nanosecond timestamp in a
- * "./speed" text file and compute instant and average speed, each time the
- * sensor detects a wheel rotation
+ * set how the wheel sensor edges are filtered, from next speed_init() on: an
+ * edge is a pulse if it comes at least fraction of the latest rotation period
+ * over its pulses after the previous one, that threshold being kept in
+ * between min and max seconds a rotation, over its pulses too (see
+ * debounce.h); 0 for DEBOUNCE_FRACTION, DEBOUNCE_MIN and DEBOUNCE_MAX
+ */
+
+void speed_set_debounce(double fraction, double min, double max);
+
+/*
+ * speed_set_wheel()
  *
- * returns -1 if:
- *  - speed sensor thread is already running
- *  - "./speed" text file could not be opened for writing
+ * set wheel length (in mm) instant and average speeds are computed for, from
+ * next speed_init() on; 0 until set, so are speeds
  */
 
-int speed_init(void);
+void speed_set_wheel(unsigned int wheel_length);
 
 /*
- * speed_exit()
+ * speed_set_pulses()
  *
- * stop speed sensor thread, which will close the "./speed" text file
+ * set how many pulses the wheel sensor gives per rotation, one per magnet
+ * on the wheel, from next speed_init() on; 0 for 1, as do more than
+ * PULSE_MAX
+ */
+
+void speed_set_pulses(unsigned int per_revolution);
+
+/*
+ * speed_set_windows()
  *
- * returns -1 if:
- *  - speed sensor thread is not running
+ * set how many of the latest rotations, and how many of the latest seconds,
+ * rolling statistics are computed over, from next speed_init() on, 0 for
+ * SPEED_WINDOW_ROTATIONS and SPEED_WINDOW_SECONDS; either window never holds
+ * more than WINDOW_MAX rotations
  */
 
-int speed_exit(void);
+void speed_set_windows(unsigned long rotations, double seconds);
 
 /*
- * speed_get_instant()
+ * speed_init()
  *
- * write instant speed (in Hz) to dest
+ * start speed sensor thread, which will compute instant and average speeds
+ * each time the sensor detects a pulse, and, each time a pulse completes a
+ * wheel rotation, counted from the latest resync on, log its nanosecond
+ * timestamp to a "./speed" text file, as rotation_time, and update rolling
+ * speed statistics; they are published as a speed_snapshot_t
+ * to the BUS_SPEED channel (see bus.h), so instant and average always come
+ * from the same pulse, bus_init() must have been called
  *
  * returns -1 if:
- *  - speed sensor thread is not running
+ *  - speed sensor thread is already running
+ *  - BUS_SPEED channel could not be opened
  */
 
-int speed_get_instant(double * dest);
+int speed_init(void);
 
 /*
- * speed_get_average()
+ * speed_exit()
  *
- * write average speed (in Hz) to dest
+ * stop speed sensor thread, save latency statistics from IRQ to LCD in a
+ * "./latency" text file, and edge filter and sample ring counters in a
+ * "./irq" text file, "./speed" text file is closed by logger_exit()
  *
  * returns -1 if:
  *  - speed sensor thread is not running
  */
 
-int speed_get_average(double * dest);
+int speed_exit(void);
+
+/*
+ * speed_decay()
+ *
+ * returns speed->instant as of now (in ns), falling towards 0 as the next
+ * pulse keeps not coming, and 0 once the wheel has stopped (see
+ * pulse_decay()); for readers, once speed_init() has been called
+ */
+
+unsigned long speed_decay(
+    const speed_snapshot_t * speed, unsigned long long now
+);
 
 #endif
@@ -0,0 +1,328 @@
+#include "telemetry.h"
+#include "bus.h"
+#include "energy.h"
+#include "frame.h"
+#include "gps.h"
+#include "speed.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <xenomai/native/timer.h>
+
+/* constants ================================================================ */
+#define TELEMETRY_PERIOD (50 * 1000 * 1000)
+#define TELEMETRY_HEARTBEAT (1000ULL * 1000 * 1000)
+#define LINK_MAX 64
+
+/* private variables ======================================================== */
+static int running;
+static int stopping;
+
+static char link_name[LINK_MAX];
+static unsigned long baud = TELEMETRY_BAUD;
+static unsigned long budget = TELEMETRY_BUDGET;
+static volatile int sector = -1;
+
+static int fd = -1;
+static pthread_t thread;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeup;
+
+static unsigned long frames;
+static unsigned long bytes;
+static unsigned long deferred;      /* changed frames the budget held back */
+static unsigned long errors;
+
+/* private functions ======================================================== */
+static unsigned long long now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static speed_t baud_constant(unsigned long value) {
+    switch (value) {
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    case 115200:
+        return B115200;
+    default:
+        return B0;
+    }
+}
+
+static int open_udp(const char * host_port) {
+    struct addrinfo hints, * info;
+    char host[LINK_MAX];
+    const char * port;
+    int s;
+
+    /* "host:port", the port is after the last colon ----------------------- */
+    if ((port = strrchr(host_port, ':')) == NULL) {
+        return -1;
+    }
+
+    snprintf(host, sizeof host, "%.*s", (int) (port - host_port), host_port);
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    if (getaddrinfo(host, port + 1, &hints, &info) != 0) {
+        return -1;
+    }
+
+    s = socket(info->ai_family, info->ai_socktype, info->ai_protocol);
+
+    if (s != -1 && connect(s, info->ai_addr, info->ai_addrlen) == -1) {
+        close(s);
+        s = -1;
+    }
+
+    freeaddrinfo(info);
+
+    return s;
+}
+
+static int open_tty(const char * pathname) {
+    struct termios termios;
+    int s;
+
+    if ((s = open(pathname, O_WRONLY | O_NOCTTY)) == -1) {
+        return -1;
+    }
+
+    tcgetattr(s, &termios);
+    cfmakeraw(&termios);
+    cfsetspeed(&termios, baud_constant(baud));
+    tcsetattr(s, TCSANOW, &termios);
+
+    return s;
+}
+
+static void sample(frame_t * frame) {
+    speed_snapshot_t speed;
+    gps_fix_t fix;
+    energy_snapshot_t energy;
+
+    memset(frame, 0, sizeof *frame);
+    frame->sector = sector;
+
+    if (bus_read(BUS_SPEED, &speed, sizeof speed, NULL) != -1) {
+        frame->flags |= FRAME_SPEED;
+        frame->instant = speed_decay(&speed, rt_timer_read());
+        frame->average = speed.average;
+        frame->rotations = speed.rotations;
+    }
+
+    if (bus_read(BUS_GPS, &fix, sizeof fix, NULL) != -1 && fix.frames > 0) {
+        frame->flags |= FRAME_FIX;
+        frame->latitude = fix.nmea.latitude;
+        frame->longitude = fix.nmea.longitude;
+        frame->quality = fix.nmea.quality;
+        frame->satellites = fix.nmea.satellites;
+        frame->frames = fix.frames;
+        frame->errors = fix.errors;
+    }
+
+    if (bus_read(BUS_ENERGY, &energy, sizeof energy, NULL) != -1) {
+        frame->flags |= FRAME_ENERGY;
+        frame->power = energy.power / 1000;
+        frame->energy = energy.energy / (ENERGY_NJ_PER_WH / 100);
+    }
+}
+
+static void * thread_routine(void * cookie) {
+    unsigned char packed[FRAME_SIZE];
+    unsigned long long credit = FRAME_SIZE * 1000000000ULL; /* bytes, ns */
+    unsigned long long time_prev = now();
+    unsigned long long time_sent = 0;
+    unsigned int sequence = 0;
+    frame_t sent, frame;
+    struct timespec deadline;
+
+    memset(&sent, 0, sizeof sent);
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+    pthread_mutex_lock(&lock);
+
+    while (!stopping) {
+        unsigned long long time_curr;
+
+        pthread_mutex_unlock(&lock);
+
+        /* budget comes back with time, never more than one burst ---------- */
+        time_curr = now();
+        credit += (time_curr - time_prev) * budget;
+        time_prev = time_curr;
+
+        if (credit > FRAME_SIZE * 1000000000ULL) {
+            credit = FRAME_SIZE * 1000000000ULL;
+        }
+
+        /* same as last time but for time and sequence, nothing to tell ---- */
+        sample(&frame);
+        frame.sequence = sent.sequence;
+        frame.time = sent.time;
+
+        if (
+            memcmp(&frame, &sent, sizeof frame) != 0 ||
+            time_curr - time_sent >= TELEMETRY_HEARTBEAT
+        ) {
+            if (credit < FRAME_SIZE * 1000000000ULL) {
+                ++deferred;
+            }
+            else {
+                frame.sequence = sequence++ & 0xffff;
+                frame.time = rt_timer_read() / 1000000;
+                frame_pack(&frame, packed);
+
+                if (write(fd, packed, sizeof packed) != sizeof packed) {
+                    ++errors;
+                }
+
+                credit -= FRAME_SIZE * 1000000000ULL;
+                time_sent = time_curr;
+                sent = frame;
+                bytes += sizeof packed;
+                ++frames;
+            }
+        }
+
+        deadline.tv_nsec += TELEMETRY_PERIOD;
+
+        while (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_nsec -= 1000000000;
+            ++deadline.tv_sec;
+        }
+
+        pthread_mutex_lock(&lock);
+
+        while (!stopping) {
+            if (pthread_cond_timedwait(&wakeup, &lock, &deadline) != 0) {
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&lock);
+
+    return cookie;
+}
+
+static void save_stats(const char * pathname) {
+    FILE * fp;
+
+    if ((fp = fopen(pathname, "w")) == NULL) {
+        return;
+    }
+
+    fprintf(
+        fp, "%s %lu frames, %lu bytes, %lu deferred, %lu errors\n",
+        link_name, frames, bytes, deferred, errors
+    );
+
+    fclose(fp);
+}
+
+/* public functions ========================================================= */
+void telemetry_set_link(
+    const char * pathname, unsigned long baud_rate, unsigned long bytes_rate
+) {
+    snprintf(
+        link_name, sizeof link_name, "%s", pathname != NULL ? pathname : ""
+    );
+    baud = baud_constant(baud_rate) != B0 ? baud_rate : TELEMETRY_BAUD;
+    budget = bytes_rate ? bytes_rate : TELEMETRY_BUDGET;
+}
+
+void telemetry_set_sector(int value) {
+    sector = value;
+}
+
+int telemetry_init(void) {
+    pthread_condattr_t attr;
+
+    if (running) {
+        goto err_running;
+    }
+
+    if (strncmp(link_name, "udp:", 4) == 0) {
+        fd = open_udp(link_name + 4);
+    }
+    else {
+        fd = open_tty(link_name);
+    }
+
+    if (fd == -1) {
+        goto err_link;
+    }
+
+    stopping = 0;
+    frames = 0;
+    bytes = 0;
+    deferred = 0;
+    errors = 0;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wakeup, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if (pthread_create(&thread, NULL, thread_routine, NULL) != 0) {
+        goto err_thread;
+    }
+
+    running = 1;
+
+    return 0;
+
+err_thread:
+    pthread_cond_destroy(&wakeup);
+    close(fd);
+
+err_link:
+err_running:
+    return -1;
+}
+
+int telemetry_exit(void) {
+    if (!running) {
+        goto err_not_running;
+    }
+
+    running = 0;
+
+    pthread_mutex_lock(&lock);
+    stopping = 1;
+    pthread_cond_signal(&wakeup);
+    pthread_mutex_unlock(&lock);
+
+    pthread_join(thread, NULL);
+    pthread_cond_destroy(&wakeup);
+
+    close(fd);
+
+    save_stats("telemetry");
+
+    return 0;
+
+err_not_running:
+    return -1;
+}
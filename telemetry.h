@@ -0,0 +1,57 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#define TELEMETRY_BAUD 9600     /* radio link, unless told otherwise */
+#define TELEMETRY_BUDGET 480    /* bytes/s, half of a 9600 baud link */
+
+/*
+ * telemetry_set_link()
+ *
+ * set where frames (see frame.h) go, from next telemetry_init() on: either
+ * "udp:host:port", one frame per datagram, or a serial radio tty, at baud,
+ * 0 for TELEMETRY_BAUD; at most budget bytes per second are sent, 0 for
+ * TELEMETRY_BUDGET
+ */
+
+void telemetry_set_link(
+    const char * link, unsigned long baud, unsigned long budget
+);
+
+/*
+ * telemetry_set_sector()
+ *
+ * tell which sector the vehicle is in, -1 for none, from any thread
+ */
+
+void telemetry_set_sector(int sector);
+
+/*
+ * telemetry_init()
+ *
+ * start the telemetry thread, a low priority non real-time thread, which
+ * only ever reads the bus (see bus.h), so sensors never wait for it: every
+ * TELEMETRY_PERIOD, it packs latest speed, fix, sector, energy and counters
+ * into a frame, and sends it if anything but its time changed, or if nothing
+ * was sent for TELEMETRY_HEARTBEAT, as long as the byte budget allows
+ *
+ * returns -1 if:
+ *  - telemetry thread is already running
+ *  - link could not be opened
+ *  - telemetry thread could not be created
+ */
+
+int telemetry_init(void);
+
+/*
+ * telemetry_exit()
+ *
+ * stop the telemetry thread, close the link, and save frame, byte, deferred
+ * and error counts in a "./telemetry" text file
+ *
+ * returns -1 if:
+ *  - telemetry thread is not running
+ */
+
+int telemetry_exit(void);
+
+#endif
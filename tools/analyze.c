@@ -0,0 +1,628 @@
+#include "nmea.h"
+#include "sector.h"
+#include "session.h"
+#include "speed.h"
+#include "window.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * analyze: per session and per sector statistics of many session directories,
+ * as ecollect logged them to its USB key, text or binary; sessions are spread
+ * over one thread per core, and text logs are mapped rather than read; a log
+ * split before the vfat limit is read part after part, as a single one
+ *
+ * rotations are replayed through the same rolling window as the speed task,
+ * fixes through the same sector matching as the sector screen: a rotation
+ * counts for the sector the latest valid fix was in, in band, over or under
+ * as its smoothed speed was shown to the driver; the first logged rotation
+ * only starts the clock, as a rotation spanning an IRQ storm, or a stop,
+ * counts as a single slow one
+ *
+ * usage: analyze [-j threads] config sectors session...
+ */
+
+/* constants ================================================================ */
+#define FIXES_CAPACITY 1024
+
+/* types ==================================================================== */
+typedef struct log_t log_t;
+typedef struct fix_t fix_t;
+typedef struct stats_t stats_t;
+typedef struct job_t job_t;
+typedef struct worker_t worker_t;
+
+/* structures =============================================================== */
+struct log_t {
+    const char * directory;
+    const char * name;
+    unsigned int part;          /* 0, then 1 on for split logs */
+    int binary;
+
+    /* text log, mapped */
+    const char * p;
+    const char * end;
+    void * memory;
+    size_t size;
+
+    /* binary log */
+    FILE * stream;
+    session_reader_t reader;
+};
+
+struct fix_t {
+    unsigned long long time;    /* when ecollect received it */
+    int sector;                 /* matched sector, -1 if none or invalid */
+};
+
+struct stats_t {
+    unsigned long long time;    /* ns spent */
+    unsigned long long in;      /* ns spent in between speed_min and max */
+    unsigned long long over;
+    unsigned long long under;
+    unsigned long rotations;
+};
+
+struct job_t {
+    const char * pathname;
+    char * report;
+    size_t report_size;
+    int error;
+};
+
+struct worker_t {
+    pthread_t thread;
+    log_t speed;
+    log_t gps;
+    nmea_parser_t parser;
+    window_t window;
+    fix_t * fixes;
+    size_t fixes_capacity;
+    stats_t * sectors;          /* one per sector, then one for off sector */
+};
+
+/* private variables ======================================================== */
+static unsigned int wheel_length;
+static double epsilon_latitude;
+static double epsilon_longitude;
+static unsigned long window_rotations;
+
+static sector_file_t sector_file;
+
+static job_t * jobs;
+static size_t job_count;
+static size_t job_next;
+
+/* private functions ======================================================== */
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int parse_time(log_t * log, unsigned long long * dest) {
+    unsigned long long x = 0;
+    int digits = 0;
+
+    while (log->p < log->end && (*log->p < '0' || *log->p > '9')) {
+        ++log->p;
+    }
+
+    while (log->p < log->end && *log->p >= '0' && *log->p <= '9') {
+        x = x * 10 + (*log->p++ - '0');
+        ++digits;
+    }
+
+    *dest = x;
+
+    return digits ? 0 : -1;
+}
+
+static void log_pathname(
+    const log_t * log, char * pathname, size_t size, int binary
+) {
+    const char * suffix = binary ? ".bin" : "";
+
+    /* first part goes by the log name, next ones get a number ------------- */
+    if (log->part == 0) {
+        snprintf(pathname, size, "%s/%s%s", log->directory, log->name, suffix);
+    }
+    else {
+        snprintf(
+            pathname, size, "%s/%s%s.%u", log->directory, log->name, suffix,
+            log->part
+        );
+    }
+}
+
+static int log_open_part(log_t * log) {
+    char pathname[4096];
+    struct stat st;
+    int fd;
+
+    log->stream = NULL;
+    log->memory = NULL;
+    log->size = 0;
+    log->p = log->end = NULL;
+
+    /* binary log if there is one, text one otherwise ---------------------- */
+    if (log->binary) {
+        log_pathname(log, pathname, sizeof pathname, 1);
+
+        if ((log->stream = fopen(pathname, "rb")) == NULL) {
+            return -1;
+        }
+
+        /* each part starts over with a header --------------------------- */
+        if (session_reader_open(&log->reader, log->stream) == -1) {
+            fclose(log->stream);
+            log->stream = NULL;
+            return -1;
+        }
+
+        return 0;
+    }
+
+    log_pathname(log, pathname, sizeof pathname, 0);
+
+    if ((fd = open(pathname, O_RDONLY)) == -1) {
+        return -1;
+    }
+
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    /* an empty log is fine, but cannot be mapped -------------------------- */
+    if (st.st_size > 0) {
+        log->size = st.st_size;
+        log->memory = mmap(NULL, log->size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (log->memory == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+
+        madvise(log->memory, log->size, MADV_SEQUENTIAL);
+        log->p = log->memory;
+        log->end = log->p + log->size;
+    }
+
+    close(fd);
+
+    return 0;
+}
+
+static void log_close(log_t * log) {
+    if (log->stream != NULL) {
+        fclose(log->stream);
+        log->stream = NULL;
+    }
+    else if (log->memory != NULL) {
+        munmap(log->memory, log->size);
+        log->memory = NULL;
+    }
+}
+
+static int log_open(log_t * log, const char * directory, const char * name) {
+    char pathname[4096];
+
+    log->directory = directory;
+    log->name = name;
+    log->part = 0;
+
+    /* binary log if there is one, text one otherwise ---------------------- */
+    log_pathname(log, pathname, sizeof pathname, 1);
+    log->binary = access(pathname, F_OK) == 0;
+
+    return log_open_part(log);
+}
+
+static int log_next(log_t * log) {
+    /* a log about to reach the vfat limit goes on in "name.1", and so on -- */
+    log_close(log);
+    ++log->part;
+
+    return log_open_part(log);
+}
+
+static int log_speed(log_t * log, unsigned long long * time) {
+    session_record_t record;
+
+    if (!log->binary) {
+        while (parse_time(log, time) == -1) {
+            if (log_next(log) == -1) {
+                return -1;
+            }
+        }
+
+        return 0;
+    }
+
+    while (session_read(&log->reader, &record) == -1) {
+        if (log_next(log) == -1) {
+            return -1;
+        }
+    }
+
+    *time = record.time;
+
+    return 0;
+}
+
+static int log_gps(
+    log_t * log, nmea_parser_t * parser, session_record_t * dest
+) {
+    do {
+        if (log->binary) {
+            if (session_read(&log->reader, dest) != -1) {
+                return 0;
+            }
+
+            continue;
+        }
+
+        /* "sentence,time" lines, sentence as the GPS task decodes it ------- */
+        while (log->p < log->end) {
+            if (nmea_parse(parser, *log->p++) == NMEA_GGA) {
+                dest->fix = parser->fix;
+
+                return parse_time(log, &dest->time);
+            }
+        }
+    } while (log_next(log) != -1);
+
+    return -1;
+}
+
+static long load_fixes(worker_t * worker) {
+    session_record_t record;
+    size_t count = 0, current = 0;
+
+    nmea_init(&worker->parser);
+
+    while (log_gps(&worker->gps, &worker->parser, &record) != -1) {
+        fix_t * fix;
+
+        if (count == worker->fixes_capacity) {
+            size_t capacity = 2 * worker->fixes_capacity;
+            fix_t * fixes = realloc(worker->fixes, capacity * sizeof *fixes);
+
+            if (fixes == NULL) {
+                return -1;
+            }
+
+            worker->fixes = fixes;
+            worker->fixes_capacity = capacity;
+        }
+
+        fix = &worker->fixes[count++];
+        fix->time = record.time;
+        fix->sector = -1;
+
+        /* valid fixes only (1 or 2), then same walk as the sector screen -- */
+        if (
+            (record.fix.quality == 1 || record.fix.quality == 2) &&
+            sector_match(
+                &sector_file.index, sector_file.sectors, sector_file.count,
+                record.fix.latitude, record.fix.longitude, &current
+            ) != -1
+        ) {
+            fix->sector = current;
+        }
+    }
+
+    return count;
+}
+
+static void report(
+    FILE * fp, const char * name, const stats_t * stats
+) {
+    double time = stats->time / 1e9;
+    double distance = stats->rotations * (wheel_length / 1000.0);
+
+    fprintf(
+        fp, "%8s %9.1f %9.1f %9.1f %9.1f %12.1f %7.1f\n", name, time,
+        stats->in / 1e9, stats->over / 1e9, stats->under / 1e9, distance,
+        time > 0 ? distance / time * 3.6 : 0
+    );
+}
+
+static int analyze(worker_t * worker, job_t * job) {
+    stats_t * off = &worker->sectors[sector_file.count];
+    stats_t total;
+    window_stats_t window;
+    unsigned long long time_prev, time_curr;
+    size_t i, fix = 0;
+    long fixes;
+    int sector = -1;
+    FILE * fp;
+
+    if (log_open(&worker->speed, job->pathname, "speed") == -1) {
+        goto err_speed;
+    }
+
+    if (log_open(&worker->gps, job->pathname, "gps") == -1) {
+        goto err_gps;
+    }
+
+    if ((fixes = load_fixes(worker)) == -1) {
+        goto err_fixes;
+    }
+
+    memset(worker->sectors, 0, (sector_file.count + 1) * sizeof *off);
+    memset(&total, 0, sizeof total);
+    window_init(&worker->window, wheel_length, window_rotations, 0);
+
+    /* first rotation, as the speed task, only tells when we started -------- */
+    if (log_speed(&worker->speed, &time_prev) == -1) {
+        time_prev = 0;
+    }
+
+    while (log_speed(&worker->speed, &time_curr) != -1) {
+        unsigned long long period = time_curr - time_prev;
+        stats_t * stats;
+
+        /* catch up with the fixes received so far -------------------------- */
+        while (fix < (size_t) fixes && worker->fixes[fix].time <= time_curr) {
+            sector = worker->fixes[fix++].sector;
+        }
+
+        window_push(&worker->window, time_curr, period);
+        window_get_stats(&worker->window, &window);
+
+        stats = sector == -1 ? off : &worker->sectors[sector];
+        stats->time += period;
+        ++stats->rotations;
+
+        /* off sectors, there is no band to be in ------------------------- */
+        if (sector != -1) {
+            switch (
+                sector_band(
+                    &sector_file.sectors[sector], (long) window.mean
+                )
+            ) {
+            case SECTOR_IN:
+                stats->in += period;
+                break;
+            case SECTOR_UNDER:
+                stats->under += period;
+                break;
+            default:
+                stats->over += period;
+                break;
+            }
+        }
+
+        time_prev = time_curr;
+    }
+
+    /* one report per session, only sectors the vehicle went through -------- */
+    if ((fp = open_memstream(&job->report, &job->report_size)) == NULL) {
+        goto err_report;
+    }
+
+    fprintf(
+        fp, "%s\n%8s %9s %9s %9s %9s %12s %7s\n", job->pathname, "sector",
+        "time (s)", "in (s)", "over (s)", "under (s)", "distance (m)",
+        "km/h"
+    );
+
+    for (i = 0; i < sector_file.count; i++) {
+        const stats_t * stats = &worker->sectors[i];
+        char name[24];
+
+        if (stats->rotations == 0) {
+            continue;
+        }
+
+        snprintf(name, sizeof name, "%lu", (unsigned long) i);
+        report(fp, name, stats);
+
+        total.time += stats->time;
+        total.in += stats->in;
+        total.over += stats->over;
+        total.under += stats->under;
+        total.rotations += stats->rotations;
+    }
+
+    if (off->rotations) {
+        report(fp, "off", off);
+    }
+
+    total.time += off->time;
+    total.rotations += off->rotations;
+    report(fp, "session", &total);
+    fclose(fp);
+
+    log_close(&worker->gps);
+    log_close(&worker->speed);
+
+    return 0;
+
+err_report:
+err_fixes:
+    log_close(&worker->gps);
+
+err_gps:
+    log_close(&worker->speed);
+
+err_speed:
+    return -1;
+}
+
+static void * worker_routine(void * cookie) {
+    worker_t * worker = cookie;
+    size_t i;
+
+    /* take the next session nobody has taken yet -------------------------- */
+    while ((i = __sync_fetch_and_add(&job_next, 1)) < job_count) {
+        jobs[i].error = analyze(worker, &jobs[i]) == -1;
+    }
+
+    return NULL;
+}
+
+static int load_config(const char * pathname) {
+    FILE * fp;
+
+    /* same config file as ecollect: wheel length, epsilons, windows -------- */
+    if ((fp = fopen(pathname, "r")) == NULL) {
+        return -1;
+    }
+
+    if (
+        fscanf(
+            fp, "%u %lf %lf", &wheel_length, &epsilon_latitude,
+            &epsilon_longitude
+        ) != 3
+    ) {
+        fclose(fp);
+        return -1;
+    }
+
+    if (fscanf(fp, "%lu", &window_rotations) != 1 || window_rotations == 0) {
+        window_rotations = SPEED_WINDOW_ROTATIONS;
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
+/* entry point ============================================================== */
+int main(int argc, char * argv[]) {
+    worker_t * workers;
+    long thread_count = sysconf(_SC_NPROCESSORS_ONLN);
+    long i, started;
+    int c, status = EXIT_SUCCESS;
+    double begin = now();
+
+    while ((c = getopt(argc, argv, "j:")) != -1) {
+        if (c != 'j' || (thread_count = atol(optarg)) < 1) {
+            goto usage;
+        }
+    }
+
+    if (argc - optind < 3) {
+        goto usage;
+    }
+
+    if (thread_count < 1) {
+        thread_count = 1;
+    }
+
+    if (load_config(argv[optind]) == -1) {
+        fprintf(stderr, "%s: no wheel length and GPS epsilons\n", argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    /* compiled sector file, or text one, as ecollect itself --------------- */
+    if (
+        sector_file_load(
+            &sector_file, argv[optind + 1], epsilon_latitude, epsilon_longitude
+        ) == -1 &&
+        sector_file_load_text(
+            &sector_file, argv[optind + 1], epsilon_latitude, epsilon_longitude
+        ) == -1
+    ) {
+        perror(argv[optind + 1]);
+        return EXIT_FAILURE;
+    }
+
+    job_count = argc - optind - 2;
+    jobs = calloc(job_count, sizeof *jobs);
+
+    if ((size_t) thread_count > job_count) {
+        thread_count = job_count;
+    }
+
+    workers = calloc(thread_count, sizeof *workers);
+
+    if (jobs == NULL || workers == NULL) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < (long) job_count; i++) {
+        jobs[i].pathname = argv[optind + 2 + i];
+    }
+
+    for (i = 0; i < thread_count; i++) {
+        workers[i].fixes_capacity = FIXES_CAPACITY;
+        workers[i].fixes = malloc(FIXES_CAPACITY * sizeof *workers[i].fixes);
+        workers[i].sectors = malloc(
+            (sector_file.count + 1) * sizeof *workers[i].sectors
+        );
+
+        if (workers[i].fixes == NULL || workers[i].sectors == NULL) {
+            perror("malloc");
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (started = 0; started < thread_count; started++) {
+        if (
+            pthread_create(
+                &workers[started].thread, NULL, worker_routine,
+                &workers[started]
+            ) != 0
+        ) {
+            break;
+        }
+    }
+
+    /* a thread could not start, take its share --------------------------- */
+    if (started < thread_count) {
+        worker_routine(&workers[started]);
+    }
+
+    for (i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    for (i = 0; i < thread_count; i++) {
+        free(workers[i].sectors);
+        free(workers[i].fixes);
+    }
+
+    /* reports in command line order ---------------------------------------- */
+    for (i = 0; i < (long) job_count; i++) {
+        if (jobs[i].error) {
+            fprintf(stderr, "%s: no speed or gps log\n", jobs[i].pathname);
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        fwrite(jobs[i].report, jobs[i].report_size, 1, stdout);
+        free(jobs[i].report);
+    }
+
+    fprintf(
+        stderr, "%lu sessions, %ld threads, %.3f s\n",
+        (unsigned long) job_count, thread_count, now() - begin
+    );
+
+    free(workers);
+    free(jobs);
+    sector_file_free(&sector_file);
+
+    return status;
+
+usage:
+    fprintf(
+        stderr, "usage: %s [-j threads] config sectors session...\n", argv[0]
+    );
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,435 @@
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * fakegps: stand in for an MTK GPS receiver on a host, behind a pseudo
+ * terminal whose slave side is symlinked to link, so ecollect can be pointed
+ * at it (see gps_set_device()); it drives round a circle of lap meters at a
+ * steady speed, and sends GGA, GSA, RMC and VTG sentences at its fix rate
+ *
+ * like the real thing it starts at 4800 bauds and 1 Hz, paces its output to
+ * the baud rate it is at, and only makes sense to a host set to the same
+ * baud rate: anything else gets garbage; it answers $PMTK251 (baud rate),
+ * $PMTK220 (fix period) and $PMTK314 (sentence output), unless -f is given,
+ * in which case it ignores $PMTK251, to try host fallback
+ *
+ * usage: fakegps [-f] [-c latitude,longitude] [-l lap] [-s km/h] link
+ */
+
+/* constants ================================================================ */
+#define BAUD 4800
+#define PERIOD 1000             /* ms */
+#define LATITUDE 48.8566
+#define LONGITUDE 2.3522
+#define LAP 1000.0              /* m */
+#define SPEED 25.0              /* km/h */
+
+#define METERS_PER_DEGREE 111320.0
+#define KNOTS 1.852
+#define PI 3.14159265358979323846
+
+#define SENTENCE_MAX 192
+#define COMMAND_MAX 128
+
+/* types ==================================================================== */
+typedef struct receiver_t receiver_t;
+
+/* structures =============================================================== */
+struct receiver_t {
+    int fd;
+    int fixed;                  /* ignore baud rate requests */
+    unsigned long baud;
+    unsigned long period;       /* ms in between fixes */
+    int gga;                    /* sentences it sends */
+    int gsa;
+    int rmc;
+    int vtg;
+    double latitude;            /* circle center */
+    double longitude;
+    double lap;
+    double speed;
+    char command[COMMAND_MAX];  /* incoming $PMTK sentence */
+    size_t length;
+};
+
+/* private functions ======================================================== */
+static speed_t baud_constant(unsigned long baud) {
+    switch (baud) {
+    case 4800:
+        return B4800;
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    case 115200:
+        return B115200;
+    default:
+        return B0;
+    }
+}
+
+static void degrees(char * dest, size_t size, double x, int width) {
+    /* dumb NMEA format: (d)ddmm.mmmm, degrees and minutes ------------------ */
+    unsigned long ten_thousandths = fabs(x) * 60 * 10000 + 0.5;
+
+    snprintf(
+        dest, size, "%0*lu%02lu.%04lu", width, ten_thousandths / 600000,
+        ten_thousandths / 10000 % 60, ten_thousandths % 10000
+    );
+}
+
+static void send(receiver_t * receiver, const char * body) {
+    char sentence[SENTENCE_MAX + 8];
+    struct termios termios;
+    struct timespec transfer;
+    unsigned char checksum = 0;
+    size_t i, length;
+
+    for (i = 0; body[i] != '\0'; i++) {
+        checksum ^= body[i];
+    }
+
+    length = snprintf(
+        sentence, sizeof sentence, "$%s*%02X\r\n", body, checksum
+    );
+
+    /* a host at another baud rate reads bits at the wrong time ------------ */
+    tcgetattr(receiver->fd, &termios);
+
+    if (cfgetospeed(&termios) != baud_constant(receiver->baud)) {
+        for (i = 0; i < length; i++) {
+            sentence[i] = rand();
+        }
+    }
+
+    write(receiver->fd, sentence, length);
+
+    /* start, 8 data and stop bits for each byte on the wire --------------- */
+    transfer.tv_sec = 0;
+    transfer.tv_nsec = length * 10 * (1000000000 / receiver->baud);
+    nanosleep(&transfer, NULL);
+}
+
+static void acknowledge(receiver_t * receiver, const char * command) {
+    char body[SENTENCE_MAX];
+
+    snprintf(body, sizeof body, "PMTK001,%s,3", command);
+    send(receiver, body);
+}
+
+static void command(receiver_t * receiver) {
+    char * body = receiver->command + 1;
+    char * star = strchr(body, '*');
+    unsigned char checksum = 0;
+    unsigned long value;
+    char * p;
+
+    if (receiver->command[0] != '$' || star == NULL) {
+        return;
+    }
+
+    *star = '\0';
+
+    for (p = body; *p != '\0'; p++) {
+        checksum ^= *p;
+    }
+
+    if (strtoul(star + 1, NULL, 16) != checksum) {
+        return;
+    }
+
+    if (sscanf(body, "PMTK251,%lu", &value) == 1) {
+        if (receiver->fixed || baud_constant(value) == B0) {
+            return;
+        }
+
+        /* acknowledged at the old rate, then switched -------------------- */
+        acknowledge(receiver, "251");
+        receiver->baud = value;
+        fprintf(stderr, "fakegps: %lu bauds\n", value);
+    }
+    else if (sscanf(body, "PMTK220,%lu", &value) == 1) {
+        if (value < 100 || value > 10000) {
+            return;
+        }
+
+        receiver->period = value;
+        acknowledge(receiver, "220");
+        fprintf(stderr, "fakegps: %lu ms in between fixes\n", value);
+    }
+    else if (strncmp(body, "PMTK314,", 8) == 0) {
+        int f[5] = { 0 };
+
+        /* GLL, RMC, VTG, GGA, GSA, then sentences it never sends --------- */
+        sscanf(body + 8, "%d,%d,%d,%d,%d", &f[0], &f[1], &f[2], &f[3], &f[4]);
+        receiver->rmc = f[1] != 0;
+        receiver->vtg = f[2] != 0;
+        receiver->gga = f[3] != 0;
+        receiver->gsa = f[4] != 0;
+        acknowledge(receiver, "314");
+        fprintf(
+            stderr, "fakegps: %s%s%s%s\n", receiver->gga ? "GGA " : "",
+            receiver->gsa ? "GSA " : "", receiver->rmc ? "RMC " : "",
+            receiver->vtg ? "VTG " : ""
+        );
+    }
+}
+
+static void receive(receiver_t * receiver) {
+    char buffer[64];
+    ssize_t i, n;
+
+    if ((n = read(receiver->fd, buffer, sizeof buffer)) <= 0) {
+        return;
+    }
+
+    /* assemble sentences, host commands are only ever $PMTK ones --------- */
+    for (i = 0; i < n; i++) {
+        if (buffer[i] == '$') {
+            receiver->length = 0;
+        }
+
+        if (buffer[i] == '\r' || buffer[i] == '\n') {
+            if (receiver->length > 0) {
+                receiver->command[receiver->length] = '\0';
+                command(receiver);
+            }
+
+            receiver->length = 0;
+        }
+        else if (receiver->length < sizeof receiver->command - 1) {
+            receiver->command[receiver->length++] = buffer[i];
+        }
+    }
+}
+
+static void fix(receiver_t * receiver, const struct timeval * now) {
+    char body[SENTENCE_MAX], utc[32], date[32];
+    char latitude[32], longitude[32];
+    double radius = receiver->lap / (2 * PI);
+    double angle, north, east, course, knots;
+    struct tm tm;
+
+    /* where we are on the circle, counterclockwise ----------------------- */
+    angle = fmod(
+        (now->tv_sec + now->tv_usec / 1e6) * receiver->speed / 3.6 / radius,
+        2 * PI
+    );
+    north = radius * cos(angle);
+    east = radius * sin(angle);
+    course = fmod(atan2(cos(angle), -sin(angle)) * 180 / PI + 360, 360);
+    knots = receiver->speed / KNOTS;
+
+    degrees(
+        latitude, sizeof latitude,
+        receiver->latitude + north / METERS_PER_DEGREE, 2
+    );
+    degrees(
+        longitude, sizeof longitude,
+        receiver->longitude +
+        east / (METERS_PER_DEGREE * cos(receiver->latitude * PI / 180)), 3
+    );
+
+    gmtime_r(&now->tv_sec, &tm);
+    snprintf(
+        utc, sizeof utc, "%02d%02d%02d.%03ld", tm.tm_hour, tm.tm_min,
+        tm.tm_sec, (long) now->tv_usec / 1000
+    );
+    snprintf(
+        date, sizeof date, "%02d%02d%02d", tm.tm_mday, tm.tm_mon + 1,
+        tm.tm_year % 100
+    );
+
+    if (receiver->gga) {
+        snprintf(
+            body, sizeof body, "GPGGA,%s,%s,%c,%s,%c,1,08,0.9,35.0,M,47.0,M,,",
+            utc, latitude, receiver->latitude < 0 ? 'S' : 'N', longitude,
+            receiver->longitude < 0 ? 'W' : 'E'
+        );
+        send(receiver, body);
+    }
+
+    if (receiver->gsa) {
+        send(receiver, "GPGSA,A,3,04,05,09,12,17,20,24,28,,,,,1.6,0.9,1.3");
+    }
+
+    if (receiver->rmc) {
+        snprintf(
+            body, sizeof body, "GPRMC,%s,A,%s,%c,%s,%c,%.2f,%.2f,%s,,,A", utc,
+            latitude, receiver->latitude < 0 ? 'S' : 'N', longitude,
+            receiver->longitude < 0 ? 'W' : 'E', knots, course, date
+        );
+        send(receiver, body);
+    }
+
+    if (receiver->vtg) {
+        snprintf(
+            body, sizeof body, "GPVTG,%.2f,T,,M,%.2f,N,%.2f,K,A", course,
+            knots, receiver->speed
+        );
+        send(receiver, body);
+    }
+}
+
+static int open_pty(const char * link) {
+    struct termios termios;
+    const char * slave;
+    int fd;
+
+    if ((fd = posix_openpt(O_RDWR | O_NOCTTY)) == -1) {
+        goto err_fd;
+    }
+
+    if (grantpt(fd) == -1 || unlockpt(fd) == -1) {
+        goto err_pty;
+    }
+
+    if ((slave = ptsname(fd)) == NULL) {
+        goto err_pty;
+    }
+
+    /* raw, at receiver power up rate, until the host says otherwise ------- */
+    tcgetattr(fd, &termios);
+    cfmakeraw(&termios);
+    cfsetspeed(&termios, B4800);
+    tcsetattr(fd, TCSANOW, &termios);
+
+    /* nobody listening drops sentences, as on a serial line -------------- */
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+
+    unlink(link);
+
+    if (symlink(slave, link) == -1) {
+        goto err_pty;
+    }
+
+    return fd;
+
+err_pty:
+    close(fd);
+
+err_fd:
+    return -1;
+}
+
+/* entry point ============================================================== */
+int main(int argc, char * argv[]) {
+    static receiver_t receiver;
+    struct timeval next, now;
+    int slave;
+    int c;
+
+    receiver.baud = BAUD;
+    receiver.period = PERIOD;
+    receiver.gga = receiver.gsa = receiver.rmc = receiver.vtg = 1;
+    receiver.latitude = LATITUDE;
+    receiver.longitude = LONGITUDE;
+    receiver.lap = LAP;
+    receiver.speed = SPEED;
+
+    while ((c = getopt(argc, argv, "fc:l:s:")) != -1) {
+        switch (c) {
+        case 'f':
+            receiver.fixed = 1;
+            break;
+        case 'c':
+            if (
+                sscanf(
+                    optarg, "%lf,%lf", &receiver.latitude, &receiver.longitude
+                ) != 2
+            ) {
+                goto usage;
+            }
+            break;
+        case 'l':
+            if ((receiver.lap = atof(optarg)) <= 0) {
+                goto usage;
+            }
+            break;
+        case 's':
+            receiver.speed = atof(optarg);
+            break;
+        default:
+            goto usage;
+        }
+    }
+
+    if (optind != argc - 1) {
+        goto usage;
+    }
+
+    if ((receiver.fd = open_pty(argv[optind])) == -1) {
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    /* hold the slave side, so hosts may come and go ----------------------- */
+    slave = open(argv[optind], O_RDWR | O_NOCTTY);
+
+    gettimeofday(&next, NULL);
+
+    while (1) {
+        struct timeval timeout;
+        fd_set set;
+
+        gettimeofday(&now, NULL);
+
+        if (!timercmp(&now, &next, <)) {
+            fix(&receiver, &now);
+
+            /* late, because of a slow link: skip the fixes it missed ------ */
+            do {
+                next.tv_usec += receiver.period * 1000;
+                next.tv_sec += next.tv_usec / 1000000;
+                next.tv_usec %= 1000000;
+            } while (timercmp(&next, &now, <));
+
+            continue;
+        }
+
+        timersub(&next, &now, &timeout);
+        FD_ZERO(&set);
+        FD_SET(receiver.fd, &set);
+
+        if (select(receiver.fd + 1, &set, NULL, NULL, &timeout) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            break;
+        }
+
+        if (FD_ISSET(receiver.fd, &set)) {
+            receive(&receiver);
+        }
+    }
+
+    close(slave);
+    close(receiver.fd);
+
+    return EXIT_FAILURE;
+
+usage:
+    fprintf(
+        stderr, "usage: %s [-f] [-c latitude,longitude] [-l lap] [-s km/h] "
+        "link\n", argv[0]
+    );
+
+    return EXIT_FAILURE;
+}
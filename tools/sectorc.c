@@ -0,0 +1,72 @@
+#include "sector.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * sectorc: compile a text sector file to the binary format ecollect loads
+ * from its USB key as "sectors.bin"; given the config file, the index is
+ * precomputed with its GPS epsilons, so LOAD does not even build it
+ *
+ * usage: sectorc sectors sectors.bin [config]
+ */
+
+/* entry point ============================================================== */
+int main(int argc, char * argv[]) {
+    sector_file_t file;
+    unsigned int wheel_length;
+    double epsilon_latitude = 0;
+    double epsilon_longitude = 0;
+
+    if (argc != 3 && argc != 4) {
+        fprintf(stderr, "usage: %s sectors sectors.bin [config]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* same config file as ecollect: wheel length, then epsilons ------------ */
+    if (argc == 4) {
+        FILE * fp;
+
+        if ((fp = fopen(argv[3], "r")) == NULL) {
+            perror(argv[3]);
+            return EXIT_FAILURE;
+        }
+
+        if (
+            fscanf(
+                fp, "%u %lf %lf", &wheel_length, &epsilon_latitude,
+                &epsilon_longitude
+            ) != 3
+        ) {
+            fprintf(stderr, "%s: no GPS epsilons\n", argv[3]);
+            fclose(fp);
+            return EXIT_FAILURE;
+        }
+
+        fclose(fp);
+    }
+
+    if (
+        sector_file_load_text(
+            &file, argv[1], epsilon_latitude, epsilon_longitude
+        ) == -1
+    ) {
+        perror(argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    if (sector_file_save(&file, argv[2]) == -1) {
+        perror(argv[2]);
+        sector_file_free(&file);
+        return EXIT_FAILURE;
+    }
+
+    printf(
+        "%s: %lu sectors%s\n", argv[2], (unsigned long) file.count,
+        epsilon_latitude > 0 && epsilon_longitude > 0 ? ", indexed" : ""
+    );
+
+    sector_file_free(&file);
+
+    return EXIT_SUCCESS;
+}
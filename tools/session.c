@@ -0,0 +1,140 @@
+#include "session.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * session: convert a binary session file, "speed.bin" or "gps.bin" as logged
+ * by ecollect, back to the text file it stands for, or to CSV with -c; GPS
+ * sentences are rebuilt from the fix, so GGA fields ecollect does not decode
+ * (altitude, geoid separation, DGPS station) come out empty; "energy.bin"
+ * has no text file, it comes out as "time,voltage,current" lines either way,
+ * which ecollect can replay (see energy_set_source())
+ *
+ * usage: session [-c] file.bin
+ */
+
+/* private functions ======================================================== */
+static void degrees(char * dest, size_t size, double x, int width) {
+    /* dumb NMEA format again: (d)ddmm.mmmm, degrees and minutes ------------ */
+    unsigned long ten_thousandths = (x < 0 ? -x : x) * 60 * 10000 + 0.5;
+
+    snprintf(
+        dest, size, "%0*lu%02lu.%04lu", width, ten_thousandths / 600000,
+        ten_thousandths / 10000 % 60, ten_thousandths % 10000
+    );
+}
+
+static void print_gga(const session_record_t * record) {
+    const nmea_fix_t * fix = &record->fix;
+    char sentence[2 * NMEA_SENTENCE_MAX];
+    char latitude[32], longitude[32], ms[8] = "";
+    unsigned char checksum = 0;
+    size_t i;
+
+    degrees(latitude, sizeof latitude, FIXED_TO_DEGREES(fix->latitude), 2);
+    degrees(
+        longitude, sizeof longitude, FIXED_TO_DEGREES(fix->longitude), 3
+    );
+
+    if (fix->time % 1000) {
+        snprintf(ms, sizeof ms, ".%03lu", fix->time % 1000);
+    }
+
+    snprintf(
+        sentence, sizeof sentence,
+        "$GPGGA,%02lu%02lu%02lu%s,%s,%c,%s,%c,%u,%02u,%.1f,,M,,M,,",
+        fix->time / 3600000, fix->time / 60000 % 60, fix->time / 1000 % 60,
+        ms, latitude, fix->latitude < 0 ? 'S' : 'N', longitude,
+        fix->longitude < 0 ? 'W' : 'E', fix->quality, fix->satellites,
+        fix->hdop
+    );
+
+    for (i = 1; sentence[i] != '\0'; i++) {
+        checksum ^= sentence[i];
+    }
+
+    printf("%s*%02X,%llu\n", sentence, checksum, record->time);
+}
+
+/* entry point ============================================================== */
+int main(int argc, char * argv[]) {
+    static session_reader_t reader;
+    session_record_t record;
+    unsigned long records = 0;
+    int csv = 0;
+    int c;
+    FILE * fp;
+
+    while ((c = getopt(argc, argv, "c")) != -1) {
+        if (c != 'c') {
+            goto usage;
+        }
+
+        csv = 1;
+    }
+
+    if (optind != argc - 1) {
+        goto usage;
+    }
+
+    if ((fp = fopen(argv[optind], "rb")) == NULL) {
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    if (session_reader_open(&reader, fp) == -1) {
+        fprintf(stderr, "%s: not a session file\n", argv[optind]);
+        fclose(fp);
+        return EXIT_FAILURE;
+    }
+
+    if (csv) {
+        printf(
+            reader.type == SESSION_GPS ?
+            "time,utc,latitude,longitude,quality,satellites,hdop\n" :
+            reader.type == SESSION_ENERGY ? "time,voltage,current\n" :
+            "time\n"
+        );
+    }
+
+    while (session_read(&reader, &record) != -1) {
+        ++records;
+
+        if (reader.type == SESSION_ENERGY) {
+            printf(
+                "%llu,%ld,%ld\n", record.time, record.voltage, record.current
+            );
+        }
+        else if (reader.type != SESSION_GPS) {
+            printf("%llu\n", record.time);
+        }
+        else if (csv) {
+            printf(
+                "%llu,%lu,%.6f,%.6f,%u,%u,%.2f\n", record.time,
+                record.fix.time, FIXED_TO_DEGREES(record.fix.latitude),
+                FIXED_TO_DEGREES(record.fix.longitude),
+                record.fix.quality, record.fix.satellites, record.fix.hdop
+            );
+        }
+        else {
+            print_gga(&record);
+        }
+    }
+
+    fclose(fp);
+
+    /* corrupt or truncated parts are skipped, but not silently ------------- */
+    fprintf(
+        stderr, "%s: %lu records in %lu blocks, %lu skipped\n",
+        argv[optind], records, reader.blocks, reader.skipped
+    );
+
+    return reader.skipped ? 2 : EXIT_SUCCESS;
+
+usage:
+    fprintf(stderr, "usage: %s [-c] file.bin\n", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,240 @@
+#define _DEFAULT_SOURCE
+
+#include "frame.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+/*
+ * telemetry: receive live telemetry frames (see frame.h) in the pit, either
+ * datagrams on a UDP port, as "udp:port", or a byte stream from a serial
+ * radio tty, at baud (9600 by default), and print them as CSV lines, in
+ * human units, until count frames are in or it is interrupted; frames lost
+ * on the way show as gaps in their sequence, and are counted, along with
+ * corrupt ones, on exit
+ *
+ * usage: telemetry [-n count] udp:port | tty [baud]
+ */
+
+/* constants ================================================================ */
+#define BAUD 9600
+#define BUFFER_SIZE 512
+
+/* private variables ======================================================== */
+static volatile sig_atomic_t interrupted;
+
+/* private functions ======================================================== */
+static void interrupt(int signum) {
+    interrupted = 1;
+    (void) signum;
+}
+
+static speed_t baud_constant(unsigned long baud) {
+    switch (baud) {
+    case 9600:
+        return B9600;
+    case 19200:
+        return B19200;
+    case 38400:
+        return B38400;
+    case 57600:
+        return B57600;
+    case 115200:
+        return B115200;
+    default:
+        return B0;
+    }
+}
+
+static int open_udp(const char * port) {
+    struct sockaddr_in address;
+    int s;
+
+    if ((s = socket(AF_INET, SOCK_DGRAM, 0)) == -1) {
+        return -1;
+    }
+
+    memset(&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(atoi(port));
+
+    if (bind(s, (struct sockaddr *) &address, sizeof address) == -1) {
+        close(s);
+        return -1;
+    }
+
+    return s;
+}
+
+static int open_tty(const char * pathname, unsigned long baud) {
+    struct termios termios;
+    int s;
+
+    if (baud_constant(baud) == B0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((s = open(pathname, O_RDONLY | O_NOCTTY)) == -1) {
+        return -1;
+    }
+
+    tcgetattr(s, &termios);
+    cfmakeraw(&termios);
+    cfsetspeed(&termios, baud_constant(baud));
+    tcsetattr(s, TCSANOW, &termios);
+
+    return s;
+}
+
+static void print_frame(const frame_t * frame) {
+    printf("%u,%.3f", frame->sequence, frame->time / 1000.0);
+
+    if (frame->flags & FRAME_SPEED) {
+        printf(
+            ",%.2f,%.2f,%lu", frame->instant * 3.6 / 1000,
+            frame->average * 3.6 / 1000, frame->rotations
+        );
+    }
+    else {
+        printf(",,,");
+    }
+
+    if (frame->flags & FRAME_FIX) {
+        printf(
+            ",%.6f,%.6f,%u,%u", frame->latitude / 1e6,
+            frame->longitude / 1e6, frame->quality, frame->satellites
+        );
+    }
+    else {
+        printf(",,,,");
+    }
+
+    printf(",%d", frame->sector);
+
+    if (frame->flags & FRAME_ENERGY) {
+        printf(",%d,%.2f", frame->power, frame->energy / 100.0);
+    }
+    else {
+        printf(",,");
+    }
+
+    printf(",%u,%u\n", frame->frames, frame->errors);
+    fflush(stdout);
+}
+
+/* entry point ============================================================== */
+int main(int argc, char * argv[]) {
+    static frame_scanner_t scanner;
+    unsigned char buffer[BUFFER_SIZE];
+    struct sigaction action;
+    unsigned long count = 0;
+    unsigned long received = 0;
+    unsigned long lost = 0;
+    unsigned long corrupt = 0;
+    unsigned int expected = 0;
+    int udp, fd, c;
+    frame_t frame;
+    ssize_t n;
+
+    while ((c = getopt(argc, argv, "n:")) != -1) {
+        if (c != 'n') {
+            goto usage;
+        }
+
+        count = strtoul(optarg, NULL, 10);
+    }
+
+    if (optind != argc - 1 && optind != argc - 2) {
+        goto usage;
+    }
+
+    udp = strncmp(argv[optind], "udp:", 4) == 0;
+    fd = udp ?
+        open_udp(argv[optind] + 4) :
+        open_tty(
+            argv[optind],
+            optind == argc - 2 ? strtoul(argv[optind + 1], NULL, 10) : BAUD
+        );
+
+    if (fd == -1) {
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+    }
+
+    /* no SA_RESTART, so an interrupt gets read() out ----------------------- */
+    memset(&action, 0, sizeof action);
+    action.sa_handler = interrupt;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    printf(
+        "sequence,time,instant,average,rotations,latitude,longitude,quality,"
+        "satellites,sector,power,energy,sentences,errors\n"
+    );
+
+    while (!interrupted && (count == 0 || received < count)) {
+        ssize_t i;
+
+        if ((n = read(fd, buffer, sizeof buffer)) <= 0) {
+            if (n == -1 && errno == EINTR) {
+                continue;
+            }
+
+            break;
+        }
+
+        for (i = 0; i < n; i++) {
+            /* a datagram is one frame, whole or nothing --------------------- */
+            if (udp) {
+                if (n != FRAME_SIZE || frame_unpack(buffer, &frame) == -1) {
+                    ++corrupt;
+                    break;
+                }
+
+                i = n;
+            }
+            else if (!frame_scan(&scanner, buffer[i], &frame)) {
+                continue;
+            }
+
+            if (received > 0) {
+                lost += (frame.sequence - expected) & 0xffff;
+            }
+
+            expected = (frame.sequence + 1) & 0xffff;
+            ++received;
+
+            print_frame(&frame);
+
+            if (count > 0 && received == count) {
+                break;
+            }
+        }
+    }
+
+    close(fd);
+
+    fprintf(
+        stderr, "%s: %lu frames, %lu lost, %lu corrupt, %lu bytes skipped\n",
+        argv[optind], received, lost, corrupt, scanner.skipped
+    );
+
+    return EXIT_SUCCESS;
+
+usage:
+    fprintf(
+        stderr, "usage: %s [-n count] udp:port | tty [baud]\n", argv[0]
+    );
+
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,148 @@
+#include "track.h"
+#include "fusion.h"
+#include "logger.h"
+
+#include <stdio.h>
+
+/* constants ================================================================ */
+#define RECORDS_SIZE 256
+
+/* types ==================================================================== */
+typedef struct record_t record_t;
+
+/* structures =============================================================== */
+struct record_t {
+    char source;
+    int positioned;
+    int sector;
+    unsigned long long time;
+    double latitude;
+    double longitude;
+    double distance;
+    double speed;
+};
+
+/* private variables ======================================================== */
+static int running;
+
+static logger_channel_t channel;
+static record_t records[RECORDS_SIZE];
+
+static fusion_t fusion;
+static const sector_file_t * sector_file;
+static size_t sector_curr;
+static unsigned long rotations;
+static unsigned long frames;
+
+/* private functions ======================================================== */
+static int format(FILE * stream, const void * record) {
+    const record_t * r = record;
+
+    if (!r->positioned) {
+        return fprintf(
+            stream, "%c,%llu,,,%.3f,%.3f,%d\n", r->source, r->time,
+            r->distance, r->speed, r->sector
+        );
+    }
+
+    return fprintf(
+        stream, "%c,%llu,%.7f,%.7f,%.3f,%.3f,%d\n", r->source, r->time,
+        r->latitude, r->longitude, r->distance, r->speed, r->sector
+    );
+}
+
+static void output(void * cookie, const fusion_point_t * point) {
+    record_t record;
+
+    record.source = point->source == FUSION_ROTATION ? 'R' : 'F';
+    record.positioned = point->positioned;
+    record.sector = -1;
+    record.time = point->time;
+    record.latitude = point->latitude;
+    record.longitude = point->longitude;
+    record.distance = point->distance;
+    record.speed = point->speed;
+
+    /* same sector walk as the sector screen, at rotation resolution ------- */
+    if (
+        point->positioned && sector_file != NULL && sector_file->count > 0 &&
+        sector_match(
+            &sector_file->index, sector_file->sectors, sector_file->count,
+            FIXED_FROM_DEGREES(point->latitude),
+            FIXED_FROM_DEGREES(point->longitude), &sector_curr
+        ) != -1
+    ) {
+        record.sector = sector_curr;
+    }
+
+    logger_push(&channel, &record);
+
+    (void) cookie;
+}
+
+/* public functions ========================================================= */
+int track_init(unsigned int wheel_length, const sector_file_t * file) {
+    if (running) {
+        goto err_running;
+    }
+
+    if (
+        logger_open(
+            &channel, "track", format, NULL, records, sizeof *records,
+            RECORDS_SIZE
+        ) == -1
+    ) {
+        goto err_channel;
+    }
+
+    fusion_init(&fusion, wheel_length, output, NULL);
+    sector_file = file;
+    sector_curr = 0;
+    rotations = 0;
+    frames = 0;
+
+    running = 1;
+
+    return 0;
+
+err_channel:
+err_running:
+    return -1;
+}
+
+int track_exit(void) {
+    if (!running) {
+        goto err_not_running;
+    }
+
+    running = 0;
+
+    fusion_flush(&fusion);
+
+    return 0;
+
+err_not_running:
+    return -1;
+}
+
+void track_update(const speed_snapshot_t * speed, const gps_fix_t * fix) {
+    if (!running) {
+        return;
+    }
+
+    if (speed->rotations != rotations) {
+        rotations = speed->rotations;
+        fusion_rotation(&fusion, speed->rotation_time, speed->rotations);
+    }
+
+    /* when the fix epoch was, once the receiver latency is taken off (see
+       gps_set_latency()), not when it came; fixes without one are left
+       out, so fusion sees a single timebase ----------------------------- */
+    if (fix->frames != frames) {
+        frames = fix->frames;
+
+        if (fix->fix_time != 0) {
+            fusion_fix(&fusion, fix->fix_time, &fix->nmea);
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef TRACK_H
+#define TRACK_H
+
+#include "gps.h"
+#include "sector.h"
+#include "speed.h"
+
+/*
+ * track_init()
+ *
+ * start fusing rotations and fixes (see fusion.h) for a wheel_length mm
+ * wheel, each point of the fused track is matched against sectors of file,
+ * if any, and logged to a "./track" text file as:
+ *
+ *  R|F,time,latitude,longitude,distance,speed,sector
+ *
+ * R for a rotation, F for a fix, time in ns, latitude and longitude in
+ * degrees, empty when unknown, distance since first rotation in m, speed in
+ * m/s and sector -1 when none; file must stay loaded until track_exit(),
+ * logger_init() must have been called
+ *
+ * returns -1 if:
+ *  - track is already running
+ *  - "./track" log channel could not be opened
+ */
+
+int track_init(unsigned int wheel_length, const sector_file_t * file);
+
+/*
+ * track_exit()
+ *
+ * fuse and log what is left, "./track" text file is closed by logger_exit()
+ *
+ * returns -1 if:
+ *  - track is not running
+ */
+
+int track_exit(void);
+
+/*
+ * track_update()
+ *
+ * feed track with the latest speed snapshot and GPS fix, whatever is new in
+ * them since previous call is fused, rotations missed in between still count
+ * for distance, fixes without a UTC time on the sensors timebase (see gps.h)
+ * are not; always from the same thread
+ */
+
+void track_update(const speed_snapshot_t * speed, const gps_fix_t * fix);
+
+#endif
@@ -0,0 +1,142 @@
+#include "utc.h"
+
+#include <string.h>
+
+/* private functions ======================================================== */
+static long elapsed(unsigned long from, unsigned long to) {
+    long d = (long) to - (long) from;
+
+    /* times of day, the shortest way round midnight ----------------------- */
+    if (d < -UTC_DAY / 2) {
+        d += UTC_DAY;
+    }
+    else if (d >= UTC_DAY / 2) {
+        d -= UTC_DAY;
+    }
+
+    return d;
+}
+
+static void start(utc_clock_t * clock, unsigned long day, double stamp) {
+    clock->samples = 1;
+    clock->day = day;
+    clock->base = stamp;
+    clock->drift = 0;
+    clock->outliers = 0;
+}
+
+/* public functions ========================================================= */
+void utc_init(utc_clock_t * clock) {
+    memset(clock, 0, sizeof *clock);
+    histogram_reset(&clock->jitter);
+}
+
+void utc_set_latency(utc_clock_t * clock, double latency) {
+    clock->latency = latency;
+}
+
+void utc_update(
+    utc_clock_t * clock, unsigned long day, unsigned long long stamp
+) {
+    double predicted, residual, gain;
+    long d;
+
+    if (clock->samples == 0) {
+        start(clock, day, stamp);
+        return;
+    }
+
+    /* same epoch, a later sentence of it; earlier ones are outliers ------- */
+    if ((d = elapsed(clock->day, day)) == 0) {
+        return;
+    }
+
+    predicted = clock->base + d * 1e6 * (1 + clock->drift);
+    residual = stamp - predicted;
+
+    /* a receiver restart or a time jump, unless it was a one-off ---------- */
+    if (residual > UTC_OUTLIER || residual < -UTC_OUTLIER) {
+        ++clock->rejected;
+
+        if (++clock->outliers >= UTC_RESET) {
+            ++clock->restarts;
+            start(clock, day, stamp);
+        }
+
+        return;
+    }
+
+    clock->outliers = 0;
+
+    /* settle fast, then follow the earliest stamps ------------------------ */
+    if (clock->samples < UTC_SETTLE) {
+        gain = UTC_GAIN_EARLY;
+    }
+    else {
+        gain = residual < 0 ? UTC_GAIN_EARLY : UTC_GAIN_LATE;
+
+        /* a burst of very late ones must not drag the model along --------- */
+        if (residual > 0) {
+            histogram_record(&clock->jitter, residual);
+
+            if (residual > UTC_LATE_MAX) {
+                residual = UTC_LATE_MAX;
+            }
+        }
+    }
+
+    clock->base = predicted + gain * residual;
+
+    /* what is left of the residual, over the time it built up in ---------- */
+    if (clock->samples > 1) {
+        clock->drift += UTC_GAIN_DRIFT * gain * residual / (d * 1e6);
+
+        if (clock->drift > UTC_DRIFT_MAX) {
+            clock->drift = UTC_DRIFT_MAX;
+        }
+        else if (clock->drift < -UTC_DRIFT_MAX) {
+            clock->drift = -UTC_DRIFT_MAX;
+        }
+    }
+
+    clock->day = day;
+    ++clock->samples;
+}
+
+int utc_map(
+    const utc_clock_t * clock, unsigned long day, unsigned long long * dest
+) {
+    if (clock->samples < UTC_SETTLE || clock->outliers > 0) {
+        return -1;
+    }
+
+    *dest = clock->base + elapsed(clock->day, day) * 1e6 * (1 + clock->drift) -
+        clock->latency;
+
+    return 0;
+}
+
+int utc_dump(const utc_clock_t * clock, const char * pathname) {
+    FILE * fp;
+
+    if ((fp = fopen(pathname, "w")) == NULL) {
+        return -1;
+    }
+
+    fprintf(
+        fp, "%lu epochs, drift %.3f ppm, %lu outliers, %lu restarts\n",
+        clock->samples, clock->drift * 1e6, clock->rejected, clock->restarts
+    );
+
+    fprintf(
+        fp, "%-16s %8s %10s %10s %10s %10s %10s %10s %10s\n",
+        "arrival (ms)", "count", "min", "p50", "p90", "p99", "p99.9", "max",
+        "mean"
+    );
+
+    histogram_print(&clock->jitter, fp, "jitter", 1e6);
+
+    fclose(fp);
+
+    return 0;
+}
@@ -0,0 +1,102 @@
+#ifndef UTC_H
+#define UTC_H
+
+#include "histogram.h"
+
+#define UTC_SETTLE 8            /* samples before the model is trusted */
+#define UTC_GAIN_EARLY 0.5      /* share of an early residual taken in */
+#define UTC_GAIN_LATE 0.03125   /* share of a late one */
+#define UTC_LATE_MAX 5000000LL  /* ns, later ones are taken in as that */
+#define UTC_GAIN_DRIFT 0.001    /* share of the residual rate into drift */
+#define UTC_DRIFT_MAX 0.001     /* 1000 ppm, no crystal is that far off */
+#define UTC_OUTLIER 250000000LL /* ns, residuals ignored beyond that */
+#define UTC_RESET 3             /* outliers in a row, the model starts over */
+#define UTC_DAY 86400000L       /* ms */
+
+typedef struct utc_clock_t utc_clock_t;
+
+/*
+ * receiver UTC to sensors timebase (rt_timer_read(), in ns) clock model:
+ * each epoch, the first sentence carrying its UTC time of day is stamped at
+ * the arrival of its first byte; that stamp is the epoch on our timebase,
+ * plus a steady receiver latency, plus a jitter which only ever delays it
+ * (USB and serial drivers, scheduling), so the model follows the earliest
+ * stamps: an early residual is taken in fast, a late one slowly and only up
+ * to UTC_LATE_MAX; drift, the receiver clock rate against ours, is tracked
+ * from the residuals too
+ *
+ * mapped times are the epochs once the receiver latency, its own output
+ * delay from epoch to first byte, is set (see utc_set_latency()); left at
+ * 0, they lag the epochs by it; UTC midnight is crossed transparently
+ */
+
+struct utc_clock_t {
+    unsigned long samples;      /* since latest start */
+    unsigned long day;          /* latest UTC time of day (in ms) */
+    double base;                /* latest epoch on our timebase (in ns) */
+    double drift;               /* our ns per UTC ns, minus 1 */
+    unsigned int outliers;      /* in a row */
+
+    histogram_t jitter;         /* late residuals, once settled (in ns) */
+    unsigned long rejected;     /* outliers, ever */
+    unsigned long restarts;     /* after UTC_RESET outliers in a row */
+    double latency;             /* receiver epoch to first byte (in ns) */
+};
+
+/*
+ * utc_init()
+ *
+ * setup model with no sample yet, empty metrics, and no receiver latency
+ */
+
+void utc_init(utc_clock_t * clock);
+
+/*
+ * utc_set_latency()
+ *
+ * set receiver latency (in ns), from an epoch to the first byte of its first
+ * sentence, as the receiver datasheet or a PPS measurement tells, which
+ * utc_map() takes off mapped times
+ */
+
+void utc_set_latency(utc_clock_t * clock, double latency);
+
+/*
+ * utc_update()
+ *
+ * feed model with an epoch at day, its UTC time of day (in ms), whose first
+ * sentence byte arrived at stamp (in ns); the latest epoch again is ignored,
+ * an earlier one is an outlier
+ */
+
+void utc_update(
+    utc_clock_t * clock, unsigned long day, unsigned long long stamp
+);
+
+/*
+ * utc_map()
+ *
+ * map day, a UTC time of day (in ms), onto the sensors timebase, less the
+ * receiver latency, to dest (in ns)
+ *
+ * returns -1 if:
+ *  - model has not settled yet, or latest epoch was an outlier, dest is
+ *    left unchanged
+ */
+
+int utc_map(
+    const utc_clock_t * clock, unsigned long day, unsigned long long * dest
+);
+
+/*
+ * utc_dump()
+ *
+ * save drift, outliers and jitter (in ms) to a pathname text file
+ *
+ * returns -1 if:
+ *  - pathname file could not be opened for writing
+ */
+
+int utc_dump(const utc_clock_t * clock, const char * pathname);
+
+#endif
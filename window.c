@@ -0,0 +1,187 @@
+#include "window.h"
+#include "fixed.h"
+
+#include <limits.h>
+#include <string.h>
+
+/* constants ================================================================ */
+#define MASK (WINDOW_MAX - 1)
+
+/* private functions ======================================================== */
+static unsigned long speed(
+    const window_t * window, const unsigned long * queue, unsigned long j
+) {
+    return window->speeds[queue[j & MASK] & MASK];
+}
+
+static long long millis(const window_t * window, unsigned long i) {
+    /* a rotation speed is best timed in the middle of its period ---------- */
+    return (
+        (long long) (window->times[i & MASK] - window->origin) -
+        (long long) (window->periods[i & MASK] / 2)
+    ) / 1000000;
+}
+
+static void sums_add(window_t * window, unsigned long i, long long sign) {
+    long long t = millis(window, i);
+    long long v = window->speeds[i & MASK];
+
+    window->sum_t += sign * t;
+    window->sum_v += sign * v;
+    window->sum_tt += sign * t * t;
+    window->sum_tv += sign * t * v;
+}
+
+static void sums_rebuild(window_t * window) {
+    unsigned long i;
+
+    /* time origin moves to the oldest rotation, to keep t * t small ------- */
+    window->origin = window->times[window->tail & MASK];
+    window->sum_t = 0;
+    window->sum_v = 0;
+    window->sum_tt = 0;
+    window->sum_tv = 0;
+    window->pushes = 0;
+
+    for (i = window->tail; i != window->head; i++) {
+        sums_add(window, i, 1);
+    }
+}
+
+static void pop(window_t * window) {
+    unsigned long i = window->tail++;
+
+    window->sum_period -= window->periods[i & MASK];
+    sums_add(window, i, -1);
+
+    /* leaving rotation may be the current min or max ---------------------- */
+    if (
+        window->mins_tail != window->mins_head &&
+        window->mins[window->mins_tail & MASK] == i
+    ) {
+        ++window->mins_tail;
+    }
+
+    if (
+        window->maxs_tail != window->maxs_head &&
+        window->maxs[window->maxs_tail & MASK] == i
+    ) {
+        ++window->maxs_tail;
+    }
+}
+
+/* public functions ========================================================= */
+void window_init(
+    window_t * window, unsigned int length, unsigned long count_max,
+    unsigned long long span_max
+) {
+    memset(window, 0, sizeof *window);
+
+    window->length = length;
+    window->count_max = count_max;
+    window->span_max = span_max;
+}
+
+void window_push(
+    window_t * window, unsigned long long time, unsigned long long period
+) {
+    unsigned long i;
+    unsigned long v = fixed_mms(window->length, period);
+
+    /* make room, by count first ------------------------------------------- */
+    while (
+        window->head - window->tail == WINDOW_MAX ||
+        (
+            window->count_max &&
+            window->head - window->tail >= window->count_max
+        )
+    ) {
+        pop(window);
+    }
+
+    i = window->head++;
+
+    window->times[i & MASK] = time;
+    window->periods[i & MASK] = period;
+    window->speeds[i & MASK] = v;
+    window->sum_period += period;
+
+    /* alone in window, sums start over from this rotation ------------------ */
+    if (window->head - window->tail == 1) {
+        sums_rebuild(window);
+    }
+    else {
+        sums_add(window, i, 1);
+    }
+
+    /* then by time, the latest rotation is always kept --------------------- */
+    while (
+        window->span_max && window->head - window->tail > 1 &&
+        time - (
+            window->times[window->tail & MASK] -
+            window->periods[window->tail & MASK]
+        ) > window->span_max
+    ) {
+        pop(window);
+    }
+
+    /* slower rotations behind a faster one will never be the max ---------- */
+    while (
+        window->maxs_head != window->maxs_tail &&
+        speed(window, window->maxs, window->maxs_head - 1) <= v
+    ) {
+        --window->maxs_head;
+    }
+
+    window->maxs[window->maxs_head++ & MASK] = i;
+
+    /* and faster ones behind a slower one will never be the min ----------- */
+    while (
+        window->mins_head != window->mins_tail &&
+        speed(window, window->mins, window->mins_head - 1) >= v
+    ) {
+        --window->mins_head;
+    }
+
+    window->mins[window->mins_head++ & MASK] = i;
+
+    /* as many pushes as rotations in window: rebuilding is amortized ------ */
+    if (++window->pushes >= window->head - window->tail) {
+        sums_rebuild(window);
+    }
+}
+
+void window_get_stats(const window_t * window, window_stats_t * dest) {
+    unsigned long n = window->head - window->tail;
+    long long d, slope;
+
+    memset(dest, 0, sizeof *dest);
+
+    if (n == 0) {
+        return;
+    }
+
+    dest->rotations = n;
+    dest->span = window->sum_period;
+    dest->mean = fixed_mms(
+        (unsigned long long) n * window->length, window->sum_period
+    );
+    dest->min = speed(window, window->mins, window->mins_tail);
+    dest->max = speed(window, window->maxs, window->maxs_tail);
+
+    /* slope = (n.sum(tv) - sum(t).sum(v)) / (n.sum(tt) - sum(t)^2) --------- */
+    d = (long long) n * window->sum_tt - window->sum_t * window->sum_t;
+
+    if (n > 1 && d > 0) {
+        slope = (long long) n * window->sum_tv - window->sum_t * window->sum_v;
+
+        /* mm/s per ms to mm/s2, scaled before dividing unless that would
+           overflow, which only windows minutes long come near ------------- */
+        if (slope < LLONG_MAX / 1000 && slope > -LLONG_MAX / 1000) {
+            dest->acceleration = fixed_div(slope * 1000, d);
+        }
+        else {
+            dest->acceleration = fixed_div(slope, d) * 1000;
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef WINDOW_H
+#define WINDOW_H
+
+#define WINDOW_MAX 512
+
+typedef struct window_stats_t window_stats_t;
+typedef struct window_t window_t;
+
+/*
+ * rolling statistics over the latest wheel rotations, bounded by a rotation
+ * count, by a time span, or both, and never more than WINDOW_MAX rotations;
+ * speeds are in mm/s, as everywhere else (see fixed.h)
+ *
+ * each rotation is pushed once, with its end timestamp and its period, and
+ * costs O(1): running sums are updated as rotations enter and leave, min and
+ * max come from monotonic queues; sums are integers, times in ms since the
+ * oldest rotation, which are rebuilt from scratch after as many pushes as
+ * there are rotations in window (amortized O(1)), so that times stay small;
+ * nothing here goes through doubles, as it runs in the speed task
+ */
+
+struct window_stats_t {
+    unsigned long mean;         /* distance / time spent (in mm/s) */
+    long acceleration;          /* least squares slope of speed (in mm/s2) */
+    unsigned long min;          /* slowest rotation (in mm/s) */
+    unsigned long max;          /* fastest rotation (in mm/s) */
+    unsigned long rotations;    /* rotations in window */
+    unsigned long long span;    /* time covered by window (in ns) */
+};
+
+struct window_t {
+    unsigned int length;        /* mm a rotation goes */
+    unsigned long count_max;    /* rotations, 0 if unbounded */
+    unsigned long long span_max; /* ns, 0 if unbounded */
+
+    /* rotations in window, from tail (oldest) to head (next) */
+    unsigned long long times[WINDOW_MAX];
+    unsigned long long periods[WINDOW_MAX];
+    unsigned long speeds[WINDOW_MAX];
+    unsigned long head;
+    unsigned long tail;
+
+    /* indexes of increasing speeds (min first), then of decreasing ones */
+    unsigned long mins[WINDOW_MAX];
+    unsigned long mins_head;
+    unsigned long mins_tail;
+    unsigned long maxs[WINDOW_MAX];
+    unsigned long maxs_head;
+    unsigned long maxs_tail;
+
+    /* running sums, times in ms since origin, speeds in mm/s */
+    unsigned long long origin;
+    unsigned long long sum_period;
+    long long sum_t;
+    long long sum_v;
+    long long sum_tt;
+    long long sum_tv;
+    unsigned long pushes;       /* since sums were last rebuilt */
+};
+
+/*
+ * window_init()
+ *
+ * setup an empty window for a length mm wheel, keeping at most count_max
+ * rotations (0 for as many as possible) ending no more than span_max ns apart
+ * (0 for any span)
+ */
+
+void window_init(
+    window_t * window, unsigned int length, unsigned long count_max,
+    unsigned long long span_max
+);
+
+/*
+ * window_push()
+ *
+ * add the rotation that ended at time (in ns) and lasted period ns, drop the
+ * rotations that no longer fit
+ */
+
+void window_push(
+    window_t * window, unsigned long long time, unsigned long long period
+);
+
+/*
+ * window_get_stats()
+ *
+ * compute statistics over the rotations in window to dest, acceleration is 0
+ * with less than two rotations, everything is 0 if window is empty
+ */
+
+void window_get_stats(const window_t * window, window_stats_t * dest);
+
+#endif